@@ -0,0 +1,381 @@
+#include "benchmark_suite.hpp"
+#include "float_image.hpp"
+#include "json_string.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <foray_logger.hpp>
+#include <fstream>
+#include <sstream>
+
+namespace {
+    std::string lTrim(const std::string& text)
+    {
+        size_t begin = text.find_first_not_of(" \t\r");
+        if(begin == std::string::npos)
+        {
+            return "";
+        }
+        size_t end = text.find_last_not_of(" \t\r");
+        return text.substr(begin, end - begin + 1);
+    }
+
+    /// @brief "name = value # comment", same syntax as the preset and sweep files of restir_app
+    bool lParseLine(const std::string& line, std::string& name, std::string& value)
+    {
+        std::string content = line.substr(0, line.find('#'));
+        size_t      equals  = content.find('=');
+        if(equals == std::string::npos)
+        {
+            return false;
+        }
+        name  = lTrim(content.substr(0, equals));
+        value = lTrim(content.substr(equals + 1));
+        return !name.empty() && !value.empty();
+    }
+
+    std::string lReplaceAll(std::string text, const std::string& pattern, const std::string& replacement)
+    {
+        for(size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + replacement.size()))
+        {
+            text.replace(pos, pattern.size(), replacement);
+        }
+        return text;
+    }
+
+    void lSetEnvironment(const char* name, const std::string& value)
+    {
+#ifdef _WIN32
+        _putenv_s(name, value.c_str());
+#else
+        setenv(name, value.c_str(), 1);
+#endif
+    }
+
+    /// @brief Executables of the apps, configured by benchmark_suite/CMakeLists.txt
+    std::string lAppPath(const std::string& app)
+    {
+        if(app == "sampling")
+        {
+            return SAMPLING_TESTAPP_PATH;
+        }
+        if(app == "restir")
+        {
+            return RESTIR_APP_PATH;
+        }
+        return "";
+    }
+}  // namespace
+
+bool BenchmarkSuite::LoadSpec(const std::string& path)
+{
+    std::ifstream file(path);
+    if(!file.is_open())
+    {
+        foray::logger()->warn("Unable to read benchmark suite \"{}\"", path);
+        return false;
+    }
+
+    Settings                                     settings;
+    std::unordered_map<std::string, std::string> referenceArguments;
+    std::vector<Configuration>                   configurations;
+    std::string                                  line;
+    while(std::getline(file, line))
+    {
+        std::string name;
+        std::string value;
+        if(!lParseLine(line, name, value))
+        {
+            continue;
+        }
+
+        try
+        {
+            if(name == "warmup_frames")
+            {
+                settings.WarmupFrames = (uint32_t)std::stoul(value);
+            }
+            else if(name == "measure_frames")
+            {
+                settings.MeasureFrames = std::max((uint32_t)std::stoul(value), 1U);
+            }
+            else if(name == "reference_frames")
+            {
+                settings.ReferenceFrames = std::max((uint32_t)std::stoul(value), 1U);
+            }
+            else if(name == "icd")
+            {
+                settings.Icd = value;
+            }
+            else if(name == "budgets")
+            {
+                settings.Budgets.clear();
+                std::stringstream stream(value);
+                std::string       budget;
+                while(std::getline(stream, budget, ','))
+                {
+                    settings.Budgets.push_back(std::max((uint32_t)std::stoul(budget), 1U));
+                }
+            }
+            else if(name.rfind("reference ", 0) == 0)
+            {
+                referenceArguments[lTrim(name.substr(10))] = value;
+            }
+            else if(name.rfind("config ", 0) == 0)
+            {
+                size_t        separator = value.find(' ');
+                Configuration configuration{.Name = lTrim(name.substr(7)), .App = value.substr(0, separator)};
+                configuration.Arguments = separator == std::string::npos ? "" : lTrim(value.substr(separator));
+                if(lAppPath(configuration.App).empty())
+                {
+                    foray::logger()->warn("Benchmark suite \"{}\": unknown app \"{}\" of configuration \"{}\"", path, configuration.App, configuration.Name);
+                    continue;
+                }
+                configurations.push_back(configuration);
+            }
+            else
+            {
+                foray::logger()->warn("Benchmark suite \"{}\": unknown setting \"{}\"", path, name);
+            }
+        }
+        catch(const std::exception&)
+        {
+            foray::logger()->warn("Benchmark suite \"{}\": \"{}\" is not a number or list of numbers", path, value);
+            return false;
+        }
+    }
+
+    mSettings           = settings;
+    mReferenceArguments = referenceArguments;
+    mConfigurations     = configurations;
+    return true;
+}
+
+bool BenchmarkSuite::Run(const std::string& directory)
+{
+    // the apps change their working directory, all paths handed to them are absolute
+    std::filesystem::path outputDirectory = std::filesystem::absolute(directory);
+    std::filesystem::create_directories(outputDirectory);
+
+    if(!mSettings.Icd.empty())
+    {
+        lSetEnvironment("VK_ICD_FILENAMES", mSettings.Icd);
+        lSetEnvironment("VK_DRIVER_FILES", mSettings.Icd);
+    }
+
+    // one converged reference per app that has configurations
+    std::unordered_map<std::string, FloatImage> references;
+    for(const Configuration& configuration : mConfigurations)
+    {
+        if(references.contains(configuration.App))
+        {
+            continue;
+        }
+        FloatImage& reference = references[configuration.App];
+
+        std::string prefix = (outputDirectory / ("reference_" + configuration.App)).string();
+        auto        found  = mReferenceArguments.find(configuration.App);
+        std::string args   = found != mReferenceArguments.end() ? found->second : "";
+        foray::logger()->info("Benchmark suite: reference of {} ({} frames)", configuration.App, mSettings.ReferenceFrames);
+        if(!RunApp(configuration.App, args, prefix, 0, mSettings.ReferenceFrames) || !ReadPfm(prefix + ".pfm", reference))
+        {
+            foray::logger()->warn("Benchmark suite: no reference for {}, its runs are reported without error", configuration.App);
+        }
+    }
+
+    mResults.clear();
+    for(const Configuration& configuration : mConfigurations)
+    {
+        for(uint32_t budget : mSettings.Budgets)
+        {
+            Result& result       = mResults.emplace_back();
+            result.Configuration = configuration.Name;
+            result.App           = configuration.App;
+            result.Budget        = budget;
+
+            std::string prefix = (outputDirectory / (configuration.Name + "_" + std::to_string(budget))).string();
+            std::string args   = lReplaceAll(configuration.Arguments, "{budget}", std::to_string(budget));
+            args               = lReplaceAll(args, "{half_budget}", std::to_string(budget / 2));
+            foray::logger()->info("Benchmark suite: {} at budget {}", configuration.Name, budget);
+
+            if(!RunApp(configuration.App, args, prefix, mSettings.WarmupFrames, mSettings.MeasureFrames) || !ReadRunResult(prefix, result))
+            {
+                foray::logger()->warn("Benchmark suite: {} at budget {} failed", configuration.Name, budget);
+                continue;
+            }
+
+            FloatImage        image;
+            const FloatImage& reference = references[configuration.App];
+            result.Valid = !reference.Empty() && ReadPfm(prefix + ".pfm", image) && image_metrics::Compute(image, reference, result.Metrics);
+            if(!result.Valid)
+            {
+                foray::logger()->warn("Benchmark suite: {} at budget {} could not be compared against the reference", configuration.Name, budget);
+            }
+        }
+    }
+
+    WriteReport((outputDirectory / "benchmark_report.json").string());
+    WriteCsv((outputDirectory / "benchmark_results.csv").string());
+    return std::any_of(mResults.begin(), mResults.end(), [](const Result& result) { return result.Width > 0; });
+}
+
+bool BenchmarkSuite::RunApp(const std::string& app, const std::string& arguments, const std::string& prefix, uint32_t warmupFrames, uint32_t measureFrames) const
+{
+    std::filesystem::remove(prefix + ".txt");
+    std::filesystem::remove(prefix + ".pfm");
+
+    std::stringstream command;
+    command << "\"" << lAppPath(app) << "\" --benchmark \"" << prefix << "\" --benchmark-warmup " << warmupFrames << " --benchmark-frames " << measureFrames << " "
+            << arguments;
+#ifdef _WIN32
+    // cmd.exe strips the outer quotes of the whole line
+    std::string line = "\"" + command.str() + "\"";
+#else
+    std::string line = command.str();
+#endif
+    int exitCode = std::system(line.c_str());
+    if(exitCode != 0)
+    {
+        foray::logger()->warn("Benchmark suite: \"{}\" exited with {}", line, exitCode);
+    }
+    return std::filesystem::exists(prefix + ".txt");
+}
+
+bool BenchmarkSuite::ReadRunResult(const std::string& prefix, Result& result)
+{
+    std::ifstream file(prefix + ".txt");
+    if(!file.is_open())
+    {
+        return false;
+    }
+    std::unordered_map<std::string, std::string> values;
+    std::string                                  line;
+    while(std::getline(file, line))
+    {
+        std::string name;
+        std::string value;
+        if(lParseLine(line, name, value))
+        {
+            values[name] = value;
+        }
+    }
+
+    // a truncated file (crashed or killed run) misses the later keys
+    for(const char* key : {"image_frames", "width", "height", "gpu_ms", "rays_per_frame", "rays_counted"})
+    {
+        if(!values.contains(key))
+        {
+            foray::logger()->warn("Benchmark suite: \"{}.txt\" has no \"{}\"", prefix, key);
+            return false;
+        }
+    }
+    Result parsed = result;
+    try
+    {
+        // runs without a readback report a zero extent
+        if(std::stoul(values["image_frames"]) == 0)
+        {
+            return false;
+        }
+        parsed.Width        = (uint32_t)std::stoul(values["width"]);
+        parsed.Height       = (uint32_t)std::stoul(values["height"]);
+        parsed.GpuMs        = std::stod(values["gpu_ms"]);
+        parsed.RaysPerFrame = std::stod(values["rays_per_frame"]);
+        parsed.RaysCounted  = std::stoul(values["rays_counted"]) != 0;
+    }
+    catch(const std::exception&)
+    {
+        foray::logger()->warn("Benchmark suite: \"{}.txt\" contains a value that is not a number", prefix);
+        return false;
+    }
+    if(!parsed.RaysCounted)
+    {
+        foray::logger()->warn("Benchmark suite: \"{}\" counted no rays (restir_app needs -DRESTIR_STATS=ON), its rays per frame are reported as unknown", prefix);
+    }
+    result = parsed;
+    return true;
+}
+
+void BenchmarkSuite::WriteReport(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::trunc);
+    if(!file.is_open())
+    {
+        foray::logger()->warn("Unable to write benchmark report \"{}\"", path);
+        return;
+    }
+
+    file << "{\n";
+    file << "  \"warmup_frames\": " << mSettings.WarmupFrames << ",\n";
+    file << "  \"measure_frames\": " << mSettings.MeasureFrames << ",\n";
+    file << "  \"reference_frames\": " << mSettings.ReferenceFrames << ",\n";
+    file << "  \"icd\": " << JsonString(mSettings.Icd) << ",\n";
+    file << "  \"configurations\": [";
+    for(size_t i = 0; i < mConfigurations.size(); i++)
+    {
+        const Configuration& configuration = mConfigurations[i];
+        file << (i > 0 ? "," : "") << "\n    {\"name\": " << JsonString(configuration.Name) << ", \"app\": " << JsonString(configuration.App)
+             << ", \"arguments\": " << JsonString(configuration.Arguments) << "}";
+    }
+    file << "\n  ],\n";
+    file << "  \"runs\": [";
+    for(size_t i = 0; i < mResults.size(); i++)
+    {
+        const Result& result = mResults[i];
+        file << (i > 0 ? "," : "") << "\n    {\"configuration\": " << JsonString(result.Configuration) << ", \"app\": " << JsonString(result.App)
+             << ", \"budget\": " << result.Budget << ", \"width\": " << result.Width << ", \"height\": " << result.Height << ", \"gpu_ms\": " << result.GpuMs
+             << ", \"rays_per_frame\": ";
+        if(result.RaysCounted)
+        {
+            file << result.RaysPerFrame;
+        }
+        else
+        {
+            file << "null";
+        }
+        // error fields are null without a comparison
+        if(result.Valid)
+        {
+            file << ", \"rmse\": " << result.Metrics.Rmse << ", \"relmse\": " << result.Metrics.RelMse << ", \"flip\": " << result.Metrics.Flip << "}";
+        }
+        else
+        {
+            file << ", \"rmse\": null, \"relmse\": null, \"flip\": null}";
+        }
+    }
+    file << "\n  ]\n}\n";
+    foray::logger()->info("Wrote benchmark report \"{}\"", path);
+}
+
+void BenchmarkSuite::WriteCsv(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::trunc);
+    if(!file.is_open())
+    {
+        foray::logger()->warn("Unable to write benchmark results \"{}\"", path);
+        return;
+    }
+
+    file << "configuration,app,budget,width,height,gpu ms,rays per frame,rmse,relmse,flip\n";
+    for(const Result& result : mResults)
+    {
+        file << result.Configuration << "," << result.App << "," << result.Budget << "," << result.Width << "," << result.Height << "," << result.GpuMs << ",";
+        if(result.RaysCounted)
+        {
+            file << result.RaysPerFrame << ",";
+        }
+        else
+        {
+            file << "nan,";
+        }
+        if(result.Valid)
+        {
+            file << result.Metrics.Rmse << "," << result.Metrics.RelMse << "," << result.Metrics.Flip << "\n";
+        }
+        else
+        {
+            file << "nan,nan,nan\n";
+        }
+    }
+    foray::logger()->info("Wrote {} benchmark results to \"{}\"", mResults.size(), path);
+}
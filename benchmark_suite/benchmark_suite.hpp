@@ -0,0 +1,72 @@
+#pragma once
+#include "image_metrics.hpp"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// @brief Compares the sampling strategies of both apps by error against time. Every configuration of a suite file is run at
+/// every sample budget as a separate app process (--benchmark, see BenchmarkRun), its output is compared against a converged
+/// reference rendered by the same app, and GPU time, rays and error of all runs are written to benchmark_report.json and
+/// benchmark_results.csv. The apps shade differently, errors are only comparable between configurations of the same app.
+class BenchmarkSuite
+{
+  public:
+    struct Configuration
+    {
+        std::string Name;
+        /// @brief "sampling" or "restir"
+        std::string App;
+        /// @brief App arguments, {budget} is replaced by the sample budget of the run and {half_budget} by half of it (rounded down)
+        std::string Arguments;
+    };
+
+    struct Settings
+    {
+        uint32_t              WarmupFrames    = 32;
+        uint32_t              MeasureFrames   = 32;
+        uint32_t              ReferenceFrames = 1024;
+        std::vector<uint32_t> Budgets{1, 4, 16};
+        /// @brief Vulkan driver manifest passed to the apps (VK_ICD_FILENAMES / VK_DRIVER_FILES), e.g. lavapipe for headless runs
+        std::string Icd;
+    };
+
+    struct Result
+    {
+        std::string       Configuration;
+        std::string       App;
+        uint32_t          Budget       = 0;
+        bool              Valid        = false;
+        uint32_t          Width        = 0;
+        uint32_t          Height       = 0;
+        double            GpuMs        = 0.0;
+        double            RaysPerFrame = 0.0;
+        /// @brief False if the app counted no rays, e.g. restir_app built without RESTIR_STATS
+        bool              RaysCounted  = false;
+        ImageErrorMetrics Metrics{};
+    };
+
+    /// @brief Reads a suite file: settings (warmup_frames, measure_frames, reference_frames, budgets, icd) as "name = value",
+    /// "reference <app> = <arguments>" for the reference of each app and "config <name> = <app> <arguments>" per configuration
+    bool LoadSpec(const std::string& path);
+
+    /// @brief Renders the references and all runs into directory, then writes the report. Fails if no run could be measured.
+    bool Run(const std::string& directory);
+
+    inline const std::vector<Result>& GetResults() const { return mResults; }
+
+  protected:
+    /// @brief Starts the app with the benchmark arguments and waits for it, true if it wrote its result file
+    bool RunApp(const std::string& app, const std::string& arguments, const std::string& prefix, uint32_t warmupFrames, uint32_t measureFrames) const;
+    /// @brief Reads extent, GPU time and rays of the "name = value" result file of a run into result.
+    /// Fails for missing or malformed values and for runs without a readback frame.
+    static bool ReadRunResult(const std::string& prefix, Result& result);
+
+    void WriteReport(const std::string& path) const;
+    void WriteCsv(const std::string& path) const;
+
+    Settings                                     mSettings;
+    std::unordered_map<std::string, std::string> mReferenceArguments;
+    std::vector<Configuration>                   mConfigurations;
+    std::vector<Result>                          mResults;
+};
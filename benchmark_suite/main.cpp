@@ -0,0 +1,18 @@
+#include "benchmark_suite.hpp"
+#include <foray_logger.hpp>
+#include <osi/foray_env.hpp>
+
+/// @brief benchmark_suite [suite file] [output directory], defaults to benchmark_suite.txt and results/ in the suite directory
+int main(int argv, char** args)
+{
+    foray::osi::OverrideCurrentWorkingDirectory(CWD_OVERRIDE);
+    std::string suitePath = argv > 1 ? args[1] : "benchmark_suite.txt";
+    std::string directory = argv > 2 ? args[2] : "results";
+
+    BenchmarkSuite suite;
+    if(!suite.LoadSpec(suitePath))
+    {
+        return 1;
+    }
+    return suite.Run(directory) ? 0 : 1;
+}
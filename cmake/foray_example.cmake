@@ -10,6 +10,8 @@ function (foray_example)
 
     # collect sources
     file(GLOB_RECURSE src "*.cpp")
+    # utilities shared by the examples (frame capture, image files)
+    file(GLOB common_src "${CMAKE_SOURCE_DIR}/common/*.cpp")
     
     # Make sure there are source files, add_executable would otherwise fail
     if (NOT src)
@@ -18,7 +20,7 @@ function (foray_example)
     endif ()
 
     # Declare executable
-    add_executable(${PROJECT_NAME} ${src})
+    add_executable(${PROJECT_NAME} ${src} ${common_src})
     
     # Set strict mode for project only
     set_target_properties(${PROJECT_NAME} PROPERTIES COMPILE_FLAGS ${STRICT_FLAGS})
@@ -48,6 +50,7 @@ function (foray_example)
     	${PROJECT_NAME}
     	PUBLIC "${CMAKE_SOURCE_DIR}/foray/src"
     	PUBLIC "${CMAKE_SOURCE_DIR}/foray/third_party"
+    	PUBLIC "${CMAKE_SOURCE_DIR}/common"
     	PUBLIC ${Vulkan_INCLUDE_DIR}
     )
 endfunction()
@@ -0,0 +1,239 @@
+#include "benchmark_run.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+bool BenchmarkRun::ParseArgument(const std::string& name, const std::string& value, Settings& settings)
+{
+    try
+    {
+        if(name == "--benchmark")
+        {
+            settings.OutputPrefix = value;
+        }
+        else if(name == "--benchmark-warmup")
+        {
+            settings.WarmupFrames = (uint32_t)std::stoul(value);
+        }
+        else if(name == "--benchmark-frames")
+        {
+            settings.MeasureFrames = std::max((uint32_t)std::stoul(value), 1U);
+        }
+        else if(name == "--benchmark-accumulate")
+        {
+            settings.Accumulate = value != "0";
+        }
+        else
+        {
+            return false;
+        }
+    }
+    catch(const std::exception&)
+    {
+        foray::logger()->warn("{}: \"{}\" is not a number, keeping the default", name, value);
+    }
+    return true;
+}
+
+void BenchmarkRun::Init(foray::core::Context* context, FrameCapture* capture, const Settings& settings)
+{
+    mContext  = context;
+    mCapture  = capture;
+    mSettings = settings;
+    if(!IsActive())
+    {
+        return;
+    }
+
+    VkDeviceSize size = mSettings.MeasureFrames * MAX_RAY_COUNTERS * sizeof(uint32_t);
+    mRayReadback.Create(mContext, VK_BUFFER_USAGE_TRANSFER_DST_BIT, size, VMA_MEMORY_USAGE_AUTO_PREFER_HOST, VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT,
+                        "BenchmarkRayReadback");
+    void* mapped = nullptr;
+    mRayReadback.Map(mapped);
+    std::memset(mapped, 0, size);
+    mRayReadbackMapped = reinterpret_cast<const uint32_t*>(mapped);
+
+    foray::logger()->info("Benchmark run \"{}\": {} warmup and {} measured frames{}", mSettings.OutputPrefix, mSettings.WarmupFrames, mSettings.MeasureFrames,
+                          mSettings.Accumulate ? ", accumulated" : "");
+}
+
+void BenchmarkRun::Destroy()
+{
+    if(!IsActive())
+    {
+        return;
+    }
+    WriteResults();
+    if(mRayReadback.Exists())
+    {
+        mRayReadback.Unmap();
+        mRayReadback.Destroy();
+        mRayReadbackMapped = nullptr;
+    }
+    mSettings.OutputPrefix.clear();
+}
+
+void BenchmarkRun::SetInfo(const std::string& name, const std::string& value)
+{
+    mInfo.emplace_back(name, value);
+}
+
+void BenchmarkRun::BeginFrame()
+{
+    if(mFrameBegun)
+    {
+        mFrame++;
+    }
+    mFrameBegun = true;
+    if(IsMeasuring())
+    {
+        mMeasuredFrames++;
+    }
+}
+
+bool BenchmarkRun::IsFinished() const
+{
+    bool measured = mFrame >= mSettings.WarmupFrames + mSettings.MeasureFrames;
+    return IsActive() && measured && mPendingReadbacks == 0 && (mSettings.Accumulate || mRequestedReadbacks > 0);
+}
+
+void BenchmarkRun::AddGpuMs(float ms)
+{
+    if(IsMeasuring())
+    {
+        mGpuMsSum += ms;
+        mGpuMsFrames++;
+    }
+}
+
+void BenchmarkRun::AddRays(uint64_t rays)
+{
+    if(IsMeasuring())
+    {
+        mHostRays += rays;
+        mHasHostRays = true;
+    }
+}
+
+void BenchmarkRun::CmdCopyRayCounter(VkCommandBuffer cmdBuffer, VkBuffer counterBuffer, VkDeviceSize offset, uint32_t counterCount)
+{
+    if(!IsMeasuring())
+    {
+        return;
+    }
+
+    VkMemoryBarrier copyBarrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER, .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT, .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT};
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1,
+                         &copyBarrier, 0, nullptr, 0, nullptr);
+
+    counterCount = std::clamp(counterCount, 1U, MAX_RAY_COUNTERS);
+    VkBufferCopy region{.srcOffset = offset,
+                        .dstOffset = (mFrame - mSettings.WarmupFrames) * MAX_RAY_COUNTERS * sizeof(uint32_t),
+                        .size      = counterCount * sizeof(uint32_t)};
+    vkCmdCopyBuffer(cmdBuffer, counterBuffer, mRayReadback.GetBuffer(), 1, &region);
+
+    VkMemoryBarrier hostBarrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER, .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT, .dstAccessMask = VK_ACCESS_HOST_READ_BIT};
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0, nullptr, 0, nullptr);
+    mHasRayCounter = true;
+}
+
+void BenchmarkRun::CmdCaptureOutput(VkCommandBuffer cmdBuffer, foray::base::FrameRenderInfo& renderInfo, foray::core::ManagedImage* image)
+{
+    if(!IsActive())
+    {
+        return;
+    }
+
+    // accumulation skips frames without a free staging buffer, the single readback is retried on the following frames
+    uint32_t lastFrame = mSettings.WarmupFrames + mSettings.MeasureFrames - 1;
+    bool     capture   = mSettings.Accumulate ? IsMeasuring() : mFrame >= lastFrame && mRequestedReadbacks == 0;
+    if(!capture)
+    {
+        return;
+    }
+
+    mPendingReadbacks++;
+    if(mCapture->CmdReadback(cmdBuffer, renderInfo, image, [this](FloatImage& image, uint64_t) {
+           AddImage(image);
+           mPendingReadbacks--;
+       }))
+    {
+        mRequestedReadbacks++;
+    }
+    else
+    {
+        mPendingReadbacks--;
+    }
+}
+
+void BenchmarkRun::AddImage(const FloatImage& image)
+{
+    std::lock_guard<std::mutex> lock(mImageMutex);
+    if(mImageSum.Empty())
+    {
+        mImageSum.Resize(image.Width, image.Height);
+        std::fill(mImageSum.Rgb.begin(), mImageSum.Rgb.end(), 0.f);
+    }
+    if(image.Width != mImageSum.Width || image.Height != mImageSum.Height)
+    {
+        // resized during the measurement, keep the first extent
+        return;
+    }
+    for(size_t i = 0; i < image.Rgb.size(); i++)
+    {
+        mImageSum.Rgb[i] += image.Rgb[i];
+    }
+    mImageCount++;
+}
+
+void BenchmarkRun::WriteResults()
+{
+    std::lock_guard<std::mutex> lock(mImageMutex);
+
+    std::string imagePath = mSettings.OutputPrefix + ".pfm";
+    if(mImageCount > 0)
+    {
+        float scale = 1.f / (float)mImageCount;
+        for(float& value : mImageSum.Rgb)
+        {
+            value *= scale;
+        }
+        if(!WritePfm(imagePath, mImageSum))
+        {
+            foray::logger()->warn("Benchmark run: unable to write \"{}\"", imagePath);
+        }
+    }
+
+    // the device is idle, every recorded counter copy has completed
+    uint64_t rays = mHostRays;
+    if(mHasRayCounter)
+    {
+        // unused counter slots stay zero
+        for(uint32_t i = 0; i < mMeasuredFrames * MAX_RAY_COUNTERS; i++)
+        {
+            rays += mRayReadbackMapped[i];
+        }
+    }
+
+    std::string   resultPath = mSettings.OutputPrefix + ".txt";
+    std::ofstream file(resultPath, std::ios::trunc);
+    if(!file.is_open())
+    {
+        foray::logger()->warn("Benchmark run: unable to write \"{}\"", resultPath);
+        return;
+    }
+    for(const auto& [name, value] : mInfo)
+    {
+        file << name << " = " << value << "\n";
+    }
+    file << "width = " << mImageSum.Width << "\n";
+    file << "height = " << mImageSum.Height << "\n";
+    file << "warmup_frames = " << mSettings.WarmupFrames << "\n";
+    file << "measured_frames = " << mMeasuredFrames << "\n";
+    file << "gpu_ms = " << (mGpuMsFrames > 0 ? mGpuMsSum / mGpuMsFrames : 0.0) << "\n";
+    file << "rays_per_frame = " << (mMeasuredFrames > 0 ? (double)rays / mMeasuredFrames : 0.0) << "\n";
+    file << "rays_counted = " << (mHasHostRays || mHasRayCounter ? 1 : 0) << "\n";
+    file << "image_frames = " << mImageCount << "\n";
+    file << "image = " << (mImageCount > 0 ? imagePath : "") << "\n";
+    foray::logger()->info("Benchmark run written to \"{}\"", resultPath);
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "float_image.hpp"
+#include "frame_capture.hpp"
+#include <atomic>
+#include <foray_api.hpp>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// @brief One measurement of the benchmark suite (benchmark_suite/) inside an app. After WarmupFrames, the GPU time and the
+/// rays cast are recorded for MeasureFrames frames and the output of the last measured frame (or the average of all of them,
+/// for converged references) is read back. <prefix>.pfm and <prefix>.txt ("name = value" lines) are written on Destroy,
+/// the app stops its render loop once IsFinished() returns true. rays_counted = 0 in the result file marks runs that
+/// reported no rays at all (neither AddRays nor CmdCopyRayCounter), their rays_per_frame is meaningless.
+class BenchmarkRun
+{
+  public:
+    struct Settings
+    {
+        /// @brief Output path without extension, empty disables the run
+        std::string OutputPrefix;
+        uint32_t    WarmupFrames  = 32;
+        uint32_t    MeasureFrames = 32;
+        /// @brief Average the output of all measured frames instead of keeping the last one
+        bool Accumulate = false;
+    };
+
+    /// @brief Handles --benchmark <prefix>, --benchmark-warmup N, --benchmark-frames N and --benchmark-accumulate 0|1.
+    /// Returns false if name is none of them.
+    static bool ParseArgument(const std::string& name, const std::string& value, Settings& settings);
+
+    /// @brief Readbacks go through capture, which has to outlive the measurement
+    void Init(foray::core::Context* context, FrameCapture* capture, const Settings& settings);
+    /// @brief Writes the result files. Call with the device idle and after FrameCapture::Destroy, which waits for the readbacks.
+    void Destroy();
+    inline bool IsActive() const { return !mSettings.OutputPrefix.empty(); }
+
+    /// @brief Additional "name = value" line of the result file, e.g. the configuration
+    void SetInfo(const std::string& name, const std::string& value);
+
+    /// @brief Advances the frame count. Call once per frame before recording.
+    void BeginFrame();
+    inline bool IsMeasuring() const { return IsActive() && mFrame >= mSettings.WarmupFrames && mFrame < mSettings.WarmupFrames + mSettings.MeasureFrames; }
+    /// @brief True once every measured frame is recorded and every readback has completed
+    bool IsFinished() const;
+
+    /// @brief GPU time of this measured frame. Timer results read back with a latency shorter than the warmup are fine.
+    void AddGpuMs(float ms);
+    /// @brief Rays of this measured frame known on the host, e.g. one primary ray per pixel
+    void AddRays(uint64_t rays);
+    /// @brief Up to this many consecutive counters are summed by CmdCopyRayCounter
+    static constexpr uint32_t MAX_RAY_COUNTERS = 4;
+    /// @brief Records the copy of counterCount consecutive 32 bit device ray counters of this measured frame, their sum is
+    /// the ray count. Shader writes to the counters are made visible by the copy, they must not be cleared before it executes.
+    void CmdCopyRayCounter(VkCommandBuffer cmdBuffer, VkBuffer counterBuffer, VkDeviceSize offset, uint32_t counterCount = 1);
+    /// @brief Records the readback of the measured output (every measured frame when accumulating, else the last)
+    void CmdCaptureOutput(VkCommandBuffer cmdBuffer, foray::base::FrameRenderInfo& renderInfo, foray::core::ManagedImage* image);
+
+  protected:
+    /// @brief Runs on a capture worker
+    void AddImage(const FloatImage& image);
+    void WriteResults();
+
+    foray::core::Context* mContext = nullptr;
+    FrameCapture*         mCapture = nullptr;
+    Settings              mSettings;
+
+    uint32_t mFrame          = 0;
+    bool     mFrameBegun     = false;
+    uint32_t mMeasuredFrames = 0;
+
+    double   mGpuMsSum      = 0.0;
+    uint32_t mGpuMsFrames   = 0;
+    uint64_t mHostRays      = 0;
+    bool     mHasHostRays   = false;
+    bool     mHasRayCounter = false;
+
+    /// @brief MAX_RAY_COUNTERS 32 bit ray counts per measured frame, read after the device is idle
+    foray::core::ManagedBuffer mRayReadback;
+    const uint32_t*            mRayReadbackMapped = nullptr;
+
+    std::atomic<uint32_t> mPendingReadbacks{0};
+    uint32_t              mRequestedReadbacks = 0;
+    /// @brief Guards the image sum, written by capture workers
+    std::mutex mImageMutex;
+    FloatImage mImageSum;
+    uint32_t   mImageCount = 0;
+
+    std::vector<std::pair<std::string, std::string>> mInfo;
+};
@@ -0,0 +1,377 @@
+#include "float_image.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+void FloatImage::Resize(uint32_t width, uint32_t height)
+{
+    Width  = width;
+    Height = height;
+    Rgb.resize(PixelCount() * 3);
+}
+
+bool WritePfm(const std::string& path, const FloatImage& image)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if(!file.is_open())
+    {
+        return false;
+    }
+
+    // negative scale = little endian
+    bool littleEndian = std::endian::native == std::endian::little;
+    file << "PF\n" << image.Width << " " << image.Height << "\n" << (littleEndian ? "-1.0" : "1.0") << "\n";
+
+    // pfm stores rows bottom to top
+    size_t rowSize = (size_t)image.Width * 3;
+    for(uint32_t y = image.Height; y-- > 0;)
+    {
+        file.write(reinterpret_cast<const char*>(image.Rgb.data() + y * rowSize), rowSize * sizeof(float));
+    }
+    return (bool)file;
+}
+
+bool ReadPfm(const std::string& path, FloatImage& image)
+{
+    std::ifstream file(path, std::ios::binary);
+    if(!file.is_open())
+    {
+        return false;
+    }
+
+    std::string magic;
+    uint32_t    width = 0, height = 0;
+    float       scale = 0.f;
+    file >> magic >> width >> height >> scale;
+    file.get();  // single whitespace before the raster
+    if(!file || magic != "PF" || width == 0 || height == 0)
+    {
+        return false;
+    }
+
+    image.Resize(width, height);
+    size_t rowSize = (size_t)width * 3;
+    for(uint32_t y = height; y-- > 0;)
+    {
+        file.read(reinterpret_cast<char*>(image.Rgb.data() + y * rowSize), rowSize * sizeof(float));
+    }
+    if(!file)
+    {
+        return false;
+    }
+
+    bool fileLittleEndian = scale < 0.f;
+    if(fileLittleEndian != (std::endian::native == std::endian::little))
+    {
+        for(float& value : image.Rgb)
+        {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            bits = ((bits & 0xFFu) << 24) | ((bits & 0xFF00u) << 8) | ((bits >> 8) & 0xFF00u) | (bits >> 24);
+            std::memcpy(&value, &bits, sizeof(bits));
+        }
+    }
+    return true;
+}
+
+namespace {
+    template <typename T>
+    void WriteLe(std::ofstream& file, T value)
+    {
+        uint8_t bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        if constexpr(std::endian::native == std::endian::big)
+        {
+            std::reverse(std::begin(bytes), std::end(bytes));
+        }
+        file.write(reinterpret_cast<const char*>(bytes), sizeof(T));
+    }
+
+    void WriteExrAttribute(std::ofstream& file, const char* name, const char* type, int32_t size)
+    {
+        file.write(name, std::strlen(name) + 1);
+        file.write(type, std::strlen(type) + 1);
+        WriteLe<int32_t>(file, size);
+    }
+
+    void AppendBe32(std::vector<uint8_t>& out, uint32_t value)
+    {
+        out.push_back((uint8_t)(value >> 24));
+        out.push_back((uint8_t)(value >> 16));
+        out.push_back((uint8_t)(value >> 8));
+        out.push_back((uint8_t)value);
+    }
+
+    uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+    {
+        static const std::array<uint32_t, 256> table = []() {
+            std::array<uint32_t, 256> t{};
+            for(uint32_t n = 0; n < 256; n++)
+            {
+                uint32_t c = n;
+                for(int k = 0; k < 8; k++)
+                {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                t[n] = c;
+            }
+            return t;
+        }();
+
+        crc = ~crc;
+        for(size_t i = 0; i < size; i++)
+        {
+            crc = table[(crc ^ data[i]) & 0xFFu] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    void WritePngChunk(std::ofstream& file, const char type[4], const std::vector<uint8_t>& data)
+    {
+        std::vector<uint8_t> chunk;
+        chunk.reserve(data.size() + 12);
+        AppendBe32(chunk, (uint32_t)data.size());
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), data.begin(), data.end());
+        AppendBe32(chunk, Crc32(chunk.data() + 4, data.size() + 4));
+        file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+    }
+
+    uint8_t LinearToSrgb8(float value)
+    {
+        value       = std::clamp(value, 0.f, 1.f);
+        float srgb  = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - 0.055f;
+        return (uint8_t)(srgb * 255.f + 0.5f);
+    }
+}  // namespace
+
+uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign     = (bits >> 16) & 0x8000u;
+    int32_t  exponent = (int32_t)((bits >> 23) & 0xFFu) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFFu;
+
+    if(((bits >> 23) & 0xFFu) == 0xFFu)
+    {
+        // inf / nan
+        return (uint16_t)(sign | 0x7C00u | (mantissa ? 0x200u : 0u));
+    }
+    if(exponent >= 0x1F)
+    {
+        return (uint16_t)(sign | 0x7C00u);
+    }
+    if(exponent <= 0)
+    {
+        if(exponent < -10)
+        {
+            return (uint16_t)sign;
+        }
+        // subnormal, shift in the implicit bit
+        mantissa |= 0x800000u;
+        uint32_t shift   = (uint32_t)(14 - exponent);
+        uint32_t half    = mantissa >> shift;
+        uint32_t rest    = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if(rest > halfway || (rest == halfway && (half & 1u)))
+        {
+            half++;
+        }
+        return (uint16_t)(sign | half);
+    }
+
+    uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1FFFu;
+    if(rest > 0x1000u || (rest == 0x1000u && (half & 1u)))
+    {
+        half++;  // may carry into the exponent, which rounds up to the next power of two / inf as intended
+    }
+    return (uint16_t)half;
+}
+
+float HalfToFloat(uint16_t half)
+{
+    uint32_t sign     = (uint32_t)(half & 0x8000u) << 16;
+    uint32_t exponent = (half >> 10) & 0x1Fu;
+    uint32_t mantissa = half & 0x3FFu;
+
+    uint32_t bits;
+    if(exponent == 0)
+    {
+        if(mantissa == 0)
+        {
+            bits = sign;
+        }
+        else
+        {
+            // subnormal, renormalize
+            exponent = 127 - 15 + 1;
+            while((mantissa & 0x400u) == 0)
+            {
+                mantissa <<= 1;
+                exponent--;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3FFu) << 13);
+        }
+    }
+    else if(exponent == 0x1F)
+    {
+        bits = sign | 0x7F800000u | (mantissa << 13);
+    }
+    else
+    {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+bool WriteExr(const std::string& path, const FloatImage& image)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if(!file.is_open() || image.Empty())
+    {
+        return false;
+    }
+
+    // magic, version 2, single part scanline
+    WriteLe<uint32_t>(file, 20000630u);
+    WriteLe<uint32_t>(file, 2u);
+
+    // channels are stored in alphabetical order
+    const char* channels[3] = {"B", "G", "R"};
+    WriteExrAttribute(file, "channels", "chlist", 3 * 18 + 1);
+    for(const char* channel : channels)
+    {
+        file.write(channel, 2);
+        WriteLe<int32_t>(file, 1);  // HALF
+        WriteLe<uint32_t>(file, 0);  // pLinear + reserved
+        WriteLe<int32_t>(file, 1);  // x sampling
+        WriteLe<int32_t>(file, 1);  // y sampling
+    }
+    file.put(0);
+
+    WriteExrAttribute(file, "compression", "compression", 1);
+    file.put(0);  // NO_COMPRESSION
+
+    for(const char* window : {"dataWindow", "displayWindow"})
+    {
+        WriteExrAttribute(file, window, "box2i", 16);
+        WriteLe<int32_t>(file, 0);
+        WriteLe<int32_t>(file, 0);
+        WriteLe<int32_t>(file, (int32_t)image.Width - 1);
+        WriteLe<int32_t>(file, (int32_t)image.Height - 1);
+    }
+
+    WriteExrAttribute(file, "lineOrder", "lineOrder", 1);
+    file.put(0);  // INCREASING_Y
+    WriteExrAttribute(file, "pixelAspectRatio", "float", 4);
+    WriteLe<float>(file, 1.f);
+    WriteExrAttribute(file, "screenWindowCenter", "v2f", 8);
+    WriteLe<float>(file, 0.f);
+    WriteLe<float>(file, 0.f);
+    WriteExrAttribute(file, "screenWindowWidth", "float", 4);
+    WriteLe<float>(file, 1.f);
+    file.put(0);  // end of header
+
+    // offset table, one uncompressed scanline per block
+    uint64_t lineSize   = (uint64_t)image.Width * 3 * sizeof(uint16_t);
+    uint64_t blockSize  = lineSize + 8;
+    uint64_t dataOffset = (uint64_t)file.tellp() + (uint64_t)image.Height * sizeof(uint64_t);
+    for(uint32_t y = 0; y < image.Height; y++)
+    {
+        WriteLe<uint64_t>(file, dataOffset + y * blockSize);
+    }
+
+    std::vector<uint16_t> line((size_t)image.Width * 3);
+    for(uint32_t y = 0; y < image.Height; y++)
+    {
+        const float* row = image.Rgb.data() + (size_t)y * image.Width * 3;
+        for(uint32_t c = 0; c < 3; c++)
+        {
+            uint32_t source = 2 - c;  // B, G, R
+            for(uint32_t x = 0; x < image.Width; x++)
+            {
+                line[(size_t)c * image.Width + x] = FloatToHalf(row[(size_t)x * 3 + source]);
+            }
+        }
+
+        WriteLe<int32_t>(file, (int32_t)y);
+        WriteLe<int32_t>(file, (int32_t)lineSize);
+        for(uint16_t value : line)
+        {
+            WriteLe<uint16_t>(file, value);
+        }
+    }
+    return (bool)file;
+}
+
+bool WritePng(const std::string& path, const FloatImage& image)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if(!file.is_open() || image.Empty())
+    {
+        return false;
+    }
+
+    const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+    std::vector<uint8_t> header;
+    AppendBe32(header, image.Width);
+    AppendBe32(header, image.Height);
+    header.insert(header.end(), {8, 2, 0, 0, 0});  // 8 bit, truecolor, deflate, adaptive filtering, no interlace
+    WritePngChunk(file, "IHDR", header);
+
+    // raw scanlines, filter type none
+    size_t               rowSize = (size_t)image.Width * 3 + 1;
+    std::vector<uint8_t> raw(rowSize * image.Height);
+    for(uint32_t y = 0; y < image.Height; y++)
+    {
+        uint8_t*     dst = raw.data() + y * rowSize;
+        const float* src = image.Rgb.data() + (size_t)y * image.Width * 3;
+        dst[0]           = 0;
+        for(size_t i = 0; i < (size_t)image.Width * 3; i++)
+        {
+            dst[i + 1] = LinearToSrgb8(src[i]);
+        }
+    }
+
+    // zlib stream of stored deflate blocks
+    std::vector<uint8_t> zlib;
+    zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+    uint32_t adlerA = 1, adlerB = 0;
+    for(size_t offset = 0;;)
+    {
+        uint16_t length = (uint16_t)std::min<size_t>(raw.size() - offset, 65535);
+        bool     last   = offset + length >= raw.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back((uint8_t)length);
+        zlib.push_back((uint8_t)(length >> 8));
+        zlib.push_back((uint8_t)~length);
+        zlib.push_back((uint8_t)(~length >> 8));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+        for(size_t i = offset; i < offset + length; i++)
+        {
+            adlerA = (adlerA + raw[i]) % 65521u;
+            adlerB = (adlerB + adlerA) % 65521u;
+        }
+        offset += length;
+        if(last)
+        {
+            break;
+        }
+    }
+    AppendBe32(zlib, (adlerB << 16) | adlerA);
+    WritePngChunk(file, "IDAT", zlib);
+    WritePngChunk(file, "IEND", {});
+    return (bool)file;
+}
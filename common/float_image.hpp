@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// @brief Linear RGB float image on the CPU, rows top to bottom, channels interleaved
+struct FloatImage
+{
+    uint32_t           Width  = 0;
+    uint32_t           Height = 0;
+    std::vector<float> Rgb;
+
+    inline bool   Empty() const { return Rgb.empty(); }
+    inline size_t PixelCount() const { return (size_t)Width * Height; }
+    void          Resize(uint32_t width, uint32_t height);
+};
+
+/// @brief Portable float map (binary "PF" variant), lossless for the linear HDR output of the stages
+bool WritePfm(const std::string& path, const FloatImage& image);
+bool ReadPfm(const std::string& path, FloatImage& image);
+
+/// @brief Single part scanline OpenEXR, uncompressed half float B/G/R channels
+bool WriteExr(const std::string& path, const FloatImage& image);
+
+/// @brief 8 bit sRGB png of the clamped linear values. The zlib stream uses stored blocks, trading file size for encode time.
+bool WritePng(const std::string& path, const FloatImage& image);
+
+/// @brief IEEE 754 binary16 conversions (round to nearest even)
+uint16_t FloatToHalf(float value);
+float    HalfToFloat(uint16_t half);
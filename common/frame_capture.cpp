@@ -0,0 +1,353 @@
+#include "frame_capture.hpp"
+#include <cctype>
+#include <imgui/imgui.h>
+
+namespace {
+    uint32_t BytesPerTexel(VkFormat format)
+    {
+        switch(format)
+        {
+            case VK_FORMAT_R16G16B16A16_SFLOAT:
+                return 8;
+            case VK_FORMAT_R32G32B32A32_SFLOAT:
+                return 16;
+            default:
+                return 0;
+        }
+    }
+
+    std::string FileNameFromOutput(std::string_view outputName)
+    {
+        std::string name(outputName);
+        for(char& c : name)
+        {
+            if(!std::isalnum((unsigned char)c))
+            {
+                c = '_';
+            }
+        }
+        return name;
+    }
+}  // namespace
+
+bool ConvertTexelsToFloatImage(const void* texels, VkFormat format, VkExtent2D extent, bool flipY, FloatImage& out)
+{
+    if(BytesPerTexel(format) == 0)
+    {
+        return false;
+    }
+
+    out.Resize(extent.width, extent.height);
+    for(uint32_t y = 0; y < extent.height; y++)
+    {
+        size_t srcRow = (size_t)(flipY ? extent.height - 1 - y : y) * extent.width * 4;
+        float* dst    = out.Rgb.data() + (size_t)y * extent.width * 3;
+        for(uint32_t x = 0; x < extent.width; x++)
+        {
+            size_t src = srcRow + (size_t)x * 4;
+            for(uint32_t c = 0; c < 3; c++)
+            {
+                dst[x * 3 + c] = format == VK_FORMAT_R32G32B32A32_SFLOAT ? reinterpret_cast<const float*>(texels)[src + c]
+                                                                         : HalfToFloat(reinterpret_cast<const uint16_t*>(texels)[src + c]);
+            }
+        }
+    }
+    return true;
+}
+
+#pragma region Lifetime
+
+void FrameCapture::Init(foray::core::Context* context, const std::string& directory, uint32_t ringSize, uint32_t threadCount)
+{
+    mContext   = context;
+    mDirectory = directory;
+
+    mSlots.resize(std::max(ringSize, 1u));
+    for(auto& slot : mSlots)
+    {
+        slot = std::make_unique<Slot>();
+        VkEventCreateInfo eventCi{.sType = VK_STRUCTURE_TYPE_EVENT_CREATE_INFO};
+        foray::AssertVkResult(vkCreateEvent(mContext->Device(), &eventCi, nullptr, &slot->CopyDone));
+    }
+
+    mShutdown = false;
+    for(uint32_t i = 0; i < std::max(threadCount, 1u); i++)
+    {
+        mWorkers.emplace_back(&FrameCapture::WorkerLoop, this);
+    }
+}
+
+void FrameCapture::Destroy()
+{
+    if(!mContext)
+    {
+        return;
+    }
+
+    // let every recorded copy finish, then drain the encodes
+    vkDeviceWaitIdle(mContext->Device());
+    Update();
+    WaitForWorkers();
+
+    {
+        std::lock_guard<std::mutex> lock(mJobsMutex);
+        mShutdown = true;
+    }
+    mJobsCondition.notify_all();
+    for(std::thread& worker : mWorkers)
+    {
+        worker.join();
+    }
+    mWorkers.clear();
+
+    for(auto& slot : mSlots)
+    {
+        if(slot->Staging.Exists())
+        {
+            slot->Staging.Unmap();
+            slot->Staging.Destroy();
+        }
+        vkDestroyEvent(mContext->Device(), slot->CopyDone, nullptr);
+    }
+    mSlots.clear();
+    mActive  = false;
+    mContext = nullptr;
+}
+
+#pragma endregion
+#pragma region Workers
+
+void FrameCapture::Enqueue(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mJobsMutex);
+        mJobs.push_back(std::move(job));
+    }
+    mJobsCondition.notify_one();
+}
+
+void FrameCapture::WorkerLoop()
+{
+    while(true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mJobsMutex);
+            mJobsCondition.wait(lock, [this]() { return mShutdown || !mJobs.empty(); });
+            if(mJobs.empty())
+            {
+                return;
+            }
+            job = std::move(mJobs.front());
+            mJobs.pop_front();
+            mBusyWorkers++;
+        }
+
+        job();
+
+        {
+            std::lock_guard<std::mutex> lock(mJobsMutex);
+            mBusyWorkers--;
+        }
+        mJobsDone.notify_all();
+    }
+}
+
+void FrameCapture::WaitForWorkers()
+{
+    std::unique_lock<std::mutex> lock(mJobsMutex);
+    mJobsDone.wait(lock, [this]() { return mJobs.empty() && mBusyWorkers == 0; });
+}
+
+#pragma endregion
+#pragma region Readback
+
+void FrameCapture::Update()
+{
+    for(auto& slotPtr : mSlots)
+    {
+        Slot* slot = slotPtr.get();
+        if(slot->State != ESlotState::InFlight || vkGetEventStatus(mContext->Device(), slot->CopyDone) != VK_EVENT_SET)
+        {
+            continue;
+        }
+
+        foray::AssertVkResult(vkResetEvent(mContext->Device(), slot->CopyDone));
+        slot->State = ESlotState::Converting;
+        Enqueue([slot, flipY = mFlipY]() {
+            FloatImage image;
+            if(ConvertTexelsToFloatImage(slot->Mapped, slot->Format, slot->Extent, flipY, image))
+            {
+                // the staging buffer is reusable as soon as the texels are converted
+                Callback callback = std::move(slot->OnComplete);
+                uint64_t frame    = slot->Frame;
+                slot->State       = ESlotState::Free;
+                callback(image, frame);
+            }
+            else
+            {
+                slot->OnComplete = nullptr;
+                slot->State      = ESlotState::Free;
+            }
+        });
+    }
+}
+
+bool FrameCapture::CmdReadback(VkCommandBuffer cmdBuffer, foray::base::FrameRenderInfo& renderInfo, foray::core::ManagedImage* image, Callback callback)
+{
+    if(BytesPerTexel(image->GetFormat()) == 0)
+    {
+        foray::logger()->warn("Frame capture: unsupported format {}", (int32_t)image->GetFormat());
+        return false;
+    }
+
+    Slot* slot = nullptr;
+    for(auto& candidate : mSlots)
+    {
+        if(candidate->State == ESlotState::Free)
+        {
+            slot = candidate.get();
+            break;
+        }
+    }
+    if(!slot)
+    {
+        mDroppedCount++;
+        return false;
+    }
+
+    VkExtent3D   extent = image->GetExtent3D();
+    VkDeviceSize size   = (VkDeviceSize)extent.width * extent.height * BytesPerTexel(image->GetFormat());
+    if(!slot->Staging.Exists() || slot->Staging.GetSize() < size)
+    {
+        if(slot->Staging.Exists())
+        {
+            slot->Staging.Unmap();
+            slot->Staging.Destroy();
+        }
+        slot->Staging.Create(mContext, VK_BUFFER_USAGE_TRANSFER_DST_BIT, size, VMA_MEMORY_USAGE_AUTO_PREFER_HOST, VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT,
+                             "FrameCaptureStaging");
+        slot->Staging.Map(slot->Mapped);
+    }
+
+    foray::core::ImageLayoutCache::Barrier barrier;
+    barrier.SrcAccessMask               = VK_ACCESS_MEMORY_WRITE_BIT;
+    barrier.DstAccessMask               = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.NewLayout                   = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.SubresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    renderInfo.GetImageLayoutCache().CmdBarrier(cmdBuffer, image, barrier, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    VkBufferImageCopy region{.bufferOffset      = 0,
+                             .bufferRowLength   = 0,
+                             .bufferImageHeight = 0,
+                             .imageSubresource  = VkImageSubresourceLayers{VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+                             .imageOffset       = VkOffset3D{},
+                             .imageExtent       = extent};
+    vkCmdCopyImageToBuffer(cmdBuffer, image->GetImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot->Staging.GetBuffer(), 1, &region);
+
+    VkBufferMemoryBarrier hostBarrier{.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+                                      .srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+                                      .dstAccessMask       = VK_ACCESS_HOST_READ_BIT,
+                                      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                      .buffer              = slot->Staging.GetBuffer(),
+                                      .offset              = 0,
+                                      .size                = size};
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &hostBarrier, 0, nullptr);
+
+    // polled by Update() on later frames, the frame's fence belongs to the render loop
+    vkCmdSetEvent(cmdBuffer, slot->CopyDone, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    slot->Extent     = VkExtent2D{extent.width, extent.height};
+    slot->Format     = image->GetFormat();
+    slot->Frame      = renderInfo.GetFrameNumber();
+    slot->OnComplete = std::move(callback);
+    slot->State      = ESlotState::InFlight;
+    return true;
+}
+
+#pragma endregion
+#pragma region Capture
+
+void FrameCapture::Start(const Settings& settings)
+{
+    mSettings          = settings;
+    mActive            = true;
+    mStartFramePending = true;
+    mCapturedInRun     = 0;
+}
+
+void FrameCapture::Stop()
+{
+    mActive = false;
+}
+
+void FrameCapture::CmdCapture(VkCommandBuffer cmdBuffer, foray::base::FrameRenderInfo& renderInfo, foray::core::ManagedImage* image, std::string_view outputName)
+{
+    if(!mActive)
+    {
+        return;
+    }
+
+    uint64_t frame = renderInfo.GetFrameNumber();
+    if(mStartFramePending)
+    {
+        mStartFrame        = frame;
+        mStartFramePending = false;
+    }
+    if(mSettings.Mode == EMode::EveryNth && (frame - mStartFrame) % std::max(mSettings.Interval, 1u) != 0)
+    {
+        return;
+    }
+
+    std::string path = mDirectory + "/" + FileNameFromOutput(outputName) + "_" + std::to_string(frame) + (mSettings.Format == EFileFormat::Exr ? ".exr" : ".png");
+    CmdReadback(cmdBuffer, renderInfo, image, [this, path, format = mSettings.Format](FloatImage& captured, uint64_t) {
+        bool written = format == EFileFormat::Exr ? WriteExr(path, captured) : WritePng(path, captured);
+        if(written)
+        {
+            mWrittenCount++;
+        }
+        else
+        {
+            foray::logger()->warn("Frame capture: unable to write \"{}\"", path);
+        }
+    });
+
+    mCapturedInRun++;
+    if(mSettings.Mode == EMode::Single || (mSettings.Mode == EMode::Sequence && mCapturedInRun >= mSettings.SequenceLength))
+    {
+        mActive = false;
+    }
+}
+
+void FrameCapture::ImguiControls()
+{
+    const char* formats[] = {"EXR", "PNG"};
+    const char* modes[]   = {"Single frame", "Sequence", "Every Nth frame"};
+    ImGui::Combo("Capture format", (int*)(&mUiSettings.Format), formats, 2);
+    ImGui::Combo("Capture mode", (int*)(&mUiSettings.Mode), modes, 3);
+    if(mUiSettings.Mode == EMode::Sequence)
+    {
+        ImGui::InputInt("Frames", (int*)(&mUiSettings.SequenceLength));
+    }
+    else if(mUiSettings.Mode == EMode::EveryNth)
+    {
+        ImGui::InputInt("Interval", (int*)(&mUiSettings.Interval));
+    }
+
+    if(!mActive)
+    {
+        if(ImGui::Button("Capture"))
+        {
+            Start(mUiSettings);
+        }
+    }
+    else if(ImGui::Button("Stop capture"))
+    {
+        Stop();
+    }
+    ImGui::SameLine();
+    ImGui::Text("written: %llu dropped: %llu", (unsigned long long)mWrittenCount.load(), (unsigned long long)mDroppedCount.load());
+}
+
+#pragma endregion
@@ -0,0 +1,126 @@
+#pragma once
+#include "float_image.hpp"
+#include <foray_api.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/// @brief Non-stalling readback of output images. Copies are recorded into a ring of host visible staging buffers,
+/// their completion is polled on later frames (an event set after the copy), and conversion / encoding runs on a
+/// small pool of worker threads. If every staging buffer is busy, the capture of that frame is dropped instead of waiting.
+class FrameCapture
+{
+  public:
+    enum class EFileFormat
+    {
+        Exr,
+        Png,
+    };
+
+    enum class EMode
+    {
+        /// @brief The next frame
+        Single,
+        /// @brief SequenceLength consecutive frames
+        Sequence,
+        /// @brief Every Interval-th frame until stopped
+        EveryNth,
+    };
+
+    struct Settings
+    {
+        EFileFormat Format         = EFileFormat::Exr;
+        EMode       Mode           = EMode::Single;
+        uint32_t    SequenceLength = 60;
+        uint32_t    Interval       = 30;
+    };
+
+    /// @brief Receives the converted image (rows top to bottom) and the frame number of the copy, called on a worker thread
+    using Callback = std::function<void(FloatImage& image, uint64_t frameNumber)>;
+
+    /// @brief Captured files are written to directory as <output name>_<frame number>.<exr|png>
+    void Init(foray::core::Context* context, const std::string& directory, uint32_t ringSize = 4, uint32_t threadCount = 2);
+    /// @brief Waits for outstanding copies and encodes, then releases all resources
+    void Destroy();
+
+    /// @brief Polls the copies recorded in earlier frames and hands the finished ones to the workers. Call once per frame before recording.
+    void Update();
+
+    /// @brief Flip the rows of captured images, for stages that render upside down and flip when blitting to the swapchain
+    inline void SetFlipY(bool flipY) { mFlipY = flipY; }
+
+    /// @brief Starts a capture according to settings with the next recorded frame
+    void Start(const Settings& settings);
+    void Stop();
+    inline bool IsCapturing() const { return mActive; }
+
+    /// @brief Records the copy of image if the active capture includes this frame
+    void CmdCapture(VkCommandBuffer cmdBuffer, foray::base::FrameRenderInfo& renderInfo, foray::core::ManagedImage* image, std::string_view outputName);
+
+    /// @brief Records a copy of image whose conversion is passed to callback. Returns false if the format is unsupported or no staging buffer is free.
+    bool CmdReadback(VkCommandBuffer cmdBuffer, foray::base::FrameRenderInfo& renderInfo, foray::core::ManagedImage* image, Callback callback);
+
+    inline uint64_t GetWrittenCount() const { return mWrittenCount; }
+    inline uint64_t GetDroppedCount() const { return mDroppedCount; }
+
+    /// @brief Draws the capture controls into the current ImGui window
+    void ImguiControls();
+
+  protected:
+    enum class ESlotState
+    {
+        Free,
+        /// @brief Copy recorded, waiting for the device
+        InFlight,
+        /// @brief Copy finished, owned by a worker
+        Converting,
+    };
+
+    struct Slot
+    {
+        foray::core::ManagedBuffer Staging;
+        void*                      Mapped   = nullptr;
+        VkEvent                    CopyDone = nullptr;
+        VkExtent2D                 Extent{};
+        VkFormat                   Format = VK_FORMAT_UNDEFINED;
+        uint64_t                   Frame  = 0;
+        Callback                   OnComplete;
+        std::atomic<ESlotState>    State{ESlotState::Free};
+    };
+
+    void Enqueue(std::function<void()> job);
+    void WorkerLoop();
+    void WaitForWorkers();
+
+    foray::core::Context* mContext = nullptr;
+    std::string           mDirectory;
+    bool                  mFlipY   = false;
+
+    std::vector<std::unique_ptr<Slot>> mSlots;
+
+    std::vector<std::thread>          mWorkers;
+    std::deque<std::function<void()>> mJobs;
+    std::mutex                        mJobsMutex;
+    std::condition_variable           mJobsCondition;
+    std::condition_variable           mJobsDone;
+    uint32_t                          mBusyWorkers = 0;
+    bool                              mShutdown    = false;
+
+    Settings mSettings;
+    Settings mUiSettings;
+    bool     mActive            = false;
+    bool     mStartFramePending = false;
+    uint64_t mStartFrame        = 0;
+    uint32_t mCapturedInRun     = 0;
+
+    std::atomic<uint64_t> mWrittenCount{0};
+    std::atomic<uint64_t> mDroppedCount{0};
+};
+
+/// @brief Converts tightly packed RGBA texels of a float color format to RGB floats, optionally flipping the rows.
+/// Supports R16G16B16A16_SFLOAT and R32G32B32A32_SFLOAT.
+bool ConvertTexelsToFloatImage(const void* texels, VkFormat format, VkExtent2D extent, bool flipY, FloatImage& out);
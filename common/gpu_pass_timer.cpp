@@ -0,0 +1,116 @@
+#include "gpu_pass_timer.hpp"
+#include <algorithm>
+#include <imgui/imgui.h>
+
+void GpuPassTimer::Create(foray::core::Context* context, const std::vector<std::string>& passNames)
+{
+    mContext   = context;
+    mPassNames = passNames;
+    mSmoothedMs.assign(passNames.size(), 0.f);
+    mLastMs.assign(passNames.size(), 0.f);
+    mPassWritten.assign(passNames.size() * QUERY_SLOT_COUNT, false);
+    mLastReadPasses.assign(passNames.size(), false);
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(mContext->PhysicalDevice(), &properties);
+    mTimestampPeriodNs = properties.limits.timestampPeriod;
+
+    // two timestamps (begin, end) per pass and slot
+    VkQueryPoolCreateInfo queryPoolCi{
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO, .queryType = VK_QUERY_TYPE_TIMESTAMP, .queryCount = (uint32_t)passNames.size() * 2 * QUERY_SLOT_COUNT};
+    foray::AssertVkResult(vkCreateQueryPool(mContext->Device(), &queryPoolCi, nullptr, &mQueryPool));
+}
+
+void GpuPassTimer::Destroy()
+{
+    if(mQueryPool != nullptr)
+    {
+        vkDestroyQueryPool(mContext->Device(), mQueryPool, nullptr);
+        mQueryPool = nullptr;
+    }
+}
+
+void GpuPassTimer::CmdBeginFrame(VkCommandBuffer cmdBuffer, uint64_t frameNumber)
+{
+    mFrameNumber  = frameNumber;
+    uint32_t slot = (uint32_t)(frameNumber % QUERY_SLOT_COUNT);
+    if(mSlotWritten[slot])
+    {
+        ReadbackSlot(slot);
+    }
+
+    uint32_t queriesPerSlot = (uint32_t)mPassNames.size() * 2;
+    vkCmdResetQueryPool(cmdBuffer, mQueryPool, slot * queriesPerSlot, queriesPerSlot);
+    mSlotWritten[slot] = true;
+    std::fill_n(mPassWritten.begin() + slot * mPassNames.size(), mPassNames.size(), false);
+}
+
+void GpuPassTimer::Reset()
+{
+    std::fill(mSmoothedMs.begin(), mSmoothedMs.end(), 0.f);
+    std::fill(mLastMs.begin(), mLastMs.end(), 0.f);
+    // queries of frames recorded before the reset are reset again without being read back
+    std::fill(std::begin(mSlotWritten), std::end(mSlotWritten), false);
+    mPassSetChanged = false;
+}
+
+void GpuPassTimer::CmdBeginPass(VkCommandBuffer cmdBuffer, uint32_t pass, VkPipelineStageFlagBits stage)
+{
+    uint32_t slot = (uint32_t)(mFrameNumber % QUERY_SLOT_COUNT);
+    vkCmdWriteTimestamp(cmdBuffer, stage, mQueryPool, (slot * (uint32_t)mPassNames.size() + pass) * 2);
+    mPassWritten[slot * mPassNames.size() + pass] = true;
+}
+
+void GpuPassTimer::CmdEndPass(VkCommandBuffer cmdBuffer, uint32_t pass, VkPipelineStageFlagBits stage)
+{
+    uint32_t slot = (uint32_t)(mFrameNumber % QUERY_SLOT_COUNT);
+    vkCmdWriteTimestamp(cmdBuffer, stage, mQueryPool, (slot * (uint32_t)mPassNames.size() + pass) * 2 + 1);
+}
+
+void GpuPassTimer::ReadbackSlot(uint32_t slot)
+{
+    uint32_t              queriesPerSlot = (uint32_t)mPassNames.size() * 2;
+    std::vector<uint64_t> results(queriesPerSlot * 2);  // value + availability per query
+
+    VkResult result = vkGetQueryPoolResults(mContext->Device(), mQueryPool, slot * queriesPerSlot, queriesPerSlot, results.size() * sizeof(uint64_t), results.data(),
+                                            sizeof(uint64_t) * 2, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    if(result != VK_SUCCESS && result != VK_NOT_READY)
+    {
+        return;
+    }
+
+    std::vector<bool> readPasses(mPassWritten.begin() + slot * mPassNames.size(), mPassWritten.begin() + (slot + 1) * mPassNames.size());
+    mPassSetChanged = readPasses != mLastReadPasses;
+    mLastReadPasses = std::move(readPasses);
+
+    for(uint32_t pass = 0; pass < mPassNames.size(); pass++)
+    {
+        const uint64_t* begin = &results[pass * 4];
+        const uint64_t* end   = &results[pass * 4 + 2];
+
+        // a pass skipped in that frame costs nothing, so sums over the passes only count what ran
+        if(!mPassWritten[slot * mPassNames.size() + pass])
+        {
+            mLastMs[pass]     = 0.f;
+            mSmoothedMs[pass] = 0.f;
+            continue;
+        }
+        // not finished yet, keep the previous measurement
+        if(begin[1] == 0 || end[1] == 0 || end[0] < begin[0])
+        {
+            continue;
+        }
+
+        float ms          = (float)((end[0] - begin[0]) * (double)mTimestampPeriodNs * 1e-6);
+        mLastMs[pass]     = ms;
+        mSmoothedMs[pass] = mSmoothedMs[pass] == 0.f ? ms : mSmoothedMs[pass] * 0.95f + ms * 0.05f;
+    }
+}
+
+void GpuPassTimer::ImguiPassTimes() const
+{
+    for(uint32_t pass = 0; pass < mPassNames.size(); pass++)
+    {
+        ImGui::Text("%s: %.3f ms", mPassNames[pass].c_str(), mSmoothedMs[pass]);
+    }
+}
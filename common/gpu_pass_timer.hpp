@@ -0,0 +1,53 @@
+#pragma once
+#include <foray_api.hpp>
+#include <string>
+#include <vector>
+
+/// @brief Measures GPU time per render pass with timestamp queries.
+/// Each frame uses its own query slot, results are read back (without waiting) when the slot is reused QUERY_SLOT_COUNT frames later.
+class GpuPassTimer
+{
+  public:
+    void Create(foray::core::Context* context, const std::vector<std::string>& passNames);
+    void Destroy();
+    inline bool Exists() const { return mQueryPool != nullptr; }
+
+    /// @brief Reads back the results of the slot used QUERY_SLOT_COUNT frames ago and resets it for this frame. Record outside of render passes.
+    void CmdBeginFrame(VkCommandBuffer cmdBuffer, uint64_t frameNumber);
+    void CmdBeginPass(VkCommandBuffer cmdBuffer, uint32_t pass, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+    void CmdEndPass(VkCommandBuffer cmdBuffer, uint32_t pass, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+
+    /// @brief Exponentially smoothed GPU time of the pass in milliseconds
+    float GetPassMs(uint32_t pass) const { return mSmoothedMs[pass]; }
+    /// @brief GPU time of the pass in the most recently read back frame in milliseconds, 0 if the pass did not run in that frame
+    float GetLastPassMs(uint32_t pass) const { return mLastMs[pass]; }
+
+    /// @brief True if the most recently read back frame ran a different set of passes than the frame read back before it
+    bool PassSetChanged() const { return mPassSetChanged; }
+
+    /// @brief Forgets all measurements and the queries still in flight, e.g. when the measured configuration changes
+    void Reset();
+
+    inline const std::vector<std::string>& GetPassNames() const { return mPassNames; }
+
+    /// @brief Draws one line per pass into the current ImGui window
+    void ImguiPassTimes() const;
+
+  protected:
+    static constexpr uint32_t QUERY_SLOT_COUNT = 4;
+
+    void ReadbackSlot(uint32_t slot);
+
+    foray::core::Context*    mContext   = nullptr;
+    VkQueryPool              mQueryPool = nullptr;
+    float                    mTimestampPeriodNs = 1.f;
+    std::vector<std::string> mPassNames;
+    std::vector<float>       mSmoothedMs;
+    std::vector<float>       mLastMs;
+    uint64_t                 mFrameNumber = 0;
+    bool                     mSlotWritten[QUERY_SLOT_COUNT]{};
+    /// @brief Per slot and pass, set when the pass recorded its timestamps in the frame using the slot
+    std::vector<bool>        mPassWritten;
+    std::vector<bool>        mLastReadPasses;
+    bool                     mPassSetChanged = false;
+};
@@ -0,0 +1,85 @@
+#include "host_trace.hpp"
+#include "json_string.hpp"
+#include <foray_logger.hpp>
+#include <fstream>
+
+HostTrace& HostTrace::Get()
+{
+    static HostTrace trace;
+    return trace;
+}
+
+void HostTrace::Start()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSpans.clear();
+    mThreadIds.clear();
+    ThreadIdLocked(std::this_thread::get_id());
+    mEpoch = std::chrono::steady_clock::now();
+    mRecording.store(true, std::memory_order_relaxed);
+}
+
+void HostTrace::Finish(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mRecording.store(false, std::memory_order_relaxed);
+
+    std::ofstream file(path, std::ios::trunc);
+    if(!file.is_open())
+    {
+        foray::logger()->warn("Unable to write trace \"{}\"", path);
+        return;
+    }
+
+    // complete events ("X") carry their duration, no begin / end pairing needed
+    file << "{\n  \"displayTimeUnit\": \"ms\",\n  \"traceEvents\": [";
+    for(size_t i = 0; i < mSpans.size(); i++)
+    {
+        const Span& span = mSpans[i];
+        file << (i > 0 ? "," : "") << "\n    {\"name\": " << JsonString(span.Name) << ", \"cat\": " << JsonString(span.Category)
+             << ", \"ph\": \"X\", \"ts\": " << span.BeginUs << ", \"dur\": " << span.DurationUs << ", \"pid\": 1, \"tid\": " << span.ThreadId << "}";
+    }
+    file << "\n  ]\n}\n";
+    foray::logger()->info("Wrote {} trace spans to \"{}\"", mSpans.size(), path);
+}
+
+void HostTrace::AddSpan(std::string_view name, std::string_view category, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if(!IsRecording())
+    {
+        return;
+    }
+
+    Span& span      = mSpans.emplace_back();
+    span.Name       = name;
+    span.Category   = category;
+    span.BeginUs    = std::chrono::duration_cast<std::chrono::microseconds>(begin - mEpoch).count();
+    span.DurationUs = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+    span.ThreadId   = ThreadIdLocked(std::this_thread::get_id());
+}
+
+uint32_t HostTrace::ThreadIdLocked(std::thread::id thread)
+{
+    auto [it, inserted] = mThreadIds.try_emplace(thread, (uint32_t)mThreadIds.size() + 1);
+    return it->second;
+}
+
+TraceScope::TraceScope(std::string_view name, std::string_view category)
+{
+    mActive = HostTrace::Get().IsRecording();
+    if(mActive)
+    {
+        mName     = name;
+        mCategory = category;
+        mBegin    = std::chrono::steady_clock::now();
+    }
+}
+
+TraceScope::~TraceScope()
+{
+    if(mActive)
+    {
+        HostTrace::Get().AddSpan(mName, mCategory, mBegin, std::chrono::steady_clock::now());
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/// @brief Host side spans written in the Chrome trace_event format (chrome://tracing, ui.perfetto.dev).
+/// Spans are recorded from any thread between Start and Finish, outside of that TraceScope does nothing.
+class HostTrace
+{
+  public:
+    static HostTrace& Get();
+
+    /// @brief Clears previous spans and starts recording, timestamps are relative to this call
+    void Start();
+    /// @brief Stops recording and writes all spans to path
+    void Finish(const std::string& path);
+
+    inline bool IsRecording() const { return mRecording.load(std::memory_order_relaxed); }
+
+    void AddSpan(std::string_view name, std::string_view category, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end);
+
+  protected:
+    struct Span
+    {
+        std::string Name;
+        std::string Category;
+        int64_t     BeginUs    = 0;
+        int64_t     DurationUs = 0;
+        uint32_t    ThreadId   = 0;
+    };
+
+    /// @brief Small sequential ids in order of first use, the thread calling Start is 1
+    uint32_t ThreadIdLocked(std::thread::id thread);
+
+    std::atomic<bool>                             mRecording = false;
+    std::mutex                                    mMutex;
+    std::chrono::steady_clock::time_point         mEpoch;
+    std::vector<Span>                             mSpans;
+    std::unordered_map<std::thread::id, uint32_t> mThreadIds;
+};
+
+/// @brief Adds a span from construction to destruction to HostTrace
+class TraceScope
+{
+  public:
+    explicit TraceScope(std::string_view name, std::string_view category = "startup");
+    ~TraceScope();
+
+    TraceScope(const TraceScope&)            = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+  protected:
+    std::string                           mName;
+    std::string                           mCategory;
+    std::chrono::steady_clock::time_point mBegin;
+    bool                                  mActive = false;
+};
@@ -0,0 +1,445 @@
+#include "image_metrics.hpp"
+#include "parallel_range.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numbers>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define IMAGE_METRICS_SSE
+#endif
+
+namespace image_metrics {
+    namespace {
+        /// @brief Sums f(test, ref) over all values, per row partial sums in float (SIMD), accumulated in double
+        template <typename SimdOp, typename ScalarOp>
+        double SumPerValue(const FloatImage& test, const FloatImage& reference, uint32_t threadCount, SimdOp simdOp, ScalarOp scalarOp)
+        {
+            size_t              rowSize = (size_t)test.Width * 3;
+            std::vector<double> rowSums(test.Height, 0.0);
+            ParallelRange(test.Height, threadCount, [&](uint32_t begin, uint32_t end) {
+                for(uint32_t y = begin; y < end; y++)
+                {
+                    const float* t   = test.Rgb.data() + y * rowSize;
+                    const float* r   = reference.Rgb.data() + y * rowSize;
+                    size_t       i   = 0;
+                    float        sum = 0.f;
+#ifdef IMAGE_METRICS_SSE
+                    __m128 sum4 = _mm_setzero_ps();
+                    for(; i + 4 <= rowSize; i += 4)
+                    {
+                        sum4 = _mm_add_ps(sum4, simdOp(_mm_loadu_ps(t + i), _mm_loadu_ps(r + i)));
+                    }
+                    alignas(16) float lanes[4];
+                    _mm_store_ps(lanes, sum4);
+                    sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+                    for(; i < rowSize; i++)
+                    {
+                        sum += scalarOp(t[i], r[i]);
+                    }
+                    rowSums[y] = sum;
+                }
+            });
+
+            double total = 0.0;
+            for(double rowSum : rowSums)
+            {
+                total += rowSum;
+            }
+            return total;
+        }
+
+        bool SameSize(const FloatImage& a, const FloatImage& b) { return a.Width == b.Width && a.Height == b.Height && !a.Empty(); }
+
+#pragma region FLIP
+
+        constexpr float FLIP_QC = 0.7f;
+        constexpr float FLIP_QF = 0.5f;
+        constexpr float FLIP_PC = 0.4f;
+        constexpr float FLIP_PT = 0.95f;
+
+        // D65 reference white
+        constexpr std::array<float, 3> WHITE = {0.950428545f, 1.f, 1.088900371f};
+
+        using Plane = std::vector<float>;
+
+        std::array<float, 3> LinearRgbToXyz(float r, float g, float b)
+        {
+            return {0.4124564f * r + 0.3575761f * g + 0.1804375f * b, 0.2126729f * r + 0.7151522f * g + 0.0721750f * b,
+                    0.0193339f * r + 0.1191920f * g + 0.9503041f * b};
+        }
+
+        std::array<float, 3> XyzToLinearRgb(float x, float y, float z)
+        {
+            return {3.2404542f * x - 1.5371385f * y - 0.4985314f * z, -0.9692660f * x + 1.8760108f * y + 0.0415560f * z,
+                    0.0556434f * x - 0.2040259f * y + 1.0572252f * z};
+        }
+
+        std::array<float, 3> XyzToHuntLab(const std::array<float, 3>& xyz)
+        {
+            auto f = [](float t) { return t > 0.008856f ? std::cbrt(t) : 7.787f * t + 16.f / 116.f; };
+            float fx = f(xyz[0] / WHITE[0]);
+            float fy = f(xyz[1] / WHITE[1]);
+            float fz = f(xyz[2] / WHITE[2]);
+            float l  = 116.f * fy - 16.f;
+            // Hunt effect: chroma scaled by lightness
+            return {l, 0.01f * l * 500.f * (fx - fy), 0.01f * l * 200.f * (fy - fz)};
+        }
+
+        float HyAb(const std::array<float, 3>& a, const std::array<float, 3>& b)
+        {
+            float da = a[1] - b[1];
+            float db = a[2] - b[2];
+            return std::abs(a[0] - b[0]) + std::sqrt(da * da + db * db);
+        }
+
+        /// @brief Convolution with a separable kernel (kx along rows, ky along columns), clamp to edge
+        void ConvolveSeparable(const Plane& src, Plane& dst, uint32_t width, uint32_t height, const std::vector<float>& kx, const std::vector<float>& ky, uint32_t threadCount)
+        {
+            int   rx = (int)kx.size() / 2;
+            int   ry = (int)ky.size() / 2;
+            Plane temp(src.size());
+
+            ParallelRange(height, threadCount, [&](uint32_t begin, uint32_t end) {
+                for(uint32_t y = begin; y < end; y++)
+                {
+                    const float* row = src.data() + (size_t)y * width;
+                    float*       out = temp.data() + (size_t)y * width;
+                    int          x   = 0;
+                    // borders need clamping
+                    auto scalarPixel = [&](int px) {
+                        float sum = 0.f;
+                        for(int k = -rx; k <= rx; k++)
+                        {
+                            sum += kx[k + rx] * row[std::clamp(px + k, 0, (int)width - 1)];
+                        }
+                        out[px] = sum;
+                    };
+                    for(; x < std::min(rx, (int)width); x++)
+                    {
+                        scalarPixel(x);
+                    }
+#ifdef IMAGE_METRICS_SSE
+                    for(; x + 4 + rx <= (int)width; x += 4)
+                    {
+                        __m128 sum = _mm_setzero_ps();
+                        for(int k = -rx; k <= rx; k++)
+                        {
+                            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(kx[k + rx]), _mm_loadu_ps(row + x + k)));
+                        }
+                        _mm_storeu_ps(out + x, sum);
+                    }
+#endif
+                    for(; x < (int)width; x++)
+                    {
+                        scalarPixel(x);
+                    }
+                }
+            });
+
+            dst.resize(src.size());
+            ParallelRange(height, threadCount, [&](uint32_t begin, uint32_t end) {
+                for(uint32_t y = begin; y < end; y++)
+                {
+                    float* out = dst.data() + (size_t)y * width;
+                    std::fill(out, out + width, 0.f);
+                    for(int k = -ry; k <= ry; k++)
+                    {
+                        const float* row    = temp.data() + (size_t)std::clamp((int)y + k, 0, (int)height - 1) * width;
+                        float        weight = ky[k + ry];
+                        uint32_t     x      = 0;
+#ifdef IMAGE_METRICS_SSE
+                        __m128 weight4 = _mm_set1_ps(weight);
+                        for(; x + 4 <= width; x += 4)
+                        {
+                            _mm_storeu_ps(out + x, _mm_add_ps(_mm_loadu_ps(out + x), _mm_mul_ps(weight4, _mm_loadu_ps(row + x))));
+                        }
+#endif
+                        for(; x < width; x++)
+                        {
+                            out[x] += weight * row[x];
+                        }
+                    }
+                }
+            });
+        }
+
+        /// @brief Contrast sensitivity filter of one YCxCz channel: sum of gaussians a * pi / b * exp(-pi^2 d^2 / b), d in degrees
+        void FilterCsf(const Plane& src, Plane& dst, uint32_t width, uint32_t height, const std::vector<std::array<float, 2>>& terms, int radius, float ppd, uint32_t threadCount)
+        {
+            constexpr float PI = std::numbers::pi_v<float>;
+
+            // the 2D kernel of each term is separable, normalize the sum of all terms over the full 2D footprint
+            std::vector<std::vector<float>> kernels;
+            std::vector<float>              scales;
+            float                           total = 0.f;
+            for(const std::array<float, 2>& term : terms)
+            {
+                std::vector<float> kernel(2 * radius + 1);
+                float              sum = 0.f;
+                for(int i = -radius; i <= radius; i++)
+                {
+                    float d            = (float)i / ppd;
+                    kernel[i + radius] = std::exp(-PI * PI * d * d / term[1]);
+                    sum += kernel[i + radius];
+                }
+                float scale = term[0] * PI / term[1];
+                total += scale * sum * sum;
+                kernels.push_back(std::move(kernel));
+                scales.push_back(scale);
+            }
+
+            dst.assign(src.size(), 0.f);
+            Plane filtered;
+            for(size_t t = 0; t < terms.size(); t++)
+            {
+                ConvolveSeparable(src, filtered, width, height, kernels[t], kernels[t], threadCount);
+                float weight = scales[t] / total;
+                for(size_t i = 0; i < dst.size(); i++)
+                {
+                    dst[i] += weight * filtered[i];
+                }
+            }
+        }
+
+        /// @brief Normalizes positive weights to sum 1 and negative weights to sum -1
+        void NormalizeSigned(std::vector<float>& kernel)
+        {
+            float positive = 0.f, negative = 0.f;
+            for(float value : kernel)
+            {
+                (value > 0.f ? positive : negative) += value;
+            }
+            for(float& value : kernel)
+            {
+                value /= value > 0.f ? positive : -negative;
+            }
+        }
+
+        /// @brief Edge (first derivative) and point (second derivative) feature magnitudes of the luminance
+        void DetectFeatures(const Plane& luminance, Plane& edges, Plane& points, uint32_t width, uint32_t height, float ppd, uint32_t threadCount)
+        {
+            float sigma  = 0.5f * 0.082f * ppd;
+            int   radius = (int)std::ceil(3.f * sigma);
+
+            std::vector<float> gauss(2 * radius + 1), firstDerivative(2 * radius + 1), secondDerivative(2 * radius + 1);
+            float              gaussSum = 0.f;
+            for(int i = -radius; i <= radius; i++)
+            {
+                float g                      = std::exp(-(float)(i * i) / (2.f * sigma * sigma));
+                gauss[i + radius]            = g;
+                firstDerivative[i + radius]  = -(float)i * g;
+                secondDerivative[i + radius] = ((float)(i * i) / (sigma * sigma) - 1.f) * g;
+                gaussSum += g;
+            }
+            for(float& value : gauss)
+            {
+                value /= gaussSum;
+            }
+            NormalizeSigned(firstDerivative);
+            NormalizeSigned(secondDerivative);
+
+            Plane dx, dy;
+            ConvolveSeparable(luminance, dx, width, height, firstDerivative, gauss, threadCount);
+            ConvolveSeparable(luminance, dy, width, height, gauss, firstDerivative, threadCount);
+            edges.resize(luminance.size());
+            for(size_t i = 0; i < edges.size(); i++)
+            {
+                edges[i] = std::sqrt(dx[i] * dx[i] + dy[i] * dy[i]);
+            }
+
+            ConvolveSeparable(luminance, dx, width, height, secondDerivative, gauss, threadCount);
+            ConvolveSeparable(luminance, dy, width, height, gauss, secondDerivative, threadCount);
+            points.resize(luminance.size());
+            for(size_t i = 0; i < points.size(); i++)
+            {
+                points[i] = std::sqrt(dx[i] * dx[i] + dy[i] * dy[i]);
+            }
+        }
+
+        struct FlipPlanes
+        {
+            std::array<Plane, 3> Lab;
+            Plane                Edges;
+            Plane                Points;
+        };
+
+        /// @brief Spatially filtered Hunt adjusted Lab and feature maps of an image
+        void PrepareFlipPlanes(const FloatImage& image, FlipPlanes& planes, float ppd, uint32_t threadCount)
+        {
+            uint32_t width  = image.Width;
+            uint32_t height = image.Height;
+            size_t   count  = image.PixelCount();
+
+            std::array<Plane, 3> ycxcz;
+            for(Plane& plane : ycxcz)
+            {
+                plane.resize(count);
+            }
+            Plane luminance(count);
+            ParallelRange(height, threadCount, [&](uint32_t begin, uint32_t end) {
+                for(size_t i = (size_t)begin * width; i < (size_t)end * width; i++)
+                {
+                    float                r   = std::clamp(image.Rgb[i * 3 + 0], 0.f, 1.f);
+                    float                g   = std::clamp(image.Rgb[i * 3 + 1], 0.f, 1.f);
+                    float                b   = std::clamp(image.Rgb[i * 3 + 2], 0.f, 1.f);
+                    std::array<float, 3> xyz = LinearRgbToXyz(r, g, b);
+                    ycxcz[0][i]              = 116.f * xyz[1] / WHITE[1] - 16.f;
+                    ycxcz[1][i]              = 500.f * (xyz[0] / WHITE[0] - xyz[1] / WHITE[1]);
+                    ycxcz[2][i]              = 200.f * (xyz[1] / WHITE[1] - xyz[2] / WHITE[2]);
+                    luminance[i]             = xyz[1];
+                }
+            });
+
+            // CSF parameters (a1, b1), (a2, b2) per channel, the kernel radius follows the widest gaussian
+            const std::array<std::vector<std::array<float, 2>>, 3> csf = {
+                std::vector<std::array<float, 2>>{{1.f, 0.0047f}},
+                std::vector<std::array<float, 2>>{{1.f, 0.0053f}},
+                std::vector<std::array<float, 2>>{{34.1f, 0.04f}, {13.5f, 0.025f}},
+            };
+            int radius = (int)std::ceil(3.f * std::sqrt(0.04f / (2.f * std::numbers::pi_v<float> * std::numbers::pi_v<float>)) * ppd);
+
+            std::array<Plane, 3> filtered;
+            for(uint32_t c = 0; c < 3; c++)
+            {
+                FilterCsf(ycxcz[c], filtered[c], width, height, csf[c], radius, ppd, threadCount);
+            }
+
+            for(Plane& plane : planes.Lab)
+            {
+                plane.resize(count);
+            }
+            ParallelRange(height, threadCount, [&](uint32_t begin, uint32_t end) {
+                for(size_t i = (size_t)begin * width; i < (size_t)end * width; i++)
+                {
+                    float                y   = (filtered[0][i] + 16.f) / 116.f * WHITE[1];
+                    float                x   = (filtered[1][i] / 500.f + y / WHITE[1]) * WHITE[0];
+                    float                z   = (y / WHITE[1] - filtered[2][i] / 200.f) * WHITE[2];
+                    std::array<float, 3> rgb = XyzToLinearRgb(x, y, z);
+                    for(float& value : rgb)
+                    {
+                        value = std::clamp(value, 0.f, 1.f);
+                    }
+                    std::array<float, 3> lab = XyzToHuntLab(LinearRgbToXyz(rgb[0], rgb[1], rgb[2]));
+                    planes.Lab[0][i]         = lab[0];
+                    planes.Lab[1][i]         = lab[1];
+                    planes.Lab[2][i]         = lab[2];
+                }
+            });
+
+            DetectFeatures(luminance, planes.Edges, planes.Points, width, height, ppd, threadCount);
+        }
+
+#pragma endregion
+    }  // namespace
+
+    double Rmse(const FloatImage& test, const FloatImage& reference, uint32_t threadCount)
+    {
+        if(!SameSize(test, reference))
+        {
+            return 0.0;
+        }
+        double sum = SumPerValue(
+            test, reference, threadCount,
+#ifdef IMAGE_METRICS_SSE
+            [](__m128 t, __m128 r) {
+                __m128 diff = _mm_sub_ps(t, r);
+                return _mm_mul_ps(diff, diff);
+            },
+#else
+            nullptr,
+#endif
+            [](float t, float r) { return (t - r) * (t - r); });
+        return std::sqrt(sum / (double)test.Rgb.size());
+    }
+
+    double RelMse(const FloatImage& test, const FloatImage& reference, uint32_t threadCount)
+    {
+        if(!SameSize(test, reference))
+        {
+            return 0.0;
+        }
+        constexpr float EPSILON = 0.01f;
+        double          sum     = SumPerValue(
+            test, reference, threadCount,
+#ifdef IMAGE_METRICS_SSE
+            [](__m128 t, __m128 r) {
+                __m128 diff = _mm_sub_ps(t, r);
+                return _mm_div_ps(_mm_mul_ps(diff, diff), _mm_add_ps(_mm_mul_ps(r, r), _mm_set1_ps(EPSILON)));
+            },
+#else
+            nullptr,
+#endif
+            [](float t, float r) { return (t - r) * (t - r) / (r * r + EPSILON); });
+        return sum / (double)test.Rgb.size();
+    }
+
+    double Flip(const FloatImage& test, const FloatImage& reference, float pixelsPerDegree, uint32_t threadCount)
+    {
+        if(!SameSize(test, reference))
+        {
+            return 0.0;
+        }
+
+        FlipPlanes testPlanes, referencePlanes;
+        PrepareFlipPlanes(test, testPlanes, pixelsPerDegree, threadCount);
+        PrepareFlipPlanes(reference, referencePlanes, pixelsPerDegree, threadCount);
+
+        // largest color difference: between green and blue
+        float cmax = std::pow(HyAb(XyzToHuntLab(LinearRgbToXyz(0.f, 1.f, 0.f)), XyzToHuntLab(LinearRgbToXyz(0.f, 0.f, 1.f))), FLIP_QC);
+
+        uint32_t            width = test.Width;
+        std::vector<double> rowSums(test.Height, 0.0);
+        ParallelRange(test.Height, threadCount, [&](uint32_t begin, uint32_t end) {
+            for(uint32_t y = begin; y < end; y++)
+            {
+                double rowSum = 0.0;
+                for(size_t i = (size_t)y * width; i < (size_t)(y + 1) * width; i++)
+                {
+                    std::array<float, 3> labTest{testPlanes.Lab[0][i], testPlanes.Lab[1][i], testPlanes.Lab[2][i]};
+                    std::array<float, 3> labRef{referencePlanes.Lab[0][i], referencePlanes.Lab[1][i], referencePlanes.Lab[2][i]};
+                    float                colorDiff = std::pow(HyAb(labTest, labRef), FLIP_QC);
+
+                    // compress large color differences
+                    if(colorDiff < FLIP_PC * cmax)
+                    {
+                        colorDiff = FLIP_PT / (FLIP_PC * cmax) * colorDiff;
+                    }
+                    else
+                    {
+                        colorDiff = FLIP_PT + (colorDiff - FLIP_PC * cmax) / (cmax - FLIP_PC * cmax) * (1.f - FLIP_PT);
+                    }
+
+                    float edgeDiff    = std::abs(testPlanes.Edges[i] - referencePlanes.Edges[i]);
+                    float pointDiff   = std::abs(testPlanes.Points[i] - referencePlanes.Points[i]);
+                    float featureDiff = std::pow(std::max(edgeDiff, pointDiff) / std::numbers::sqrt2_v<float>, FLIP_QF);
+
+                    rowSum += std::pow(colorDiff, 1.f - featureDiff);
+                }
+                rowSums[y] = rowSum;
+            }
+        });
+
+        double total = 0.0;
+        for(double rowSum : rowSums)
+        {
+            total += rowSum;
+        }
+        return total / (double)test.PixelCount();
+    }
+
+    bool Compute(const FloatImage& test, const FloatImage& reference, ImageErrorMetrics& out, const Settings& settings)
+    {
+        if(!SameSize(test, reference))
+        {
+            return false;
+        }
+        out.Rmse   = Rmse(test, reference, settings.ThreadCount);
+        out.RelMse = RelMse(test, reference, settings.ThreadCount);
+        out.Flip   = Flip(test, reference, settings.PixelsPerDegree, settings.ThreadCount);
+        return true;
+    }
+}  // namespace image_metrics
@@ -0,0 +1,32 @@
+#pragma once
+#include "float_image.hpp"
+#include <cstdint>
+
+/// @brief Error of a rendered image against a converged reference
+struct ImageErrorMetrics
+{
+    double Rmse   = 0.0;
+    /// @brief Mean of (test - ref)^2 / (ref^2 + 0.01), less dominated by bright pixels than the RMSE
+    double RelMse = 0.0;
+    /// @brief Mean FLIP error in [0, 1], see "FLIP: A Difference Evaluator for Alternating Images" (Andersson et al. 2020)
+    double Flip = 0.0;
+};
+
+/// @brief CPU image comparison. Rows are split across threads, the inner loops use SSE where available.
+namespace image_metrics {
+    struct Settings
+    {
+        /// @brief Observer distance for FLIP, the default corresponds to a 0.7m distance from a 24" 4K monitor
+        float PixelsPerDegree = 67.f;
+        /// @brief 0 = one thread per hardware thread
+        uint32_t ThreadCount = 0;
+    };
+
+    /// @brief Computes all metrics. Returns false if the image sizes differ.
+    bool Compute(const FloatImage& test, const FloatImage& reference, ImageErrorMetrics& out, const Settings& settings = Settings{});
+
+    double Rmse(const FloatImage& test, const FloatImage& reference, uint32_t threadCount = 0);
+    double RelMse(const FloatImage& test, const FloatImage& reference, uint32_t threadCount = 0);
+    /// @brief LDR-FLIP on the linear images clamped to [0, 1] (the HDR-FLIP exposure sweep is not applied)
+    double Flip(const FloatImage& test, const FloatImage& reference, float pixelsPerDegree = 67.f, uint32_t threadCount = 0);
+}  // namespace image_metrics
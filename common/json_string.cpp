@@ -0,0 +1,42 @@
+#include "json_string.hpp"
+#include <cstdio>
+
+std::string JsonString(std::string_view text)
+{
+    std::string escaped = "\"";
+    escaped.reserve(text.size() + 2);
+    for(char c : text)
+    {
+        switch(c)
+        {
+            case '"':
+                escaped += "\\\"";
+                break;
+            case '\\':
+                escaped += "\\\\";
+                break;
+            case '\n':
+                escaped += "\\n";
+                break;
+            case '\r':
+                escaped += "\\r";
+                break;
+            case '\t':
+                escaped += "\\t";
+                break;
+            default:
+                if((unsigned char)c < 0x20)
+                {
+                    char code[8];
+                    std::snprintf(code, sizeof(code), "\\u%04x", (unsigned int)(unsigned char)c);
+                    escaped += code;
+                }
+                else
+                {
+                    escaped += c;
+                }
+                break;
+        }
+    }
+    return escaped + "\"";
+}
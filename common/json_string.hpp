@@ -0,0 +1,6 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+/// @brief Quoted JSON string literal of text. Escapes quotes, backslashes and all control characters below 0x20.
+std::string JsonString(std::string_view text);
@@ -0,0 +1,343 @@
+#include "memory_report.hpp"
+#include "json_string.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <foray_logger.hpp>
+#include <fstream>
+#include <imgui/imgui.h>
+#include <iterator>
+
+namespace {
+    struct VmaAllocationEntry
+    {
+        std::string  Type;
+        std::string  Name;
+        VkDeviceSize Size = 0;
+    };
+
+    /// @brief Collects the allocations of a vmaBuildStatsString detailed map: every object with a "Type" string and a "Size" number,
+    /// except the free ranges. Only the few keys needed are read, the rest of the document is skipped.
+    std::vector<VmaAllocationEntry> lParseVmaAllocations(const char* json)
+    {
+        struct Frame
+        {
+            VmaAllocationEntry Entry;
+            bool               HasType    = false;
+            bool               HasSize    = false;
+            int                ArrayDepth = 0;
+        };
+        std::vector<Frame>              frames;
+        std::vector<VmaAllocationEntry> entries;
+        std::string                     key;
+
+        for(const char* c = json; *c != '\0'; c++)
+        {
+            switch(*c)
+            {
+                case '{':
+                    frames.emplace_back();
+                    key.clear();
+                    break;
+                case '}':
+                    if(!frames.empty())
+                    {
+                        Frame frame = frames.back();
+                        frames.pop_back();
+                        if(frame.HasType && frame.HasSize && frame.Entry.Type != "FREE")
+                        {
+                            entries.push_back(frame.Entry);
+                        }
+                    }
+                    key.clear();
+                    break;
+                case '[':
+                    if(!frames.empty())
+                    {
+                        frames.back().ArrayDepth++;
+                    }
+                    break;
+                case ']':
+                    if(!frames.empty())
+                    {
+                        frames.back().ArrayDepth--;
+                    }
+                    break;
+                case ',':
+                    key.clear();
+                    break;
+                case '"': {
+                    std::string text;
+                    for(c++; *c != '\0' && *c != '"'; c++)
+                    {
+                        if(*c == '\\' && c[1] != '\0')
+                        {
+                            c++;
+                        }
+                        text += *c;
+                    }
+                    if(*c == '\0')
+                    {
+                        return entries;
+                    }
+
+                    const char* next = c + 1;
+                    while(std::isspace((unsigned char)*next))
+                    {
+                        next++;
+                    }
+                    if(*next == ':')
+                    {
+                        key = text;
+                    }
+                    else if(!frames.empty() && frames.back().ArrayDepth == 0)
+                    {
+                        if(key == "Type")
+                        {
+                            frames.back().Entry.Type = text;
+                            frames.back().HasType    = true;
+                        }
+                        else if(key == "Name")
+                        {
+                            frames.back().Entry.Name = text;
+                        }
+                    }
+                    break;
+                }
+                default:
+                    if(key == "Size" && std::isdigit((unsigned char)*c) && !frames.empty() && frames.back().ArrayDepth == 0)
+                    {
+                        char* end                = nullptr;
+                        frames.back().Entry.Size = (VkDeviceSize)std::strtoull(c, &end, 10);
+                        frames.back().HasSize    = true;
+                        c                        = end - 1;
+                    }
+                    break;
+            }
+        }
+        return entries;
+    }
+
+    std::string lToLower(std::string_view text)
+    {
+        std::string lower(text);
+        for(char& c : lower)
+        {
+            c = (char)std::tolower((unsigned char)c);
+        }
+        return lower;
+    }
+
+    float lMiB(VkDeviceSize bytes)
+    {
+        return (float)((double)bytes / (1024.0 * 1024.0));
+    }
+}  // namespace
+
+void MemoryReport::Init(foray::core::Context* context)
+{
+    mContext = context;
+}
+
+std::string MemoryReport::CategoryOf(std::string_view name, bool image)
+{
+    // first match wins, matched case insensitive against the allocation names given at creation
+    static const std::vector<std::pair<std::string, std::string>> rules = {
+        {"reservoir", "Reservoirs"},
+        {"restirstoragebuffer", "Reservoirs"},
+        {"history", "History"},
+        {"gbuf", "GBuffer"},
+        {"svgf", "Denoiser"},
+        {"denoiser", "Denoiser"},
+        {"environment", "Environment map"},
+        {"envmap", "Environment map"},
+        {"trianglelight", "Lights"},
+        {"emissivetri", "Lights"},
+        {"tilelight", "Lights"},
+        {"blas", "Acceleration structures"},
+        {"tlas", "Acceleration structures"},
+        {"acceleration", "Acceleration structures"},
+        {"texture", "Scene textures"},
+        {"vertex", "Scene geometry"},
+        {"vertices", "Scene geometry"},
+        {"index", "Scene geometry"},
+        {"indices", "Scene geometry"},
+        {"material", "Scene geometry"},
+        {"geometr", "Scene geometry"},
+        {"staging", "Staging"},
+        {"readback", "Staging"},
+    };
+
+    std::string lower = lToLower(name);
+    for(const auto& [pattern, category] : rules)
+    {
+        if(lower.find(pattern) != std::string::npos)
+        {
+            return category;
+        }
+    }
+    return image ? "Other images" : "Other buffers";
+}
+
+void MemoryReport::Update()
+{
+    const VkPhysicalDeviceMemoryProperties* properties = nullptr;
+    vmaGetMemoryProperties(mContext->Allocator, &properties);
+    std::vector<VmaBudget> budgets(properties->memoryHeapCount);
+    vmaGetHeapBudgets(mContext->Allocator, budgets.data());
+
+    mHeaps.resize(properties->memoryHeapCount);
+    for(uint32_t i = 0; i < properties->memoryHeapCount; i++)
+    {
+        Heap& heap           = mHeaps[i];
+        heap.DeviceLocal     = (properties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+        heap.HeapSize        = properties->memoryHeaps[i].size;
+        heap.Budget          = budgets[i].budget;
+        heap.Usage           = budgets[i].usage;
+        heap.PeakUsage       = std::max(heap.PeakUsage, heap.Usage);
+        heap.BlockBytes      = budgets[i].statistics.blockBytes;
+        heap.AllocationBytes = budgets[i].statistics.allocationBytes;
+    }
+
+    char* statsString = nullptr;
+    vmaBuildStatsString(mContext->Allocator, &statsString, VK_TRUE);
+    std::vector<VmaAllocationEntry> entries = lParseVmaAllocations(statsString);
+    vmaFreeStatsString(mContext->Allocator, statsString);
+
+    for(auto& [name, resource] : mResources)
+    {
+        resource.Size            = 0;
+        resource.AllocationCount = 0;
+    }
+    for(auto& [name, category] : mCategories)
+    {
+        category.Size = 0;
+    }
+    mTotal = 0;
+
+    for(const VmaAllocationEntry& entry : entries)
+    {
+        std::string name     = entry.Name.empty() ? "<unnamed " + lToLower(entry.Type) + ">" : entry.Name;
+        Resource&   resource = mResources[name];
+        if(resource.Category.empty())
+        {
+            resource.Category = CategoryOf(entry.Name, entry.Type.starts_with("IMAGE"));
+        }
+        resource.Size += entry.Size;
+        resource.AllocationCount++;
+        mCategories[resource.Category].Size += entry.Size;
+        mTotal += entry.Size;
+    }
+
+    for(auto& [name, resource] : mResources)
+    {
+        resource.Peak = std::max(resource.Peak, resource.Size);
+    }
+    for(auto& [name, category] : mCategories)
+    {
+        category.Peak = std::max(category.Peak, category.Size);
+    }
+    mTotalPeak = std::max(mTotalPeak, mTotal);
+}
+
+void MemoryReport::OnFrame(uint64_t frameNumber)
+{
+    // the statistics string walks every allocation, nobody looks at the result while the window is closed
+    if(mWindowOpen && frameNumber % UPDATE_INTERVAL == 0)
+    {
+        Update();
+    }
+    mWindowOpen = false;
+}
+
+void MemoryReport::WriteJson(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::trunc);
+    if(!file.is_open())
+    {
+        foray::logger()->warn("Unable to write memory report \"{}\"", path);
+        return;
+    }
+
+    file << "{\n";
+    file << "  \"allocated_bytes\": " << mTotal << ",\n";
+    file << "  \"allocated_peak_bytes\": " << mTotalPeak << ",\n";
+    file << "  \"heaps\": [";
+    for(size_t i = 0; i < mHeaps.size(); i++)
+    {
+        const Heap& heap = mHeaps[i];
+        file << (i > 0 ? "," : "") << "\n    {\"index\": " << i << ", \"device_local\": " << (heap.DeviceLocal ? "true" : "false") << ", \"size\": " << heap.HeapSize
+             << ", \"budget\": " << heap.Budget << ", \"usage\": " << heap.Usage << ", \"peak_usage\": " << heap.PeakUsage << ", \"block_bytes\": " << heap.BlockBytes
+             << ", \"allocation_bytes\": " << heap.AllocationBytes << "}";
+    }
+    file << "\n  ],\n";
+    file << "  \"categories\": [";
+    bool first = true;
+    for(const auto& [name, category] : mCategories)
+    {
+        file << (first ? "" : ",") << "\n    {\"name\": " << JsonString(name) << ", \"bytes\": " << category.Size << ", \"peak_bytes\": " << category.Peak << "}";
+        first = false;
+    }
+    file << "\n  ],\n";
+    file << "  \"resources\": [";
+    first = true;
+    for(const auto& [name, resource] : mResources)
+    {
+        file << (first ? "" : ",") << "\n    {\"name\": " << JsonString(name) << ", \"category\": " << JsonString(resource.Category) << ", \"bytes\": " << resource.Size
+             << ", \"peak_bytes\": " << resource.Peak << ", \"allocations\": " << resource.AllocationCount << "}";
+        first = false;
+    }
+    file << "\n  ]\n}\n";
+    foray::logger()->info("Wrote memory report \"{}\"", path);
+}
+
+void MemoryReport::ImguiWindow(const std::string& jsonPath)
+{
+    if(!ImGui::Begin("GPU memory"))
+    {
+        ImGui::End();
+        return;
+    }
+    mWindowOpen = true;
+
+    if(ImGui::Button("Refresh"))
+    {
+        Update();
+    }
+    ImGui::SameLine();
+    if(ImGui::Button("Write report"))
+    {
+        Update();
+        WriteJson(jsonPath);
+    }
+
+    for(size_t i = 0; i < mHeaps.size(); i++)
+    {
+        const Heap& heap = mHeaps[i];
+        ImGui::Text("Heap %u%s: %.1f / %.1f MiB budget, peak %.1f MiB", (uint32_t)i, heap.DeviceLocal ? " (device local)" : "", lMiB(heap.Usage), lMiB(heap.Budget),
+                    lMiB(heap.PeakUsage));
+    }
+    ImGui::Text("Allocations: %.1f MiB, peak %.1f MiB", lMiB(mTotal), lMiB(mTotalPeak));
+    ImGui::Separator();
+
+    std::vector<std::pair<std::string, Category>> categories(mCategories.begin(), mCategories.end());
+    std::sort(categories.begin(), categories.end(), [](const auto& a, const auto& b) { return a.second.Size > b.second.Size; });
+    for(const auto& [categoryName, category] : categories)
+    {
+        if(!ImGui::TreeNode(categoryName.c_str(), "%s: %.1f MiB, peak %.1f MiB", categoryName.c_str(), lMiB(category.Size), lMiB(category.Peak)))
+        {
+            continue;
+        }
+
+        std::vector<std::pair<std::string, Resource>> resources;
+        std::copy_if(mResources.begin(), mResources.end(), std::back_inserter(resources), [&](const auto& entry) { return entry.second.Category == categoryName; });
+        std::sort(resources.begin(), resources.end(), [](const auto& a, const auto& b) { return a.second.Size > b.second.Size; });
+        for(const auto& [resourceName, resource] : resources)
+        {
+            ImGui::Text("%s: %.2f MiB, peak %.2f MiB (%u)", resourceName.c_str(), lMiB(resource.Size), lMiB(resource.Peak), resource.AllocationCount);
+        }
+        ImGui::TreePop();
+    }
+
+    ImGui::End();
+}
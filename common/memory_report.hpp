@@ -0,0 +1,75 @@
+#pragma once
+#include <foray_api.hpp>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// @brief GPU memory accounting built on VMA. Heap budget and usage come from vmaGetHeapBudgets (VK_EXT_memory_budget when the allocator
+/// was created with it, VMA's own estimate otherwise), the resources from the named allocations of the VMA detailed map.
+/// Resources are grouped into categories by name. Peaks are kept for the lifetime of the report, so resizes show up as high-water marks.
+class MemoryReport
+{
+  public:
+    struct Resource
+    {
+        std::string  Category;
+        /// @brief Sum over all live allocations with this name
+        VkDeviceSize Size = 0;
+        VkDeviceSize Peak = 0;
+        uint32_t     AllocationCount = 0;
+    };
+
+    struct Category
+    {
+        VkDeviceSize Size = 0;
+        VkDeviceSize Peak = 0;
+    };
+
+    struct Heap
+    {
+        bool         DeviceLocal = false;
+        VkDeviceSize HeapSize    = 0;
+        VkDeviceSize Budget      = 0;
+        VkDeviceSize Usage       = 0;
+        VkDeviceSize PeakUsage   = 0;
+        /// @brief Device memory blocks allocated by VMA in this heap
+        VkDeviceSize BlockBytes = 0;
+        /// @brief Bytes of those blocks occupied by allocations
+        VkDeviceSize AllocationBytes = 0;
+    };
+
+    void Init(foray::core::Context* context);
+
+    /// @brief Queries the heap budgets and walks every allocation. Builds the full VMA statistics string, so call it on events
+    /// (startup, resize) or every few frames rather than every frame.
+    void Update();
+    /// @brief Updates every UPDATE_INTERVAL frames while the ImGui window was open in the previous frame, otherwise the report
+    /// only changes on explicit Update calls
+    void OnFrame(uint64_t frameNumber);
+
+    void WriteJson(const std::string& path) const;
+
+    /// @brief Draws the "GPU memory" ImGui window, its button writes the JSON report to jsonPath
+    void ImguiWindow(const std::string& jsonPath);
+
+    /// @brief Category of an allocation by its name, unmatched names fall back to "Other images" / "Other buffers"
+    static std::string CategoryOf(std::string_view name, bool image);
+
+    inline const std::vector<Heap>&               GetHeaps() const { return mHeaps; }
+    inline const std::map<std::string, Category>& GetCategories() const { return mCategories; }
+    inline const std::map<std::string, Resource>& GetResources() const { return mResources; }
+
+  protected:
+    static constexpr uint64_t UPDATE_INTERVAL = 120;
+
+    foray::core::Context*           mContext = nullptr;
+    std::vector<Heap>               mHeaps;
+    std::map<std::string, Category> mCategories;
+    /// @brief By allocation name, freed resources stay with size 0 to keep their peak
+    std::map<std::string, Resource> mResources;
+    VkDeviceSize                    mTotal     = 0;
+    VkDeviceSize                    mTotalPeak = 0;
+    /// @brief Set by ImguiWindow while the window is expanded, consumed by OnFrame
+    bool mWindowOpen = false;
+};
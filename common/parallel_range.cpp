@@ -0,0 +1,35 @@
+#include "parallel_range.hpp"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+uint32_t ResolveThreadCount(uint32_t threadCount)
+{
+    if(threadCount == 0)
+    {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+    return threadCount;
+}
+
+void ParallelRange(uint32_t count, uint32_t threadCount, const std::function<void(uint32_t, uint32_t)>& fn)
+{
+    threadCount = std::min(ResolveThreadCount(threadCount), std::max(count, 1U));
+    if(threadCount <= 1)
+    {
+        fn(0, count);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+    uint32_t perThread = (count + threadCount - 1) / threadCount;
+    for(uint32_t begin = 0; begin < count; begin += perThread)
+    {
+        threads.emplace_back(fn, begin, std::min(begin + perThread, count));
+    }
+    for(std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
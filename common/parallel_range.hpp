@@ -0,0 +1,10 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+
+/// @brief 0 = one thread per hardware thread, otherwise threadCount
+uint32_t ResolveThreadCount(uint32_t threadCount);
+
+/// @brief Calls fn(begin, end) for contiguous ranges of [0, count) on up to threadCount threads (see ResolveThreadCount)
+/// and returns once all ranges are done. Runs on the calling thread if only one thread is used.
+void ParallelRange(uint32_t count, uint32_t threadCount, const std::function<void(uint32_t, uint32_t)>& fn);
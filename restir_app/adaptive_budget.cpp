@@ -0,0 +1,60 @@
+#include "adaptive_budget.hpp"
+#include <cstddef>
+
+void AdaptiveBudget::Create(foray::core::Context* context)
+{
+    mContext = context;
+    CreateBuffer();
+}
+
+void AdaptiveBudget::Resize()
+{
+    mBuffer.Destroy();
+    CreateBuffer();
+}
+
+void AdaptiveBudget::CreateBuffer()
+{
+    VkExtent2D   size = mContext->GetSwapchainSize();
+    VkDeviceSize bytes = sizeof(Header) + (VkDeviceSize)size.width * size.height * sizeof(uint32_t);
+    mBuffer.Create(mContext, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, bytes, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0, "AdaptiveBudget");
+    mCleared = false;
+}
+
+void AdaptiveBudget::AddShaderDefinitions(std::unordered_map<std::string, std::string>& definitions)
+{
+    definitions["ADAPTIVE_BUDGET_WEIGHT_SCALE"] = std::to_string(WEIGHT_SCALE);
+}
+
+void AdaptiveBudget::CmdBeginFrame(VkCommandBuffer cmdBuffer, uint64_t frameNumber, bool restart)
+{
+    // last frames raygen and spatial reuse may still access the buffer
+    VkMemoryBarrier clearBarrier{.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                 .srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                                 .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT};
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1,
+                         &clearBarrier, 0, nullptr, 0, nullptr);
+
+    if(restart || !mCleared)
+    {
+        vkCmdFillBuffer(cmdBuffer, mBuffer.GetBuffer(), 0, sizeof(Header), 0);
+        mCleared = true;
+    }
+    else
+    {
+        uint32_t slot = (uint32_t)(frameNumber % 2);
+        vkCmdFillBuffer(cmdBuffer, mBuffer.GetBuffer(), offsetof(Header, WeightSum) + slot * sizeof(uint32_t), sizeof(uint32_t), 0);
+        vkCmdFillBuffer(cmdBuffer, mBuffer.GetBuffer(), offsetof(Header, PixelCount) + slot * sizeof(uint32_t), sizeof(uint32_t), 0);
+    }
+
+    VkMemoryBarrier readBarrier{.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                                .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                         &readBarrier, 0, nullptr, 0, nullptr);
+}
+
+void AdaptiveBudget::Destroy()
+{
+    mBuffer.Destroy();
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <foray_api.hpp>
+#include <string>
+#include <unordered_map>
+
+/// @brief Per pixel candidate and spatial neighbor budgets of the adaptive ReSTIR mode (shaders/restir/adaptiveBudget.glsl).
+/// Every pixel weights the fixed budget by the confidence of its reprojected history, more for disocclusions and unstable
+/// target functions, less for converged pixels. The weights are normalized by their sum over the previous frame, so the mean
+/// per pixel budget stays within the configured fraction of the fixed budget.
+/// The buffer holds the weight sums of two frames (written and read alternately) and the neighbor budget of every output pixel,
+/// written by the raygen shader for the compute spatial reuse.
+class AdaptiveBudget
+{
+  public:
+    /// @brief Weights are summed in this fixed point scale
+    static constexpr uint32_t WEIGHT_SCALE = 64;
+
+    void Create(foray::core::Context* context);
+    /// @brief Reallocates the buffer for the new output extent, the descriptor sets referencing it have to be updated
+    void Resize();
+    void Destroy();
+    inline bool Exists() const { return mBuffer.Exists(); }
+
+    /// @brief ADAPTIVE_BUDGET_WEIGHT_SCALE for every shader including adaptiveBudget.glsl
+    static void AddShaderDefinitions(std::unordered_map<std::string, std::string>& definitions);
+
+    /// @brief Clears the weight sum this frame writes, record before the raygen pass. After a resize or a restart
+    /// (restart = true) the sum of the other frame is cleared too, the next frame then runs unnormalized.
+    void CmdBeginFrame(VkCommandBuffer cmdBuffer, uint64_t frameNumber, bool restart);
+
+    /// @brief Bound at set 0 binding 28
+    inline foray::core::ManagedBuffer& GetBuffer() { return mBuffer; }
+
+  protected:
+    /// @brief std430 header of the buffer, followed by one neighbor budget per output pixel
+    struct Header
+    {
+        uint32_t WeightSum[2];
+        uint32_t PixelCount[2];
+    };
+
+    void CreateBuffer();
+
+    foray::core::Context*      mContext = nullptr;
+    foray::core::ManagedBuffer mBuffer;
+    bool                       mCleared = false;
+};
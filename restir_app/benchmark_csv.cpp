@@ -0,0 +1,95 @@
+#include "benchmark_csv.hpp"
+#include <foray_api.hpp>
+#include <fstream>
+#include <imgui/imgui.h>
+
+void BenchmarkCsv::Begin(const std::string& path, uint32_t frameCount)
+{
+    mPath       = path;
+    mFrameCount = frameCount;
+    mRecording  = true;
+    mHeader.clear();
+    mRows.clear();
+    mRows.reserve(frameCount);
+}
+
+void BenchmarkCsv::RecordFrame(const Row& row)
+{
+    if(!mRecording)
+    {
+        return;
+    }
+    if(mHeader.empty())
+    {
+        for(const auto& [name, value] : row)
+        {
+            mHeader.push_back(name);
+        }
+    }
+
+    std::vector<double>& values = mRows.emplace_back();
+    values.reserve(row.size());
+    for(const auto& [name, value] : row)
+    {
+        values.push_back(value);
+    }
+
+    if(mRows.size() >= mFrameCount)
+    {
+        End();
+    }
+}
+
+void BenchmarkCsv::End()
+{
+    if(!mRecording)
+    {
+        return;
+    }
+    mRecording = false;
+    Write();
+}
+
+void BenchmarkCsv::Write()
+{
+    std::ofstream file(mPath, std::ios::trunc);
+    if(!file.is_open())
+    {
+        foray::logger()->warn("Unable to write benchmark csv \"{}\"", mPath);
+        return;
+    }
+
+    for(size_t i = 0; i < mHeader.size(); i++)
+    {
+        file << (i > 0 ? "," : "") << mHeader[i];
+    }
+    file << "\n";
+    for(const std::vector<double>& values : mRows)
+    {
+        for(size_t i = 0; i < values.size(); i++)
+        {
+            file << (i > 0 ? "," : "") << values[i];
+        }
+        file << "\n";
+    }
+    foray::logger()->info("Wrote {} benchmark frames to \"{}\"", mRows.size(), mPath);
+}
+
+void BenchmarkCsv::ImguiControls(const std::string& path)
+{
+    if(mRecording)
+    {
+        ImGui::Text("Recording benchmark: %zu / %u frames", mRows.size(), mFrameCount);
+        if(ImGui::Button("Stop recording"))
+        {
+            End();
+        }
+        return;
+    }
+
+    ImGui::InputInt("Benchmark frames", &mImguiFrameCount);
+    if(ImGui::Button("Record benchmark csv") && mImguiFrameCount > 0)
+    {
+        Begin(path, (uint32_t)mImguiFrameCount);
+    }
+}
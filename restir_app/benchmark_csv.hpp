@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/// @brief Records one row of named values per frame and writes them as CSV once the requested frame count is reached.
+/// The header is taken from the column names of the first recorded frame.
+class BenchmarkCsv
+{
+  public:
+    using Row = std::vector<std::pair<std::string, double>>;
+
+    void Begin(const std::string& path, uint32_t frameCount);
+    /// @brief Writes the rows recorded so far and stops recording
+    void End();
+    inline bool IsRecording() const { return mRecording; }
+
+    void RecordFrame(const Row& row);
+
+    /// @brief Draws start/stop controls into the current ImGui window
+    void ImguiControls(const std::string& path);
+
+  protected:
+    void Write();
+
+    bool                             mRecording       = false;
+    uint32_t                         mFrameCount      = 0;
+    int                              mImguiFrameCount = 1000;
+    std::string                      mPath;
+    std::vector<std::string>         mHeader;
+    std::vector<std::vector<double>> mRows;
+};
@@ -0,0 +1,75 @@
+#include "compute_pass.hpp"
+#include "host_trace.hpp"
+
+void ComputePass::Create(foray::core::Context*                               context,
+                         const std::string&                                  shaderPath,
+                         const std::vector<VkDescriptorSetLayout>&           descriptorSetLayouts,
+                         uint32_t                                            pushConstantSize,
+                         std::string_view                                    name,
+                         const std::unordered_map<std::string, std::string>& definitions)
+{
+    TraceScope trace(name, "compute pass");
+    mContext          = context;
+    mPushConstantSize = pushConstantSize;
+
+    foray::core::ShaderCompilerConfig options{.IncludeDirs = {FORAY_SHADER_DIR}, .Definitions = definitions};
+    mShaderKey = mShader.CompileFromSource(mContext, shaderPath, options);
+    mShader.SetName(std::string(name) + "_Shader");
+
+    VkPushConstantRange pushConstantRange{.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .offset = 0, .size = pushConstantSize};
+
+    VkPipelineLayoutCreateInfo layoutCi{.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+                                        .setLayoutCount         = (uint32_t)descriptorSetLayouts.size(),
+                                        .pSetLayouts            = descriptorSetLayouts.data(),
+                                        .pushConstantRangeCount = pushConstantSize > 0 ? 1U : 0U,
+                                        .pPushConstantRanges    = &pushConstantRange};
+    foray::AssertVkResult(vkCreatePipelineLayout(mContext->Device(), &layoutCi, nullptr, &mPipelineLayout));
+
+    VkComputePipelineCreateInfo pipelineCi{
+        .sType  = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage  = VkPipelineShaderStageCreateInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, .stage = VK_SHADER_STAGE_COMPUTE_BIT, .module = mShader, .pName = "main"},
+        .layout = mPipelineLayout,
+    };
+    foray::AssertVkResult(vkCreateComputePipelines(mContext->Device(), nullptr, 1, &pipelineCi, nullptr, &mPipeline));
+}
+
+void ComputePass::Destroy()
+{
+    if(mPipeline != nullptr)
+    {
+        vkDestroyPipeline(mContext->Device(), mPipeline, nullptr);
+        mPipeline = nullptr;
+    }
+    if(mPipelineLayout != nullptr)
+    {
+        vkDestroyPipelineLayout(mContext->Device(), mPipelineLayout, nullptr);
+        mPipelineLayout = nullptr;
+    }
+    if(mShader.Exists())
+    {
+        mShader.Destroy();
+    }
+}
+
+void ComputePass::CmdBind(VkCommandBuffer cmdBuffer, const std::vector<VkDescriptorSet>& descriptorSets)
+{
+    vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeline);
+    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, (uint32_t)descriptorSets.size(), descriptorSets.data(), 0, nullptr);
+}
+
+void ComputePass::CmdPushConstants(VkCommandBuffer cmdBuffer, const void* data, uint32_t size)
+{
+    foray::Assert(size <= mPushConstantSize, "Push constant data exceeds the declared range");
+    vkCmdPushConstants(cmdBuffer, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, size, data);
+}
+
+void ComputePass::CmdDispatch(VkCommandBuffer cmdBuffer, VkExtent2D extent, glm::uvec2 localSize)
+{
+    glm::uvec3 groupCount((extent.width + localSize.x - 1) / localSize.x, (extent.height + localSize.y - 1) / localSize.y, 1);
+    CmdDispatch(cmdBuffer, groupCount);
+}
+
+void ComputePass::CmdDispatch(VkCommandBuffer cmdBuffer, glm::uvec3 groupCount)
+{
+    vkCmdDispatch(cmdBuffer, groupCount.x, groupCount.y, groupCount.z);
+}
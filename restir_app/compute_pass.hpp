@@ -0,0 +1,37 @@
+#pragma once
+#include <foray_api.hpp>
+#include <foray_glm.hpp>
+#include <unordered_map>
+
+/// @brief Thin compute pipeline wrapper for the auxiliary passes around the ReSTIR raytracing stage.
+/// Descriptor sets are owned by the caller, the pass only owns its shader module, pipeline layout and pipeline.
+class ComputePass
+{
+  public:
+    void Create(foray::core::Context*                               context,
+                const std::string&                                  shaderPath,
+                const std::vector<VkDescriptorSetLayout>&           descriptorSetLayouts,
+                uint32_t                                            pushConstantSize = 0,
+                std::string_view                                    name             = "ComputePass",
+                const std::unordered_map<std::string, std::string>& definitions      = {});
+    void Destroy();
+    inline bool Exists() const { return mPipeline != nullptr; }
+
+    void CmdBind(VkCommandBuffer cmdBuffer, const std::vector<VkDescriptorSet>& descriptorSets);
+    void CmdPushConstants(VkCommandBuffer cmdBuffer, const void* data, uint32_t size);
+
+    /// @brief Dispatches enough workgroups of localSize to cover extent
+    void CmdDispatch(VkCommandBuffer cmdBuffer, VkExtent2D extent, glm::uvec2 localSize = glm::uvec2(8, 8));
+    void CmdDispatch(VkCommandBuffer cmdBuffer, glm::uvec3 groupCount);
+
+    inline uint64_t         GetShaderKey() const { return mShaderKey; }
+    inline VkPipelineLayout GetPipelineLayout() const { return mPipelineLayout; }
+
+  protected:
+    foray::core::Context*     mContext = nullptr;
+    foray::core::ShaderModule mShader;
+    uint64_t                  mShaderKey        = 0;
+    uint32_t                  mPushConstantSize = 0;
+    VkPipelineLayout          mPipelineLayout   = nullptr;
+    VkPipeline                mPipeline         = nullptr;
+};
@@ -0,0 +1,272 @@
+#include "denoiser_stage.hpp"
+#include <algorithm>
+#include <imgui/imgui.h>
+
+void DenoiserStage::Init(foray::core::Context* context, foray::stages::GBufferStage* gbufferStage, foray::stages::RenderStage* inputStage, const std::string& inputName)
+{
+    mContext      = context;
+    mGBufferStage = gbufferStage;
+    mInputStage   = inputStage;
+    mInputName    = inputName;
+
+    CreateImages();
+    CreateOrUpdateDescriptorSet();
+
+    std::vector<VkDescriptorSetLayout> layouts{mDescriptorSet.GetDescriptorSetLayout()};
+    mTemporalPass.Create(mContext, TEMPORAL_FILE, layouts, sizeof(PushConstantTemporal), "SvgfTemporal");
+    mAtrousPass.Create(mContext, ATROUS_FILE, layouts, sizeof(PushConstantAtrous), "SvgfAtrous");
+    mPassTimer.Create(mContext, {"Denoise temporal", "Denoise a-trous"});
+}
+
+void DenoiserStage::CreateImages()
+{
+    mInput = mInputStage->GetImageOutput(mInputName);
+
+    VkExtent2D        extent       = mContext->GetSwapchainSize();
+    VkImageUsageFlags storageUsage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    for(uint32_t i = 0; i < 2; i++)
+    {
+        std::string suffix = std::to_string(i);
+        mColorHistory[i].Create(mContext, foray::core::ManagedImage::CreateInfo(storageUsage, VK_FORMAT_R16G16B16A16_SFLOAT, extent, "SvgfColorHistory" + suffix));
+        mMomentsHistory[i].Create(mContext, foray::core::ManagedImage::CreateInfo(storageUsage, VK_FORMAT_R16G16B16A16_SFLOAT, extent, "SvgfMomentsHistory" + suffix));
+        mSurfaceHistory[i].Create(mContext, foray::core::ManagedImage::CreateInfo(storageUsage, VK_FORMAT_R32G32B32A32_SFLOAT, extent, "SvgfSurfaceHistory" + suffix));
+        mFilterImages[i].Create(mContext, foray::core::ManagedImage::CreateInfo(storageUsage, VK_FORMAT_R16G16B16A16_SFLOAT, extent, "SvgfFilter" + suffix));
+    }
+
+    // same format as the input, so it can be copied through while disabled and drawn over by the raster debug stages
+    VkImageUsageFlags outputUsage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT
+                                    | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    mOutput.Create(mContext, foray::core::ManagedImage::CreateInfo(outputUsage, mInput->GetFormat(), extent, OutputName));
+    mImageOutputs[OutputName] = &mOutput;
+
+    mInputSampled.Init(mContext, mInput, mSamplerCi);
+    mGuidesSampled[GUIDE_ALBEDO].Init(mContext, mGBufferStage->GetImageEOutput(foray::stages::GBufferStage::EOutput::Albedo), mSamplerCi);
+    mGuidesSampled[GUIDE_NORMAL].Init(mContext, mGBufferStage->GetImageEOutput(foray::stages::GBufferStage::EOutput::Normal), mSamplerCi);
+    mGuidesSampled[GUIDE_POS].Init(mContext, mGBufferStage->GetImageEOutput(foray::stages::GBufferStage::EOutput::Position), mSamplerCi);
+    mGuidesSampled[GUIDE_MOTION].Init(mContext, mGBufferStage->GetImageEOutput(foray::stages::GBufferStage::EOutput::Motion), mSamplerCi);
+
+    mResetHistory = true;
+}
+
+void DenoiserStage::DestroyImages()
+{
+    for(foray::core::CombinedImageSampler& sampler : mGuidesSampled)
+    {
+        sampler.Destroy();
+    }
+    mInputSampled.Destroy();
+
+    for(uint32_t i = 0; i < 2; i++)
+    {
+        mColorHistory[i].Destroy();
+        mMomentsHistory[i].Destroy();
+        mSurfaceHistory[i].Destroy();
+        mFilterImages[i].Destroy();
+    }
+    mOutput.Destroy();
+}
+
+void DenoiserStage::CreateOrUpdateDescriptorSet()
+{
+    mDescriptorSet.SetDescriptorAt(0, std::vector<const foray::core::CombinedImageSampler*>{&mInputSampled}, VK_IMAGE_LAYOUT_GENERAL,
+                                   VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT);
+    for(uint32_t i = 0; i < mGuidesSampled.size(); i++)
+    {
+        mDescriptorSet.SetDescriptorAt(1 + i, std::vector<const foray::core::CombinedImageSampler*>{&mGuidesSampled[i]}, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                       VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT);
+    }
+
+    auto storageInfos = [](std::array<foray::core::ManagedImage, 2>& images) {
+        return std::vector<VkDescriptorImageInfo>{VkDescriptorImageInfo{.imageView = images[0].GetImageView(), .imageLayout = VK_IMAGE_LAYOUT_GENERAL},
+                                                  VkDescriptorImageInfo{.imageView = images[1].GetImageView(), .imageLayout = VK_IMAGE_LAYOUT_GENERAL}};
+    };
+    mDescriptorSet.SetDescriptorAt(5, storageInfos(mColorHistory), VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT);
+    mDescriptorSet.SetDescriptorAt(6, storageInfos(mMomentsHistory), VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT);
+    mDescriptorSet.SetDescriptorAt(7, storageInfos(mSurfaceHistory), VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT);
+    mDescriptorSet.SetDescriptorAt(8, storageInfos(mFilterImages), VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT);
+
+    std::vector<VkDescriptorImageInfo> outputInfos{VkDescriptorImageInfo{.imageView = mOutput.GetImageView(), .imageLayout = VK_IMAGE_LAYOUT_GENERAL}};
+    mDescriptorSet.SetDescriptorAt(9, outputInfos, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT);
+
+    if(mDescriptorSet.Exists())
+    {
+        mDescriptorSet.Update();
+    }
+    else
+    {
+        mDescriptorSet.Create(mContext, "Denoiser_DescriptorSet");
+    }
+}
+
+void DenoiserStage::Resize(const VkExtent2D& extent)
+{
+    DestroyImages();
+    CreateImages();
+    CreateOrUpdateDescriptorSet();
+}
+
+void DenoiserStage::RecordFrame(VkCommandBuffer cmdBuffer, foray::base::FrameRenderInfo& renderInfo)
+{
+    uint64_t frameNumber = renderInfo.GetFrameNumber();
+    mPassTimer.CmdBeginFrame(cmdBuffer, frameNumber);
+
+    if(!mSettings.Enabled)
+    {
+        CmdCopyInputToOutput(cmdBuffer, renderInfo);
+        // accumulated history does not match the frames skipped
+        mResetHistory = true;
+        return;
+    }
+
+    CmdPrepareImages(cmdBuffer, renderInfo);
+
+    VkExtent2D extent  = mContext->GetSwapchainSize();
+    uint32_t   current = frameNumber % 2;
+
+    PushConstantTemporal temporalConfig{.Current      = current,
+                                        .ResetHistory = mResetHistory,
+                                        .ColorAlpha   = mSettings.ColorAlpha,
+                                        .MomentsAlpha = mSettings.MomentsAlpha,
+                                        .PhiNormal    = mSettings.PhiNormal,
+                                        .PhiPosition  = mSettings.PhiPosition};
+    mResetHistory = false;
+
+    mPassTimer.CmdBeginPass(cmdBuffer, PASS_TEMPORAL);
+    mTemporalPass.CmdBind(cmdBuffer, {mDescriptorSet.GetDescriptorSet()});
+    mTemporalPass.CmdPushConstants(cmdBuffer, &temporalConfig, sizeof(temporalConfig));
+    mTemporalPass.CmdDispatch(cmdBuffer, extent);
+    mPassTimer.CmdEndPass(cmdBuffer, PASS_TEMPORAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    // temporal pass writes the first filter image, each iteration reads one and writes the other (or the output)
+    uint32_t iterations = std::max(mSettings.AtrousIterations, 1U);
+    mPassTimer.CmdBeginPass(cmdBuffer, PASS_ATROUS);
+    mAtrousPass.CmdBind(cmdBuffer, {mDescriptorSet.GetDescriptorSet()});
+    for(uint32_t i = 0; i < iterations; i++)
+    {
+        CmdComputeBarrier(cmdBuffer);
+        PushConstantAtrous atrousConfig{.StepSize    = 1 << i,
+                                        .Source      = i % 2,
+                                        .WriteOutput = i + 1 == iterations,
+                                        .PhiColor    = mSettings.PhiColor,
+                                        .PhiNormal   = mSettings.PhiNormal,
+                                        .PhiPosition = mSettings.PhiPosition};
+        mAtrousPass.CmdPushConstants(cmdBuffer, &atrousConfig, sizeof(atrousConfig));
+        mAtrousPass.CmdDispatch(cmdBuffer, extent);
+    }
+    mPassTimer.CmdEndPass(cmdBuffer, PASS_ATROUS, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+}
+
+void DenoiserStage::CmdPrepareImages(VkCommandBuffer cmdBuffer, foray::base::FrameRenderInfo& renderInfo)
+{
+    foray::core::ImageLayoutCache&    layoutCache = renderInfo.GetImageLayoutCache();
+    std::vector<VkImageMemoryBarrier> barriers;
+
+    for(foray::stages::GBufferStage::EOutput output : {foray::stages::GBufferStage::EOutput::Albedo, foray::stages::GBufferStage::EOutput::Normal,
+                                                       foray::stages::GBufferStage::EOutput::Position, foray::stages::GBufferStage::EOutput::Motion})
+    {
+        foray::core::ImageLayoutCache::Barrier barrier;
+        barrier.SrcAccessMask               = VK_ACCESS_MEMORY_WRITE_BIT;
+        barrier.DstAccessMask               = VK_ACCESS_SHADER_READ_BIT;
+        barrier.NewLayout                   = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.SubresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barriers.push_back(layoutCache.MakeBarrier(mGBufferStage->GetImageEOutput(output), barrier));
+    }
+
+    // input is written by the ReSTIR stage as storage image
+    foray::core::ImageLayoutCache::Barrier inputBarrier;
+    inputBarrier.SrcAccessMask               = VK_ACCESS_MEMORY_WRITE_BIT;
+    inputBarrier.DstAccessMask               = VK_ACCESS_SHADER_READ_BIT;
+    inputBarrier.NewLayout                   = VK_IMAGE_LAYOUT_GENERAL;
+    inputBarrier.SubresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barriers.push_back(layoutCache.MakeBarrier(mInput, inputBarrier));
+
+    // history is read and written, previous contents are kept as the layout stays general after the first frame
+    std::vector<foray::core::ManagedImage*> storageImages{&mOutput};
+    for(uint32_t i = 0; i < 2; i++)
+    {
+        storageImages.insert(storageImages.end(), {&mColorHistory[i], &mMomentsHistory[i], &mSurfaceHistory[i], &mFilterImages[i]});
+    }
+    for(foray::core::ManagedImage* image : storageImages)
+    {
+        foray::core::ImageLayoutCache::Barrier barrier;
+        barrier.SrcAccessMask               = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+        barrier.DstAccessMask               = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.NewLayout                   = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.SubresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barriers.push_back(layoutCache.MakeBarrier(image, barrier));
+    }
+
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, barriers.size(), barriers.data());
+}
+
+void DenoiserStage::CmdComputeBarrier(VkCommandBuffer cmdBuffer)
+{
+    VkMemoryBarrier barrier{.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+                            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void DenoiserStage::CmdCopyInputToOutput(VkCommandBuffer cmdBuffer, foray::base::FrameRenderInfo& renderInfo)
+{
+    foray::core::ImageLayoutCache& layoutCache = renderInfo.GetImageLayoutCache();
+
+    foray::core::ImageLayoutCache::Barrier srcBarrier;
+    srcBarrier.SrcAccessMask               = VK_ACCESS_MEMORY_WRITE_BIT;
+    srcBarrier.DstAccessMask               = VK_ACCESS_TRANSFER_READ_BIT;
+    srcBarrier.NewLayout                   = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    srcBarrier.SubresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+
+    foray::core::ImageLayoutCache::Barrier dstBarrier;
+    dstBarrier.SrcAccessMask               = VK_ACCESS_MEMORY_READ_BIT;
+    dstBarrier.DstAccessMask               = VK_ACCESS_TRANSFER_WRITE_BIT;
+    dstBarrier.NewLayout                   = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    dstBarrier.SubresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+
+    std::vector<VkImageMemoryBarrier> barriers{layoutCache.MakeBarrier(mInput, srcBarrier), layoutCache.MakeBarrier(&mOutput, dstBarrier)};
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, barriers.size(), barriers.data());
+
+    VkImageCopy region{.srcSubresource = VkImageSubresourceLayers{VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+                       .dstSubresource = VkImageSubresourceLayers{VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+                       .extent         = mOutput.GetExtent3D()};
+    vkCmdCopyImage(cmdBuffer, mInput->GetImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, mOutput.GetImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+}
+
+void DenoiserStage::PrepareImguiWindow(foray::stages::ImguiStage* imguiStage)
+{
+    imguiStage->AddWindowDraw([this]() {
+        ImGui::Begin("Denoiser");
+        ImGui::Checkbox("Enable denoiser", &mSettings.Enabled);
+        if(mSettings.Enabled)
+        {
+            ImGui::SliderInt("A-trous iterations", (int*)&mSettings.AtrousIterations, 1, 6);
+            ImGui::SliderFloat("Color alpha", &mSettings.ColorAlpha, 0.01f, 1.f);
+            ImGui::SliderFloat("Moments alpha", &mSettings.MomentsAlpha, 0.01f, 1.f);
+            ImGui::SliderFloat("Phi color", &mSettings.PhiColor, 0.1f, 16.f);
+            ImGui::SliderFloat("Phi normal", &mSettings.PhiNormal, 1.f, 256.f);
+            ImGui::SliderFloat("Phi position", &mSettings.PhiPosition, 0.01f, 1.f);
+        }
+        ImGui::Separator();
+        mPassTimer.ImguiPassTimes();
+        ImGui::End();
+    });
+}
+
+void DenoiserStage::AppendBenchmarkColumns(BenchmarkCsv::Row& row) const
+{
+    for(uint32_t pass = 0; pass < mPassTimer.GetPassNames().size(); pass++)
+    {
+        row.emplace_back(mPassTimer.GetPassNames()[pass] + " ms", mSettings.Enabled ? mPassTimer.GetLastPassMs(pass) : 0.0);
+    }
+    row.emplace_back("denoiser a-trous iterations", mSettings.Enabled ? mSettings.AtrousIterations : 0U);
+}
+
+void DenoiserStage::Destroy()
+{
+    mPassTimer.Destroy();
+    mAtrousPass.Destroy();
+    mTemporalPass.Destroy();
+    mDescriptorSet.Destroy();
+    DestroyImages();
+    mImageOutputs.clear();
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include "benchmark_csv.hpp"
+#include "compute_pass.hpp"
+#include "gpu_pass_timer.hpp"
+#include <array>
+#include <foray_api.hpp>
+
+/// @brief SVGF style denoiser running on the ReSTIR output: temporal accumulation of the albedo demodulated illumination,
+/// followed by an edge-aware a-trous wavelet filter guided by the GBuffer (normal, world position) and variance.
+/// Reprojection uses the GBuffer motion vectors. The stage keeps its own color, moments and surface history, as the
+/// ReSTIR history images are overwritten with the current frame before the denoiser runs.
+class DenoiserStage : public foray::stages::RenderStage
+{
+  public:
+    struct Settings
+    {
+        bool     Enabled          = true;
+        uint32_t AtrousIterations = 4;
+        /// @brief Blend weight of the current frame, once the history is long enough
+        float ColorAlpha   = 0.2f;
+        float MomentsAlpha = 0.2f;
+        float PhiColor     = 4.f;
+        float PhiNormal    = 128.f;
+        float PhiPosition  = 0.1f;
+    };
+
+    static inline const std::string OutputName = "Denoiser.Output";
+
+    void Init(foray::core::Context* context, foray::stages::GBufferStage* gbufferStage, foray::stages::RenderStage* inputStage, const std::string& inputName);
+
+    virtual void RecordFrame(VkCommandBuffer cmdBuffer, foray::base::FrameRenderInfo& renderInfo) override;
+    virtual void Resize(const VkExtent2D& extent) override;
+    virtual void Destroy() override;
+    virtual void OnShadersRecompiled(const std::unordered_set<uint64_t>& recompiled) override{};
+
+    void PrepareImguiWindow(foray::stages::ImguiStage* imguiStage);
+
+    /// @brief Adds the denoiser pass timings of the last frame
+    void AppendBenchmarkColumns(BenchmarkCsv::Row& row) const;
+
+    inline Settings& GetSettings() { return mSettings; }
+
+  protected:
+    struct PushConstantTemporal
+    {
+        uint32_t Current;
+        VkBool32 ResetHistory;
+        float    ColorAlpha;
+        float    MomentsAlpha;
+        float    PhiNormal;
+        float    PhiPosition;
+    };
+
+    struct PushConstantAtrous
+    {
+        int32_t  StepSize;
+        uint32_t Source;
+        VkBool32 WriteOutput;
+        float    PhiColor;
+        float    PhiNormal;
+        float    PhiPosition;
+    };
+
+    void CreateImages();
+    void DestroyImages();
+    void CreateOrUpdateDescriptorSet();
+
+    void CmdPrepareImages(VkCommandBuffer cmdBuffer, foray::base::FrameRenderInfo& renderInfo);
+    void CmdComputeBarrier(VkCommandBuffer cmdBuffer);
+    /// @brief Used while the denoiser is disabled, so the output always holds the last frame
+    void CmdCopyInputToOutput(VkCommandBuffer cmdBuffer, foray::base::FrameRenderInfo& renderInfo);
+
+    static inline const std::string TEMPORAL_FILE = "shaders/denoiser/svgfTemporal.comp";
+    static inline const std::string ATROUS_FILE   = "shaders/denoiser/svgfAtrous.comp";
+
+    enum GuideImages
+    {
+        GUIDE_ALBEDO = 0,
+        GUIDE_NORMAL = 1,
+        GUIDE_POS    = 2,
+        GUIDE_MOTION = 3,
+    };
+
+    Settings mSettings;
+
+    foray::stages::GBufferStage* mGBufferStage{};
+    foray::stages::RenderStage*  mInputStage{};
+    std::string                  mInputName;
+    foray::core::ManagedImage*   mInput{};
+
+    foray::core::CombinedImageSampler                mInputSampled;
+    std::array<foray::core::CombinedImageSampler, 4> mGuidesSampled;
+
+    // ping pong by frame number
+    std::array<foray::core::ManagedImage, 2> mColorHistory;
+    std::array<foray::core::ManagedImage, 2> mMomentsHistory;
+    std::array<foray::core::ManagedImage, 2> mSurfaceHistory;
+    // ping pong between a-trous iterations
+    std::array<foray::core::ManagedImage, 2> mFilterImages;
+    foray::core::ManagedImage                mOutput;
+    bool                                     mResetHistory = true;
+
+    foray::core::DescriptorSet mDescriptorSet;
+    ComputePass                mTemporalPass;
+    ComputePass                mAtrousPass;
+
+    enum TimedPass
+    {
+        PASS_TEMPORAL = 0,
+        PASS_ATROUS   = 1,
+    };
+    GpuPassTimer mPassTimer;
+
+    static constexpr VkSamplerCreateInfo mSamplerCi = VkSamplerCreateInfo{.sType                   = VkStructureType::VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+                                                                          .magFilter               = VkFilter::VK_FILTER_NEAREST,
+                                                                          .minFilter               = VkFilter::VK_FILTER_NEAREST,
+                                                                          .addressModeU            = VkSamplerAddressMode::VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                                          .addressModeV            = VkSamplerAddressMode::VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                                          .addressModeW            = VkSamplerAddressMode::VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                                          .anisotropyEnable        = VK_FALSE,
+                                                                          .compareEnable           = VK_FALSE,
+                                                                          .minLod                  = 0,
+                                                                          .maxLod                  = 0,
+                                                                          .unnormalizedCoordinates = VK_FALSE};
+};
@@ -0,0 +1,78 @@
+#include "dynamic_resolution.hpp"
+#include <algorithm>
+#include <cmath>
+#include <imgui/imgui.h>
+
+float DynamicResolutionController::Update(float measuredMs, bool workloadChanged)
+{
+    mMeasuredMs = measuredMs;
+    if(!mSettings.Enabled)
+    {
+        mScale = std::clamp(mSettings.ManualScale, mSettings.MinScale, mSettings.MaxScale);
+        return mScale;
+    }
+    if(measuredMs <= 0.f)
+    {
+        // no timing available yet
+        return mScale;
+    }
+
+    // positive error => frame is faster than the target => scale up
+    float error = (mSettings.TargetMs - measuredMs) / mSettings.TargetMs;
+    mDerivative = workloadChanged ? 0.f : error - mError;
+    mError      = error;
+
+    float output = mSettings.MaxScale + mSettings.Kp * error + mSettings.Ki * (mIntegral + error) + mSettings.Kd * mDerivative;
+
+    // conditional integration as anti windup: stop integrating while the output saturates in the direction of the error
+    bool saturatedHigh = output >= mSettings.MaxScale && error > 0.f;
+    bool saturatedLow  = output <= mSettings.MinScale && error < 0.f;
+    if(!saturatedHigh && !saturatedLow)
+    {
+        mIntegral += error;
+    }
+
+    float scale = std::clamp(output, mSettings.MinScale, mSettings.MaxScale);
+    if(std::abs(scale - mScale) >= mSettings.Hysteresis || scale == mSettings.MinScale || scale == mSettings.MaxScale)
+    {
+        mScale = scale;
+    }
+    return mScale;
+}
+
+VkExtent2D DynamicResolutionController::GetRenderExtent(VkExtent2D fullExtent) const
+{
+    uint32_t width  = (uint32_t)std::lround(fullExtent.width * mScale);
+    uint32_t height = (uint32_t)std::lround(fullExtent.height * mScale);
+    return VkExtent2D{std::clamp(width, 1u, fullExtent.width), std::clamp(height, 1u, fullExtent.height)};
+}
+
+void DynamicResolutionController::Reset()
+{
+    mScale      = mSettings.MaxScale;
+    mError      = 0.f;
+    mIntegral   = 0.f;
+    mDerivative = 0.f;
+}
+
+void DynamicResolutionController::ImguiControls()
+{
+    if(ImGui::Checkbox("Dynamic resolution", &mSettings.Enabled))
+    {
+        Reset();
+    }
+    if(mSettings.Enabled)
+    {
+        ImGui::SliderFloat("Target GPU ms", &mSettings.TargetMs, 1.f, 50.f);
+        ImGui::SliderFloat("Kp", &mSettings.Kp, 0.f, 1.f);
+        ImGui::SliderFloat("Ki", &mSettings.Ki, 0.f, 0.5f);
+        ImGui::SliderFloat("Kd", &mSettings.Kd, 0.f, 0.5f);
+        ImGui::SliderFloat("Min scale", &mSettings.MinScale, 0.25f, 1.f);
+        ImGui::Text("Measured %.3f ms, error %.3f, integral %.3f, derivative %.3f", mMeasuredMs, mError, mIntegral, mDerivative);
+    }
+    else
+    {
+        ImGui::SliderFloat("Render scale", &mSettings.ManualScale, mSettings.MinScale, 1.f);
+    }
+    ImGui::Text("Current render scale: %.2f", mScale);
+}
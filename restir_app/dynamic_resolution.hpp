@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+/// @brief PID controller adjusting the ReSTIR render scale against a target GPU frame time.
+/// The error is normalized by the target time, so the gains do not depend on the target.
+class DynamicResolutionController
+{
+  public:
+    struct Settings
+    {
+        bool  Enabled  = false;
+        float TargetMs = 8.f;
+        float Kp       = 0.15f;
+        float Ki       = 0.05f;
+        float Kd       = 0.02f;
+        float MinScale = 0.5f;
+        float MaxScale = 1.f;
+        /// @brief Scale used while the controller is disabled
+        float ManualScale = 1.f;
+        /// @brief Scale changes smaller than this are not applied, avoids resizing the render extent every frame
+        float Hysteresis = 0.02f;
+    };
+
+    /// @brief Feeds the measured GPU time of the last frame and returns the render scale to use.
+    /// Set workloadChanged when the measured frame ran a different set of passes than the previous measurement, the step in
+    /// GPU time is then not treated as a trend (no derivative kick).
+    float Update(float measuredMs, bool workloadChanged = false);
+
+    /// @brief Render extent for the current scale, never larger than fullExtent
+    VkExtent2D GetRenderExtent(VkExtent2D fullExtent) const;
+
+    inline Settings& GetSettings() { return mSettings; }
+    inline bool      Enabled() const { return mSettings.Enabled; }
+    inline float     GetTargetMs() const { return mSettings.TargetMs; }
+    inline float     GetScale() const { return mScale; }
+    inline float     GetError() const { return mError; }
+    inline float     GetIntegral() const { return mIntegral; }
+    inline float     GetDerivative() const { return mDerivative; }
+    inline float     GetMeasuredMs() const { return mMeasuredMs; }
+
+    void Reset();
+
+    /// @brief Draws the controller settings and state into the current ImGui window
+    void ImguiControls();
+
+  protected:
+    Settings mSettings;
+    float    mScale      = 1.f;
+    float    mError      = 0.f;
+    float    mIntegral   = 0.f;
+    float    mDerivative = 0.f;
+    float    mMeasuredMs = 0.f;
+};
@@ -0,0 +1,239 @@
+#include "emissive_texture_integrator.hpp"
+#include "float_image.hpp"
+#include "host_trace.hpp"
+#include "parallel_range.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <scene/globalcomponents/foray_texturemanager.hpp>
+
+namespace {
+    float SrgbToLinear(uint8_t value)
+    {
+        float c = value / 255.f;
+        return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+}  // namespace
+
+void EmissiveTextureIntegrator::LoadTextures(foray::core::Context* context, foray::scene::Scene* scene, const std::set<int32_t>& textureIndices)
+{
+    auto textureManager = scene->GetComponent<foray::scene::gcomp::TextureManager>();
+    for(int32_t index : textureIndices)
+    {
+        if(index < 0 || index >= (int32_t)textureManager->GetTextures().size())
+        {
+            continue;
+        }
+        Texture texture;
+        if(ReadbackTexture(context, textureManager->GetTextures()[index].GetImage(), texture))
+        {
+            mTextures[index] = std::move(texture);
+        }
+    }
+}
+
+void EmissiveTextureIntegrator::Clear()
+{
+    mTextures.clear();
+}
+
+bool EmissiveTextureIntegrator::ReadbackTexture(foray::core::Context* context, foray::core::ManagedImage& image, Texture& texture)
+{
+    VkFormat format    = image.GetFormat();
+    bool     srgb      = format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_B8G8R8A8_SRGB;
+    bool     bgr       = format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+    uint32_t texelSize = 0;
+    switch(format)
+    {
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_B8G8R8A8_UNORM:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+            texelSize = 4;
+            break;
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+            texelSize = 8;
+            break;
+        case VK_FORMAT_R32G32B32A32_SFLOAT:
+            texelSize = 16;
+            break;
+        default:
+            foray::logger()->warn("Emissive texture format {} is not supported, using the emissive factor only", (int32_t)format);
+            return false;
+    }
+
+    // finest mip level within MAX_EXTENT, coarser levels are box filtered, so texel averages stay unbiased
+    VkExtent3D extent    = image.GetExtent3D();
+    uint32_t   mipLevels = image.GetCreateInfo().ImageCI.mipLevels;
+    uint32_t   level     = 0;
+    while(level + 1 < mipLevels && std::max(extent.width >> level, extent.height >> level) > MAX_EXTENT)
+    {
+        level++;
+    }
+    texture.Width  = std::max(extent.width >> level, 1U);
+    texture.Height = std::max(extent.height >> level, 1U);
+
+    VkDeviceSize               size = (VkDeviceSize)texture.Width * texture.Height * texelSize;
+    foray::core::ManagedBuffer staging;
+    staging.Create(context, VK_BUFFER_USAGE_TRANSFER_DST_BIT, size, VMA_MEMORY_USAGE_AUTO_PREFER_HOST, VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT,
+                   "EmissiveTextureReadback");
+
+    foray::core::HostSyncCommandBuffer cmdBuffer;
+    cmdBuffer.Create(context);
+    cmdBuffer.Begin();
+
+    // scene textures stay in shader read layout after upload
+    VkImageMemoryBarrier barrier{.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                                 .srcAccessMask       = VK_ACCESS_SHADER_READ_BIT,
+                                 .dstAccessMask       = VK_ACCESS_TRANSFER_READ_BIT,
+                                 .oldLayout           = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                 .newLayout           = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                 .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                 .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                 .image               = image.GetImage(),
+                                 .subresourceRange    = VkImageSubresourceRange{VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1}};
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{.bufferOffset      = 0,
+                             .bufferRowLength   = 0,
+                             .bufferImageHeight = 0,
+                             .imageSubresource  = VkImageSubresourceLayers{VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1},
+                             .imageOffset       = VkOffset3D{},
+                             .imageExtent       = VkExtent3D{texture.Width, texture.Height, 1}};
+    vkCmdCopyImageToBuffer(cmdBuffer, image.GetImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, staging.GetBuffer(), 1, &region);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    cmdBuffer.SubmitAndWait();
+    cmdBuffer.Destroy();
+
+    void* mapped = nullptr;
+    staging.Map(mapped);
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(mapped);
+
+    texture.Texels.resize((size_t)texture.Width * texture.Height);
+    for(size_t i = 0; i < texture.Texels.size(); i++)
+    {
+        const uint8_t* texel = bytes + i * texelSize;
+        glm::vec3&     color = texture.Texels[i];
+        if(texelSize == 4)
+        {
+            glm::vec3 rgb = bgr ? glm::vec3(texel[2], texel[1], texel[0]) : glm::vec3(texel[0], texel[1], texel[2]);
+            color         = srgb ? glm::vec3(SrgbToLinear((uint8_t)rgb.r), SrgbToLinear((uint8_t)rgb.g), SrgbToLinear((uint8_t)rgb.b)) : rgb / 255.f;
+        }
+        else if(texelSize == 8)
+        {
+            uint16_t halfs[3];
+            std::memcpy(halfs, texel, sizeof(halfs));
+            color = glm::vec3(HalfToFloat(halfs[0]), HalfToFloat(halfs[1]), HalfToFloat(halfs[2]));
+        }
+        else
+        {
+            std::memcpy(&color, texel, sizeof(color));
+        }
+    }
+    staging.Unmap();
+    staging.Destroy();
+    return true;
+}
+
+glm::vec3 EmissiveTextureIntegrator::Texture::Fetch(int32_t x, int32_t y) const
+{
+    // repeat addressing
+    x = ((x % (int32_t)Width) + (int32_t)Width) % (int32_t)Width;
+    y = ((y % (int32_t)Height) + (int32_t)Height) % (int32_t)Height;
+    return Texels[(size_t)y * Width + x];
+}
+
+glm::vec3 EmissiveTextureIntegrator::Texture::SampleBilinear(glm::vec2 uv) const
+{
+    glm::vec2 texel = uv * glm::vec2(Width, Height) - 0.5f;
+    glm::vec2 base  = glm::floor(texel);
+    glm::vec2 f     = texel - base;
+    int32_t   x     = (int32_t)base.x;
+    int32_t   y     = (int32_t)base.y;
+    glm::vec3 top   = glm::mix(Fetch(x, y), Fetch(x + 1, y), f.x);
+    glm::vec3 bot   = glm::mix(Fetch(x, y + 1), Fetch(x + 1, y + 1), f.x);
+    return glm::mix(top, bot, f.y);
+}
+
+glm::vec3 EmissiveTextureIntegrator::IntegrateTriangle(const Texture& texture, const Triangle& triangle) const
+{
+    glm::vec2 size(texture.Width, texture.Height);
+    glm::vec2 t0 = triangle.Uv[0] * size;
+    glm::vec2 t1 = triangle.Uv[1] * size;
+    glm::vec2 t2 = triangle.Uv[2] * size;
+
+    glm::vec2 minTexel = glm::floor(glm::min(t0, glm::min(t1, t2)));
+    glm::vec2 maxTexel = glm::ceil(glm::max(t0, glm::max(t1, t2)));
+
+    float doubleArea = (t1.x - t0.x) * (t2.y - t0.y) - (t2.x - t0.x) * (t1.y - t0.y);
+    float bboxTexels = (maxTexel.x - minTexel.x) * (maxTexel.y - minTexel.y);
+
+    // footprints spanning several repeats of the texture cover it about evenly
+    if(bboxTexels > 4.f * texture.Texels.size())
+    {
+        glm::vec3 sum(0.f);
+        for(const glm::vec3& texel : texture.Texels)
+        {
+            sum += texel;
+        }
+        return sum / (float)texture.Texels.size();
+    }
+
+    glm::vec3 sum(0.f);
+    uint32_t  count = 0;
+    if(std::abs(doubleArea) > 0.f)
+    {
+        float sign = doubleArea > 0.f ? 1.f : -1.f;
+        for(int32_t y = (int32_t)minTexel.y; y < (int32_t)maxTexel.y; y++)
+        {
+            for(int32_t x = (int32_t)minTexel.x; x < (int32_t)maxTexel.x; x++)
+            {
+                glm::vec2 p(x + 0.5f, y + 0.5f);
+                float     w0 = sign * ((t2.x - t1.x) * (p.y - t1.y) - (t2.y - t1.y) * (p.x - t1.x));
+                float     w1 = sign * ((t0.x - t2.x) * (p.y - t2.y) - (t0.y - t2.y) * (p.x - t2.x));
+                float     w2 = sign * ((t1.x - t0.x) * (p.y - t0.y) - (t1.y - t0.y) * (p.x - t0.x));
+                if(w0 >= 0.f && w1 >= 0.f && w2 >= 0.f)
+                {
+                    sum += texture.Fetch(x, y);
+                    count++;
+                }
+            }
+        }
+    }
+    if(count >= 4)
+    {
+        return sum / (float)count;
+    }
+
+    // sub texel footprint: centroid and three interior points
+    const glm::vec3 barycentrics[4] = {glm::vec3(1.f / 3.f), glm::vec3(4.f / 6.f, 1.f / 6.f, 1.f / 6.f), glm::vec3(1.f / 6.f, 4.f / 6.f, 1.f / 6.f),
+                                       glm::vec3(1.f / 6.f, 1.f / 6.f, 4.f / 6.f)};
+    sum = glm::vec3(0.f);
+    for(const glm::vec3& b : barycentrics)
+    {
+        sum += texture.SampleBilinear(triangle.Uv[0] * b.x + triangle.Uv[1] * b.y + triangle.Uv[2] * b.z);
+    }
+    return sum / 4.f;
+}
+
+void EmissiveTextureIntegrator::Integrate(const std::vector<Triangle>& triangles, std::vector<glm::vec3>& averages, uint32_t threadCount) const
+{
+    averages.assign(triangles.size(), glm::vec3(1.f));
+    ParallelRange((uint32_t)triangles.size(), threadCount, [&](uint32_t begin, uint32_t end) {
+        TraceScope trace("Emissive texture worker");
+        for(uint32_t i = begin; i < end; i++)
+        {
+            auto texture = mTextures.find(triangles[i].TextureIndex);
+            if(texture != mTextures.end())
+            {
+                averages[i] = IntegrateTriangle(texture->second, triangles[i]);
+            }
+        }
+    });
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <foray_api.hpp>
+#include <foray_glm.hpp>
+#include <scene/foray_scene.hpp>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+/// @brief Averages emissive textures over the UV footprint of light triangles on the CPU.
+/// Each texture is read back once at the finest mip level no larger than MAX_EXTENT, the average of a triangle is the box
+/// filtered mean of the texel centers inside its UV triangle (wrapped like the repeat sampler), or bilinear samples at
+/// fixed barycentric points for footprints smaller than a few texels.
+class EmissiveTextureIntegrator
+{
+  public:
+    struct Triangle
+    {
+        glm::vec2 Uv[3];
+        /// @brief Scene texture index, negative for untextured triangles (average 1)
+        int32_t TextureIndex = -1;
+    };
+
+    static constexpr uint32_t MAX_EXTENT = 512;
+
+    /// @brief Reads back the listed textures of the scene texture manager. Unsupported formats are skipped with a warning.
+    void LoadTextures(foray::core::Context* context, foray::scene::Scene* scene, const std::set<int32_t>& textureIndices);
+    /// @brief Releases the CPU copies
+    void Clear();
+
+    /// @brief Linear average color of the texture over each triangle, 1 for untextured triangles or textures that failed to load
+    void Integrate(const std::vector<Triangle>& triangles, std::vector<glm::vec3>& averages, uint32_t threadCount = 0) const;
+
+  protected:
+    struct Texture
+    {
+        uint32_t               Width  = 0;
+        uint32_t               Height = 0;
+        std::vector<glm::vec3> Texels;
+
+        glm::vec3 Fetch(int32_t x, int32_t y) const;
+        glm::vec3 SampleBilinear(glm::vec2 uv) const;
+    };
+
+    bool      ReadbackTexture(foray::core::Context* context, foray::core::ManagedImage& image, Texture& texture);
+    glm::vec3 IntegrateTriangle(const Texture& texture, const Triangle& triangle) const;
+
+    std::unordered_map<int32_t, Texture> mTextures;
+};
@@ -0,0 +1,65 @@
+#include "emissive_triangle_lookup.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+
+uint32_t EmissiveTriangleLookup::HashCell(const glm::ivec3& cell)
+{
+    return ((uint32_t)cell.x * 73856093u) ^ ((uint32_t)cell.y * 19349663u) ^ ((uint32_t)cell.z * 83492791u);
+}
+
+void EmissiveTriangleLookup::Build(const std::vector<glm::vec3>& centroids, const std::vector<uint32_t>& lights)
+{
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+    mEntryCount = 0;
+    for(size_t i = 0; i < centroids.size(); i++)
+    {
+        if(lights[i] != EMPTY)
+        {
+            boundsMin = glm::min(boundsMin, centroids[i]);
+            boundsMax = glm::max(boundsMax, centroids[i]);
+            mEntryCount++;
+        }
+    }
+
+    // cells far above the float error of the centroids computed on the GPU, far below the spacing of distinct triangles
+    mCellSize = mEntryCount > 0 ? std::max(glm::length(boundsMax - boundsMin) * (1.f / 16384.f), 1e-6f) : 1.f;
+
+    // load factor <= 0.5 keeps the probe sequences short
+    size_t capacity = std::bit_ceil(std::max<size_t>(mEntryCount * 2, 16));
+    mTable.assign(capacity, Entry{glm::vec3(0.f), EMPTY});
+    uint32_t mask = (uint32_t)(capacity - 1);
+    for(size_t i = 0; i < centroids.size(); i++)
+    {
+        if(lights[i] == EMPTY)
+        {
+            continue;
+        }
+        uint32_t slot = HashCell(glm::ivec3(glm::floor(centroids[i] / mCellSize))) & mask;
+        while(mTable[slot].Light != EMPTY)
+        {
+            slot = (slot + 1) & mask;
+        }
+        mTable[slot] = Entry{centroids[i], lights[i]};
+    }
+}
+
+void EmissiveTriangleLookup::Upload(foray::core::Context* context)
+{
+    Header header{.CellSize = mCellSize, .Mask = (uint32_t)(mTable.size() - 1)};
+
+    std::vector<uint8_t> data(sizeof(Header) + mTable.size() * sizeof(Entry));
+    std::memcpy(data.data(), &header, sizeof(Header));
+    std::memcpy(data.data() + sizeof(Header), mTable.data(), mTable.size() * sizeof(Entry));
+
+    mBuffer.Create(context, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, data.size(), VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0,
+                   "EmissiveTriangleLookup");
+    mBuffer.WriteDataDeviceLocal(data.data(), data.size());
+}
+
+void EmissiveTriangleLookup::Destroy()
+{
+    mBuffer.Destroy();
+}
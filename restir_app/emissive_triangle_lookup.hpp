@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <foray_api.hpp>
+#include <foray_glm.hpp>
+#include <vector>
+
+/// @brief Maps scene triangles hit by a ray to their TriLight (shaders/restir/emissiveLookup.glsl). Open addressing hash table
+/// over the quantized world space centroids of the emissive source triangles, a hit shader recomputes the centroid of the hit
+/// triangle from the geometry buffers and searches the cells around it. Independent of TLAS instance order and of the light LOD,
+/// which only changes the light index a source triangle maps to.
+class EmissiveTriangleLookup
+{
+  public:
+    /// @brief std430, mirrors EmissiveLookupEntry in emissiveLookup.glsl
+    struct Entry
+    {
+        glm::vec3 Centroid;
+        /// @brief TriLight index, EMPTY for unused slots
+        uint32_t Light;
+    };
+    static_assert(sizeof(Entry) == 16, "Entry must match the std430 layout in emissiveLookup.glsl");
+
+    static constexpr uint32_t EMPTY = ~0u;
+
+    /// @brief centroids[i] is the world space centroid of a source triangle and lights[i] its TriLight, EMPTY entries are skipped
+    void Build(const std::vector<glm::vec3>& centroids, const std::vector<uint32_t>& lights);
+    /// @brief Creates the device buffer (header + table), call after Build
+    void Upload(foray::core::Context* context);
+    void Destroy();
+
+    /// @brief Bound at set 0 binding 27
+    inline foray::core::ManagedBuffer& GetBuffer() { return mBuffer; }
+    inline size_t                      GetEntryCount() const { return mEntryCount; }
+
+    /// @brief Cell of a position, same arithmetic as emissiveLookupSlot in the shader
+    static uint32_t HashCell(const glm::ivec3& cell);
+
+  protected:
+    /// @brief std430 header of the buffer, followed by the table
+    struct Header
+    {
+        float    CellSize;
+        uint32_t Mask;
+        uint32_t Padding[2];
+    };
+
+    float              mCellSize   = 1.f;
+    size_t             mEntryCount = 0;
+    std::vector<Entry> mTable;
+
+    foray::core::ManagedBuffer mBuffer;
+};
@@ -7,35 +7,10 @@
 
 using namespace foray;
 
-struct Vertex
-{
-    glm::vec3 pos;
-
-    static VkVertexInputBindingDescription getBindingDescription()
-    {
-        VkVertexInputBindingDescription bindingDescription{};
-        bindingDescription.binding   = 0;
-        bindingDescription.stride    = sizeof(Vertex);
-        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-        return bindingDescription;
-    }
-
-    static std::array<VkVertexInputAttributeDescription, 1> getAttributeDescriptions()
-    {
-        std::array<VkVertexInputAttributeDescription, 1> attributeDescriptions{};
-
-        attributeDescriptions[0].binding  = 0;
-        attributeDescriptions[0].location = 0;
-        attributeDescriptions[0].format   = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[0].offset   = offsetof(Vertex, pos);
-
-        return attributeDescriptions;
-    }
-};
-
 void EmissiveTriangleMeshStage::RecordFrame(VkCommandBuffer cmdBuffer, foray::base::FrameRenderInfo& renderInfo)
 {
+    CmdCull(cmdBuffer);
+
     {
         std::vector<VkImageMemoryBarrier2> barriers;
         VkImageMemoryBarrier2              barrier = VkImageMemoryBarrier2{
@@ -116,11 +91,10 @@ void EmissiveTriangleMeshStage::RecordFrame(VkCommandBuffer cmdBuffer, foray::ba
 
     VkDescriptorSet descriptorSet = mDescriptorSet.GetDescriptorSet();
     vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+    vkCmdPushConstants(cmdBuffer, mPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &mPushConstants);
 
-    VkBuffer     buffer = mVertexBuffer.GetBuffer();
-    VkDeviceSize offset = 0;
-    vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &buffer, &offset);
-    vkCmdDraw(cmdBuffer, mTriangleVertices.size(), 1, 0, 0);
+    // vertices are pulled from the TriLights buffer, the vertex count was written by the culling pass
+    vkCmdDrawIndirect(cmdBuffer, mDrawArguments.GetBuffer(), 0, 1, sizeof(VkDrawIndirectCommand));
 
     vkCmdEndRenderPass(cmdBuffer);
 
@@ -155,42 +129,100 @@ void EmissiveTriangleMeshStage::RecordFrame(VkCommandBuffer cmdBuffer, foray::ba
     }
 }
 
+void EmissiveTriangleMeshStage::CmdCull(VkCommandBuffer cmdBuffer)
+{
+    // last frames draw may still read the arguments and the visible list
+    VkMemoryBarrier readBarrier{.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                .srcAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+                                .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT};
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &readBarrier, 0,
+                         nullptr, 0, nullptr);
+
+    VkDrawIndirectCommand reset{.vertexCount = 0, .instanceCount = 1, .firstVertex = 0, .firstInstance = 0};
+    vkCmdUpdateBuffer(cmdBuffer, mDrawArguments.GetBuffer(), 0, sizeof(reset), &reset);
+
+    VkMemoryBarrier resetBarrier{.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                 .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                                 .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &resetBarrier, 0, nullptr, 0, nullptr);
+
+    mCullPass.CmdBind(cmdBuffer, {mDescriptorSet.GetDescriptorSet()});
+    mCullPass.CmdPushConstants(cmdBuffer, &mPushConstants, sizeof(PushConstants));
+    mCullPass.CmdDispatch(cmdBuffer, glm::uvec3((mPushConstants.LightCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1));
+
+    VkMemoryBarrier writeBarrier{.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                 .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+                                 .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT};
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 1, &writeBarrier, 0,
+                         nullptr, 0, nullptr);
+}
+
+void EmissiveTriangleMeshStage::SetLightScalars(foray::core::ManagedBuffer* scalars, float maxValue)
+{
+    mScalars                  = scalars;
+    mPushConstants.UseScalars = scalars != nullptr ? VK_TRUE : VK_FALSE;
+    mPushConstants.ScalarMax  = maxValue;
+    SetupDescriptors();
+    mDescriptorSet.Update();
+}
+
+void EmissiveTriangleMeshStage::SetOutput(foray::core::ManagedImage* output)
+{
+    mOutput = output;
+    DestroyRenderpass();
+    PrepareRenderpass();
+    // the render pass is baked into the pipeline, the output format may differ
+    CreatePipeline();
+}
+
 void EmissiveTriangleMeshStage::Destroy()
 {
-	RasterizedRenderStage::Destroy();
+    RasterizedRenderStage::Destroy();
+
+    DestroyRenderpass();
+
+    mCullPass.Destroy();
 
-	if(mRenderpass != nullptr)
+    if(mVisibleLights.Exists())
     {
-		vkDestroyRenderPass(mContext->Device(), mRenderpass, nullptr);
-		mRenderpass = nullptr;
-	}
+        mVisibleLights.Destroy();
+    }
 
-	if(mFrameBuffer != nullptr)
+    if(mDrawArguments.Exists())
     {
-        vkDestroyFramebuffer(mContext->Device(), mFrameBuffer, nullptr);
-        mFrameBuffer = nullptr;
+        mDrawArguments.Destroy();
     }
 
-    if(mVertexBuffer.Exists())
-        mVertexBuffer.Destroy();
+    if(mDefaultScalars.Exists())
+    {
+        mDefaultScalars.Destroy();
+    }
 
     if(mShaderModuleFrag.Exists())
+    {
         mShaderModuleFrag.Destroy();
+    }
 
     if(mShaderModuleVert.Exists())
+    {
         mShaderModuleVert.Destroy();
+    }
 
     if(mPipeline != nullptr)
     {
         vkDestroyPipeline(mContext->Device(), mPipeline, nullptr);
-		mPipeline = nullptr;
-	}
+        mPipeline = nullptr;
+    }
 
     if(mPipelineLayout)
+    {
         mPipelineLayout.Destroy();
+    }
 
-	if(mDescriptorSet.Exists())
+    if(mDescriptorSet.Exists())
+    {
         mDescriptorSet.Destroy();
+    }
 }
 
 void EmissiveTriangleMeshStage::CreatePipeline()
@@ -201,9 +233,8 @@ void EmissiveTriangleMeshStage::CreatePipeline()
         mPipeline = nullptr;
     }
 
+    // no vertex attributes, etm.vert pulls the light vertices by gl_VertexIndex
     foray::scene::VertexInputStateBuilder vertexInputStateBuilder;
-    vertexInputStateBuilder.AddVertexComponentBinding(scene::EVertexComponent::Position);
-    vertexInputStateBuilder.SetStride((uint32_t)sizeof(glm::vec3));
     vertexInputStateBuilder.Build();
 
     foray::util::PipelineBuilder builder;
@@ -238,25 +269,18 @@ void EmissiveTriangleMeshStage::CreateShaders()
     mShaderKeys.push_back(mShaderModuleFrag.CompileFromSource(mContext, FRAG_FILE, options));
     mShaderModuleVert.SetName("EmissiveTris_ShaderVert");
     mShaderModuleFrag.SetName("EmissiveTris_ShaderFrag");
+
+    mCullPass.Create(mContext, CULL_FILE, {mDescriptorSet.GetDescriptorSetLayout()}, sizeof(PushConstants), "EmissiveTris_Cull",
+                     {{"ETM_CULL_GROUP_SIZE", std::to_string(CULL_GROUP_SIZE)}});
 };
 
-void EmissiveTriangleMeshStage::CreateTriangleVertexBuffer()
+void EmissiveTriangleMeshStage::CreateCullBuffers()
 {
-    mTriangleVertices.reserve(mTriangles->size() * 3);
-
-    for(size_t i = 0; i < mTriangles->size(); i++)
-    {
-        mTriangleVertices.push_back((*mTriangles)[i].p1);
-        mTriangleVertices.push_back((*mTriangles)[i].p2);
-        mTriangleVertices.push_back((*mTriangles)[i].p3);
-    }
-
-    VkBufferUsageFlags       bufferUsage    = VkBufferUsageFlagBits::VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-    VkDeviceSize             bufferSize     = mTriangleVertices.size() * sizeof(glm::vec3);
-    VmaMemoryUsage           bufferMemUsage = VmaMemoryUsage::VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
-    VmaAllocationCreateFlags allocFlags     = 0;
-    mVertexBuffer.Create(mContext, bufferUsage, bufferSize, bufferMemUsage, allocFlags, "TriangleLightsVertexBuffer");
-    mVertexBuffer.WriteDataDeviceLocal(mTriangleVertices.data(), bufferSize);
+    VkDeviceSize lightCount = std::max<VkDeviceSize>(mPushConstants.LightCount, 1);
+    mVisibleLights.Create(mContext, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, lightCount * sizeof(uint32_t), VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0, "EmissiveTris_VisibleLights");
+    mDrawArguments.Create(mContext, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, sizeof(VkDrawIndirectCommand),
+                          VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0, "EmissiveTris_DrawArguments");
+    mDefaultScalars.Create(mContext, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sizeof(float), VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0, "EmissiveTris_DefaultScalars");
 }
 
 void EmissiveTriangleMeshStage::PrepareRenderpass()
@@ -349,6 +373,21 @@ void EmissiveTriangleMeshStage::PrepareRenderpass()
     AssertVkResult(vkCreateFramebuffer(mContext->Device(), &fbufCreateInfo, nullptr, &mFrameBuffer));
 }
 
+void EmissiveTriangleMeshStage::DestroyRenderpass()
+{
+    if(mRenderpass != nullptr)
+    {
+        vkDestroyRenderPass(mContext->Device(), mRenderpass, nullptr);
+        mRenderpass = nullptr;
+    }
+
+    if(mFrameBuffer != nullptr)
+    {
+        vkDestroyFramebuffer(mContext->Device(), mFrameBuffer, nullptr);
+        mFrameBuffer = nullptr;
+    }
+}
+
 void EmissiveTriangleMeshStage::SetupDescriptors()
 {
     auto materialBuffer = mScene->GetComponent<scene::gcomp::MaterialManager>();
@@ -356,7 +395,11 @@ void EmissiveTriangleMeshStage::SetupDescriptors()
     auto cameraManager  = mScene->GetComponent<scene::gcomp::CameraManager>();
     mDescriptorSet.SetDescriptorAt(0, materialBuffer->GetVkDescriptorInfo(), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT);
     mDescriptorSet.SetDescriptorAt(1, textureStore->GetDescriptorInfos(), VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
-    mDescriptorSet.SetDescriptorAt(2, cameraManager->GetVkDescriptorInfo(), VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT);
+    mDescriptorSet.SetDescriptorAt(2, cameraManager->GetVkDescriptorInfo(), VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+    mDescriptorSet.SetDescriptorAt(3, mVisibleLights, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+    mDescriptorSet.SetDescriptorAt(4, mDrawArguments, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+    mDescriptorSet.SetDescriptorAt(5, mScalars != nullptr ? *mScalars : mDefaultScalars, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT);
+    mDescriptorSet.SetDescriptorAt(16, *mTriLights, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
 }
 
 void EmissiveTriangleMeshStage::CreateDescriptorSets()
@@ -367,7 +410,7 @@ void EmissiveTriangleMeshStage::CreateDescriptorSets()
 void EmissiveTriangleMeshStage::CreatePipelineLayout()
 {
     mPipelineLayout.AddDescriptorSetLayout(mDescriptorSet.GetDescriptorSetLayout());
-    mPipelineLayout.AddPushConstantRange<scene::DrawPushConstant>(VkShaderStageFlagBits::VK_SHADER_STAGE_VERTEX_BIT | VkShaderStageFlagBits::VK_SHADER_STAGE_FRAGMENT_BIT);
+    mPipelineLayout.AddPushConstantRange<PushConstants>(VkShaderStageFlagBits::VK_SHADER_STAGE_VERTEX_BIT);
     mPipelineLayout.Build(mContext);
     mPipelineLayout.SetName("EmissiveTris_PipelineLayout");
 }
\ No newline at end of file
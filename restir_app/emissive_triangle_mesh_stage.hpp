@@ -1,9 +1,12 @@
 #pragma once
+#include "compute_pass.hpp"
 #include "structs.hpp"
 #include <foray_api.hpp>
 #include <foray_vulkan.hpp>
 #include <scene/foray_scene.hpp>
 
+/// @brief Wireframe overlay of the triangle lights. The vertices are pulled from the TriLights buffer of the ReSTIR stage, a compute
+/// pass frustum culls the lights beforehand and writes the visible light list together with the vkCmdDrawIndirect arguments.
 class EmissiveTriangleMeshStage : public foray::stages::RasterizedRenderStage
 {
   public:
@@ -19,15 +22,17 @@ class EmissiveTriangleMeshStage : public foray::stages::RasterizedRenderStage
     virtual void UpdateDescriptors() override{};
     virtual void CreatePipelineLayout() override;
 
-    void Init(foray::core::Context* context, std::vector<shader::TriLight>* triangles, foray::core::ManagedImage* depth, foray::core::ManagedImage* output, foray::scene::Scene* scene)
+    /// @brief triLights holds lightCount shader::TriLight records, it is bound at binding 16 like in the ReSTIR passes
+    void Init(foray::core::Context* context, foray::core::ManagedBuffer* triLights, uint32_t lightCount, foray::core::ManagedImage* depth, foray::core::ManagedImage* output, foray::scene::Scene* scene)
     {
         mContext   = context;
-        mTriangles = triangles;
+        mTriLights = triLights;
+        mPushConstants.LightCount = lightCount;
         mDepthImage = depth;
 		mOutput = output;
         mScene = scene;
 
-		CreateTriangleVertexBuffer();
+		CreateCullBuffers();
         SetupDescriptors();
 		CreateDescriptorSets();
 		CreatePipelineLayout();
@@ -36,26 +41,52 @@ class EmissiveTriangleMeshStage : public foray::stages::RasterizedRenderStage
         CreatePipeline();
     }
 
+    /// @brief Colors every light by one float of scalars, mapped from [0, maxValue] onto a heat ramp. nullptr restores the plain red.
+    /// The buffer has to hold one float per light and outlive its use by the overlay.
+    void SetLightScalars(foray::core::ManagedBuffer* scalars, float maxValue);
+
+    /// @brief Draws onto output from now on, e.g. after the displayed image changed or was resized. Rebuilds the render pass,
+    /// framebuffer and pipeline, call with the device idle.
+    void SetOutput(foray::core::ManagedImage* output);
+
     // individual
     void       CreatePipeline();
     void       CreateShaders();
 
     static inline const std::string VERT_FILE = "shaders/emissive_triangle_mesh/etm.vert";
     static inline const std::string FRAG_FILE = "shaders/emissive_triangle_mesh/etm.frag";
+    static inline const std::string CULL_FILE = "shaders/emissive_triangle_mesh/etmCull.comp";
+    static constexpr uint32_t       CULL_GROUP_SIZE = 64;
 
     foray::core::ShaderModule mShaderModuleVert;
     foray::core::ShaderModule mShaderModuleFrag;
 
-    std::vector<glm::vec3>         mTriangleVertices;
-    std::vector<shader::TriLight>* mTriangles;
-    foray::core::ManagedBuffer     mVertexBuffer;
-    void                           CreateTriangleVertexBuffer();
+    /// @brief Mirrors the push constants of etm.vert and etmCull.comp
+    struct PushConstants
+    {
+        uint32_t LightCount = 0;
+        VkBool32 UseScalars = VK_FALSE;
+        float    ScalarMax  = 1.f;
+    } mPushConstants;
+
+    foray::core::ManagedBuffer* mTriLights = nullptr;
+    /// @brief Indices of the lights that passed the culling, three vertices are drawn per entry
+    foray::core::ManagedBuffer  mVisibleLights;
+    /// @brief VkDrawIndirectCommand, vertexCount is accumulated by the culling pass
+    foray::core::ManagedBuffer  mDrawArguments;
+    /// @brief Bound in place of the scalar buffer while none is set
+    foray::core::ManagedBuffer  mDefaultScalars;
+    foray::core::ManagedBuffer* mScalars = nullptr;
+    ComputePass                 mCullPass;
+    void                        CreateCullBuffers();
+    void                        CmdCull(VkCommandBuffer cmdBuffer);
 
 	foray::core::ManagedImage* mDepthImage;
     foray::core::ManagedImage* mOutput;
     foray::scene::Scene*              mScene;
 
 	void PrepareRenderpass();
+    void DestroyRenderpass();
 
 
   protected:
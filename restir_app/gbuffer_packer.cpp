@@ -0,0 +1,167 @@
+#include "gbuffer_packer.hpp"
+
+void GBufferPacker::Create(foray::core::Context* context, foray::stages::GBufferStage* gbufferStage)
+{
+    mContext      = context;
+    mGBufferStage = gbufferStage;
+
+    CreateImages();
+    CreateOrUpdateDescriptorSet();
+    mPackPass.Create(mContext, PACK_FILE, {mDescriptorSet.GetDescriptorSetLayout()}, 0, "GBufferPack");
+}
+
+void GBufferPacker::Resize()
+{
+    DestroyImages();
+    CreateImages();
+    CreateOrUpdateDescriptorSet();
+}
+
+void GBufferPacker::CreateImages()
+{
+    VkExtent2D        size  = mContext->GetSwapchainSize();
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+    const char* names[] = {"PackedGBuffer_Geometry", "PackedGBuffer_Material"};
+    for(size_t i = 0; i < mPackedImages.size(); i++)
+    {
+        foray::core::ManagedImage::CreateInfo ci(usage, VK_FORMAT_R32G32_UINT, size, names[i]);
+        mPackedImages[i].Create(mContext, ci);
+        mPackedImagesSampled[i].Init(mContext, &mPackedImages[i], mSamplerCi);
+    }
+
+    mGeometryHistory.Create(mContext, &mPackedImages[PACKED_GEOMETRY]);
+    mGeometryHistorySampled.Init(mContext, &mGeometryHistory.GetHistoryImage(), mSamplerCi);
+
+    mInputs = {
+        mGBufferStage->GetImageOutput(foray::stages::GBufferStage::DepthOutputName),
+        mGBufferStage->GetImageEOutput(foray::stages::GBufferStage::EOutput::Normal),
+        mGBufferStage->GetImageEOutput(foray::stages::GBufferStage::EOutput::Albedo),
+        mGBufferStage->GetImageEOutput(foray::stages::GBufferStage::EOutput::MaterialIdx),
+        mGBufferStage->GetImageEOutput(foray::stages::GBufferStage::EOutput::Position),
+    };
+    for(size_t i = 0; i < mInputsSampled.size(); i++)
+    {
+        mInputsSampled[i].Init(mContext, mInputs[i], mSamplerCi);
+    }
+}
+
+void GBufferPacker::DestroyImages()
+{
+    for(foray::core::CombinedImageSampler& sampler : mInputsSampled)
+    {
+        sampler.Destroy();
+    }
+    for(foray::core::CombinedImageSampler& sampler : mPackedImagesSampled)
+    {
+        sampler.Destroy();
+    }
+    mGeometryHistorySampled.Destroy();
+    mGeometryHistory.Destroy();
+    for(foray::core::ManagedImage& image : mPackedImages)
+    {
+        image.Destroy();
+    }
+}
+
+void GBufferPacker::CreateOrUpdateDescriptorSet()
+{
+    // depth is sampled in the read only layout the app transitions it to after the gbuffer stage
+    mDescriptorSet.SetDescriptorAt(0, std::vector<const foray::core::CombinedImageSampler*>{&mInputsSampled[0]}, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL,
+                                   VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT);
+    for(uint32_t i = 1; i < mInputsSampled.size(); i++)
+    {
+        mDescriptorSet.SetDescriptorAt(i, std::vector<const foray::core::CombinedImageSampler*>{&mInputsSampled[i]}, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                       VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT);
+    }
+    for(uint32_t i = 0; i < mPackedImages.size(); i++)
+    {
+        std::vector<VkDescriptorImageInfo> imageInfos{VkDescriptorImageInfo{.imageView = mPackedImages[i].GetImageView(), .imageLayout = VK_IMAGE_LAYOUT_GENERAL}};
+        mDescriptorSet.SetDescriptorAt((uint32_t)mInputsSampled.size() + i, imageInfos, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT);
+    }
+
+    if(mDescriptorSet.Exists())
+    {
+        mDescriptorSet.Update();
+    }
+    else
+    {
+        mDescriptorSet.Create(mContext, "GBufferPack_DescriptorSet");
+    }
+}
+
+std::vector<const foray::core::CombinedImageSampler*> GBufferPacker::GetSampledPackedImages() const
+{
+    return {&mPackedImagesSampled[PACKED_GEOMETRY], &mPackedImagesSampled[PACKED_MATERIAL]};
+}
+
+void GBufferPacker::CmdPack(VkCommandBuffer cmdBuffer, foray::base::FrameRenderInfo& renderInfo)
+{
+    foray::core::ImageLayoutCache& layoutCache = renderInfo.GetImageLayoutCache();
+
+    // the app transitions depth for the raytracing stage only, make it visible to compute as well
+    {
+        foray::core::ImageLayoutCache::Barrier barrier;
+        barrier.SrcAccessMask               = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        barrier.DstAccessMask               = VK_ACCESS_SHADER_READ_BIT;
+        barrier.NewLayout                   = VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL;
+        barrier.SubresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+        layoutCache.CmdBarrier(cmdBuffer, mInputs[0], barrier, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+
+    // gbuffer color outputs are read in the compute stage
+    for(size_t i = 1; i < mInputs.size(); i++)
+    {
+        foray::core::ImageLayoutCache::Barrier barrier;
+        barrier.SrcAccessMask               = VK_ACCESS_MEMORY_WRITE_BIT;
+        barrier.DstAccessMask               = VK_ACCESS_SHADER_READ_BIT;
+        barrier.NewLayout                   = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.SubresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        layoutCache.CmdBarrier(cmdBuffer, mInputs[i], barrier, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+
+    // previous contents are overwritten entirely
+    for(foray::core::ManagedImage& image : mPackedImages)
+    {
+        foray::core::ImageLayoutCache::Barrier barrier;
+        barrier.SrcAccessMask               = VK_ACCESS_MEMORY_READ_BIT;
+        barrier.DstAccessMask               = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.NewLayout                   = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.SubresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        layoutCache.CmdBarrier(cmdBuffer, &image, barrier, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+
+    mPackPass.CmdBind(cmdBuffer, {mDescriptorSet.GetDescriptorSet()});
+    mPackPass.CmdDispatch(cmdBuffer, mContext->GetSwapchainSize());
+
+    for(foray::core::ManagedImage& image : mPackedImages)
+    {
+        foray::core::ImageLayoutCache::Barrier barrier;
+        barrier.SrcAccessMask               = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.DstAccessMask               = VK_ACCESS_SHADER_READ_BIT;
+        barrier.NewLayout                   = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.SubresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        layoutCache.CmdBarrier(cmdBuffer, &image, barrier, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR);
+    }
+
+    mGeometryHistory.ApplyToLayoutCache(layoutCache);
+    foray::core::ImageLayoutCache::Barrier historyBarrier;
+    historyBarrier.SrcAccessMask               = VK_ACCESS_MEMORY_WRITE_BIT;
+    historyBarrier.DstAccessMask               = VK_ACCESS_SHADER_READ_BIT;
+    historyBarrier.NewLayout                   = VK_IMAGE_LAYOUT_GENERAL;
+    historyBarrier.SubresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    layoutCache.CmdBarrier(cmdBuffer, &mGeometryHistory.GetHistoryImage(), historyBarrier, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR);
+}
+
+void GBufferPacker::CmdCopyToHistory(VkCommandBuffer cmdBuffer, foray::base::FrameRenderInfo& renderInfo)
+{
+    std::vector<foray::util::HistoryImage*> historyImages{&mGeometryHistory};
+    foray::util::HistoryImage::sMultiCopySourceToHistory(historyImages, cmdBuffer, renderInfo);
+}
+
+void GBufferPacker::Destroy()
+{
+    mPackPass.Destroy();
+    mDescriptorSet.Destroy();
+    DestroyImages();
+}
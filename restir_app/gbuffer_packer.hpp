@@ -0,0 +1,65 @@
+#pragma once
+#include "compute_pass.hpp"
+#include <array>
+#include <foray_api.hpp>
+#include <util/foray_historyimage.hpp>
+
+/// @brief Packs the GBuffer outputs into two 8 byte per pixel images for the bandwidth reduced ReSTIR mode.
+/// Geometry stores the depth buffer value and an octahedral normal, position is reconstructed from depth and the camera matrices.
+/// Material stores rgba8 albedo and the material index.
+class GBufferPacker
+{
+  public:
+    enum EPackedImage
+    {
+        PACKED_GEOMETRY = 0,
+        PACKED_MATERIAL = 1,
+    };
+
+    void Create(foray::core::Context* context, foray::stages::GBufferStage* gbufferStage);
+    void Resize();
+    void Destroy();
+
+    /// @brief Packs the current GBuffer and makes the packed images readable for the raytracing stage
+    void CmdPack(VkCommandBuffer cmdBuffer, foray::base::FrameRenderInfo& renderInfo);
+    /// @brief Copies the packed geometry into its history image. Record after the raytracing stage consumed the previous history.
+    void CmdCopyToHistory(VkCommandBuffer cmdBuffer, foray::base::FrameRenderInfo& renderInfo);
+
+    std::vector<const foray::core::CombinedImageSampler*> GetSampledPackedImages() const;
+    inline const foray::core::CombinedImageSampler*       GetSampledGeometryHistory() const { return &mGeometryHistorySampled; }
+    inline foray::util::HistoryImage&                     GetGeometryHistory() { return mGeometryHistory; }
+
+  protected:
+    void CreateImages();
+    void DestroyImages();
+    void CreateOrUpdateDescriptorSet();
+
+    static inline const std::string PACK_FILE = "shaders/restir/gbufferPack.comp";
+
+    foray::core::Context*        mContext{};
+    foray::stages::GBufferStage* mGBufferStage{};
+
+    std::array<foray::core::ManagedImage, 2>         mPackedImages;
+    std::array<foray::core::CombinedImageSampler, 2> mPackedImagesSampled;
+    foray::util::HistoryImage                        mGeometryHistory;
+    foray::core::CombinedImageSampler                mGeometryHistorySampled;
+
+    /// @brief GBuffer inputs: depth, normal, albedo, material index, position (only tested for geometry)
+    std::array<foray::core::ManagedImage*, 5>        mInputs{};
+    std::array<foray::core::CombinedImageSampler, 5> mInputsSampled;
+
+    foray::core::DescriptorSet mDescriptorSet;
+    ComputePass                mPackPass;
+
+    static constexpr VkSamplerCreateInfo mSamplerCi = VkSamplerCreateInfo{.sType                   = VkStructureType::VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+                                                                          .magFilter               = VkFilter::VK_FILTER_NEAREST,
+                                                                          .minFilter               = VkFilter::VK_FILTER_NEAREST,
+                                                                          .addressModeU            = VkSamplerAddressMode::VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                                          .addressModeV            = VkSamplerAddressMode::VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                                          .addressModeW            = VkSamplerAddressMode::VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                                          .anisotropyEnable        = VK_FALSE,
+                                                                          .compareEnable           = VK_FALSE,
+                                                                          .minLod                  = 0,
+                                                                          .maxLod                  = 0,
+                                                                          .unnormalizedCoordinates = VK_FALSE};
+};
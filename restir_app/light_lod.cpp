@@ -0,0 +1,393 @@
+#include "light_lod.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <queue>
+#include <tuple>
+#include <unordered_map>
+
+namespace light_lod {
+    double Area(const Triangle& triangle)
+    {
+        return 0.5 * glm::length(glm::cross(triangle.P[1] - triangle.P[0], triangle.P[2] - triangle.P[0]));
+    }
+
+    double Luminance(const glm::vec3& radiance)
+    {
+        return 0.2126 * radiance.r + 0.7152 * radiance.g + 0.0722 * radiance.b;
+    }
+
+    namespace {
+        /// @brief Welded triangle mesh of one material with the input triangles each current triangle represents
+        struct Mesh
+        {
+            std::vector<glm::vec3>             Positions;
+            std::vector<bool>                  Fixed;
+            std::vector<std::vector<uint32_t>> VertexTriangles;
+            std::vector<glm::uvec3>            Triangles;
+            std::vector<bool>                  Alive;
+            std::vector<std::vector<uint32_t>> Sources;
+
+            std::vector<uint32_t> AliveTriangles(uint32_t vertex) const
+            {
+                std::vector<uint32_t> result;
+                for(uint32_t triangle : VertexTriangles[vertex])
+                {
+                    if(Alive[triangle] && std::find(result.begin(), result.end(), triangle) == result.end())
+                    {
+                        result.push_back(triangle);
+                    }
+                }
+                return result;
+            }
+
+            std::vector<uint32_t> Neighbours(uint32_t vertex) const
+            {
+                std::vector<uint32_t> result;
+                for(uint32_t triangle : AliveTriangles(vertex))
+                {
+                    for(int i = 0; i < 3; i++)
+                    {
+                        uint32_t other = Triangles[triangle][i];
+                        if(other != vertex && std::find(result.begin(), result.end(), other) == result.end())
+                        {
+                            result.push_back(other);
+                        }
+                    }
+                }
+                return result;
+            }
+
+            glm::vec3 FaceNormal(const glm::uvec3& triangle) const
+            {
+                return glm::cross(Positions[triangle.y] - Positions[triangle.x], Positions[triangle.z] - Positions[triangle.x]);
+            }
+        };
+
+        bool Contains(const glm::uvec3& triangle, uint32_t vertex)
+        {
+            return triangle.x == vertex || triangle.y == vertex || triangle.z == vertex;
+        }
+
+        bool SimilarRadiance(const glm::vec3& a, const glm::vec3& b, float maxDifference)
+        {
+            double la = Luminance(a);
+            double lb = Luminance(b);
+            return std::abs(la - lb) <= maxDifference * std::max(std::max(la, lb), 1e-6);
+        }
+
+        void BuildMesh(const std::vector<Triangle>& input, const std::vector<uint32_t>& group, float weldDistance, const Settings& settings, Mesh& mesh)
+        {
+            // weld by quantized position
+            std::map<std::tuple<int64_t, int64_t, int64_t>, uint32_t> vertexMap;
+            for(uint32_t index : group)
+            {
+                glm::uvec3 triangle;
+                for(int i = 0; i < 3; i++)
+                {
+                    glm::vec3 p   = input[index].P[i];
+                    auto      key = std::make_tuple((int64_t)std::llround(p.x / weldDistance), (int64_t)std::llround(p.y / weldDistance),
+                                                    (int64_t)std::llround(p.z / weldDistance));
+                    auto [it, inserted] = vertexMap.emplace(key, (uint32_t)mesh.Positions.size());
+                    if(inserted)
+                    {
+                        mesh.Positions.push_back(p);
+                        mesh.VertexTriangles.emplace_back();
+                    }
+                    triangle[i] = it->second;
+                }
+                if(triangle.x == triangle.y || triangle.y == triangle.z || triangle.x == triangle.z)
+                {
+                    // degenerate after welding, its flux goes to the output through Simplify's flux correction
+                    continue;
+                }
+                uint32_t triangleIndex = (uint32_t)mesh.Triangles.size();
+                mesh.Triangles.push_back(triangle);
+                mesh.Alive.push_back(true);
+                mesh.Sources.push_back({index});
+                for(int i = 0; i < 3; i++)
+                {
+                    mesh.VertexTriangles[triangle[i]].push_back(triangleIndex);
+                }
+            }
+
+            // boundary vertices (edges with a single triangle) and radiance discontinuities stay
+            mesh.Fixed.assign(mesh.Positions.size(), false);
+            std::map<std::pair<uint32_t, uint32_t>, uint32_t> edgeCount;
+            for(const glm::uvec3& triangle : mesh.Triangles)
+            {
+                for(int i = 0; i < 3; i++)
+                {
+                    uint32_t a = triangle[i];
+                    uint32_t b = triangle[(i + 1) % 3];
+                    edgeCount[{std::min(a, b), std::max(a, b)}]++;
+                }
+            }
+            for(const auto& [edge, count] : edgeCount)
+            {
+                if(count != 2)
+                {
+                    mesh.Fixed[edge.first]  = true;
+                    mesh.Fixed[edge.second] = true;
+                }
+            }
+            for(uint32_t vertex = 0; vertex < mesh.Positions.size(); vertex++)
+            {
+                const std::vector<uint32_t>& triangles = mesh.VertexTriangles[vertex];
+                for(uint32_t triangle : triangles)
+                {
+                    if(!SimilarRadiance(input[mesh.Sources[triangle][0]].Radiance, input[mesh.Sources[triangles[0]][0]].Radiance, settings.MaxRadianceDifference))
+                    {
+                        mesh.Fixed[vertex] = true;
+                    }
+                }
+            }
+        }
+
+        /// @brief Moves vertex u onto v if all constraints hold
+        bool TryCollapse(Mesh& mesh, const std::vector<Triangle>& input, uint32_t u, uint32_t v, float cosMaxAngle)
+        {
+            if(mesh.Fixed[u])
+            {
+                return false;
+            }
+            std::vector<uint32_t> uTriangles = mesh.AliveTriangles(u);
+            std::vector<uint32_t> removed;
+            std::vector<uint32_t> moved;
+            for(uint32_t triangle : uTriangles)
+            {
+                (Contains(mesh.Triangles[triangle], v) ? removed : moved).push_back(triangle);
+            }
+            if(removed.empty() || moved.empty())
+            {
+                return false;
+            }
+
+            // link condition: the only shared neighbours are the opposite vertices of the removed triangles, otherwise the mesh folds
+            std::vector<uint32_t> uNeighbours = mesh.Neighbours(u);
+            std::vector<uint32_t> vNeighbours = mesh.Neighbours(v);
+            size_t                shared      = std::count_if(uNeighbours.begin(), uNeighbours.end(),
+                                                              [&vNeighbours](uint32_t n) { return std::find(vNeighbours.begin(), vNeighbours.end(), n) != vNeighbours.end(); });
+            if(shared != removed.size())
+            {
+                return false;
+            }
+
+            for(uint32_t triangle : moved)
+            {
+                glm::uvec3 after = mesh.Triangles[triangle];
+                for(int i = 0; i < 3; i++)
+                {
+                    after[i] = after[i] == u ? v : after[i];
+                }
+                glm::vec3 before = mesh.FaceNormal(mesh.Triangles[triangle]);
+                glm::vec3 normal = mesh.FaceNormal(after);
+                float     length = glm::length(normal);
+                if(length <= 1e-12f || glm::dot(normal, before) <= 0.f)
+                {
+                    return false;
+                }
+                normal /= length;
+
+                // every input triangle around u ends up in one of the moved triangles
+                for(uint32_t other : uTriangles)
+                {
+                    for(uint32_t source : mesh.Sources[other])
+                    {
+                        if(std::abs(glm::dot(normal, glm::normalize(input[source].Normal))) < cosMaxAngle)
+                        {
+                            return false;
+                        }
+                    }
+                }
+            }
+
+            for(uint32_t triangle : removed)
+            {
+                // hand the sources to the moved triangle that becomes adjacent across the collapsed edge
+                const glm::uvec3& corners   = mesh.Triangles[triangle];
+                uint32_t          opposite  = corners.x != u && corners.x != v ? corners.x : (corners.y != u && corners.y != v ? corners.y : corners.z);
+                uint32_t          recipient = moved[0];
+                for(uint32_t candidate : moved)
+                {
+                    if(Contains(mesh.Triangles[candidate], opposite))
+                    {
+                        recipient = candidate;
+                    }
+                }
+                mesh.Sources[recipient].insert(mesh.Sources[recipient].end(), mesh.Sources[triangle].begin(), mesh.Sources[triangle].end());
+                mesh.Alive[triangle] = false;
+            }
+            for(uint32_t triangle : moved)
+            {
+                for(int i = 0; i < 3; i++)
+                {
+                    mesh.Triangles[triangle][i] = mesh.Triangles[triangle][i] == u ? v : mesh.Triangles[triangle][i];
+                }
+                mesh.VertexTriangles[v].push_back(triangle);
+            }
+            mesh.VertexTriangles[u].clear();
+            mesh.Fixed[u] = true;
+            return true;
+        }
+
+        void SimplifyMesh(Mesh& mesh, const std::vector<Triangle>& input, float cosMaxAngle)
+        {
+            using Candidate = std::tuple<float, uint32_t, uint32_t>;
+            std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> queue;
+            auto                                                                           push = [&](uint32_t vertex) {
+                for(uint32_t neighbour : mesh.Neighbours(vertex))
+                {
+                    float length = glm::distance(mesh.Positions[vertex], mesh.Positions[neighbour]);
+                    queue.emplace(length, vertex, neighbour);
+                    queue.emplace(length, neighbour, vertex);
+                }
+            };
+            for(uint32_t vertex = 0; vertex < mesh.Positions.size(); vertex++)
+            {
+                push(vertex);
+            }
+
+            while(!queue.empty())
+            {
+                auto [length, u, v] = queue.top();
+                queue.pop();
+                // stale entries: u was removed or the edge changed length
+                if(mesh.VertexTriangles[u].empty() || mesh.VertexTriangles[v].empty() || glm::distance(mesh.Positions[u], mesh.Positions[v]) != length)
+                {
+                    continue;
+                }
+                if(TryCollapse(mesh, input, u, v, cosMaxAngle))
+                {
+                    push(v);
+                }
+            }
+        }
+
+        double RelativeVariance(const std::vector<double>& flux)
+        {
+            double sum        = 0.0;
+            double sumSquared = 0.0;
+            for(double f : flux)
+            {
+                sum += f;
+                sumSquared += f * f;
+            }
+            return sum > 0.0 ? flux.size() * sumSquared / (sum * sum) - 1.0 : 0.0;
+        }
+    }  // namespace
+
+    std::vector<Triangle> Simplify(const std::vector<Triangle>& input, const Settings& settings, Report& report)
+    {
+        std::vector<double> inputFlux;
+        inputFlux.reserve(input.size());
+        glm::vec3 boundsMin(std::numeric_limits<float>::max());
+        glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+        for(const Triangle& triangle : input)
+        {
+            inputFlux.push_back(Luminance(triangle.Radiance) * Area(triangle));
+            for(const glm::vec3& p : triangle.P)
+            {
+                boundsMin = glm::min(boundsMin, p);
+                boundsMax = glm::max(boundsMax, p);
+            }
+        }
+
+        std::vector<Triangle> output;
+        report.OutputOfInput.assign(input.size(), ~0u);
+        if(!settings.Enabled || input.empty())
+        {
+            output = input;
+            for(uint32_t index = 0; index < input.size(); index++)
+            {
+                report.OutputOfInput[index] = index;
+            }
+        }
+        else
+        {
+            float weldDistance = std::max(glm::length(boundsMax - boundsMin) * 1e-6f, 1e-7f);
+            float cosMaxAngle  = std::cos(glm::radians(settings.MaxNormalAngleDeg));
+
+            std::unordered_map<int32_t, std::vector<uint32_t>> groups;
+            for(uint32_t index = 0; index < input.size(); index++)
+            {
+                groups[input[index].MaterialIndex].push_back(index);
+            }
+
+            for(const auto& [material, group] : groups)
+            {
+                Mesh mesh;
+                BuildMesh(input, group, weldDistance, settings, mesh);
+                SimplifyMesh(mesh, input, cosMaxAngle);
+
+                for(uint32_t index = 0; index < mesh.Triangles.size(); index++)
+                {
+                    if(!mesh.Alive[index])
+                    {
+                        continue;
+                    }
+                    Triangle& triangle = output.emplace_back();
+                    glm::vec3 sourceNormal(0.f);
+                    glm::vec3 sourceFlux(0.f);
+                    for(uint32_t source : mesh.Sources[index])
+                    {
+                        sourceNormal += glm::normalize(input[source].Normal);
+                        sourceFlux += input[source].Radiance * (float)Area(input[source]);
+                        report.OutputOfInput[source] = (uint32_t)(output.size() - 1);
+                    }
+                    for(int i = 0; i < 3; i++)
+                    {
+                        triangle.P[i] = mesh.Positions[mesh.Triangles[index][i]];
+                    }
+                    glm::vec3 normal       = glm::normalize(mesh.FaceNormal(mesh.Triangles[index]));
+                    triangle.Normal        = glm::dot(normal, sourceNormal) < 0.f ? -normal : normal;
+                    triangle.Radiance      = sourceFlux / (float)Area(triangle);
+                    triangle.MaterialIndex = material;
+                }
+            }
+
+            // triangles degenerate after welding lose their flux, scale the rest uniformly to compensate
+            double outputFlux = 0.0;
+            for(const Triangle& triangle : output)
+            {
+                outputFlux += Luminance(triangle.Radiance) * Area(triangle);
+            }
+            double totalInputFlux = 0.0;
+            for(double f : inputFlux)
+            {
+                totalInputFlux += f;
+            }
+            if(outputFlux > 0.0 && std::abs(outputFlux - totalInputFlux) > 1e-6 * totalInputFlux)
+            {
+                for(Triangle& triangle : output)
+                {
+                    triangle.Radiance *= (float)(totalInputFlux / outputFlux);
+                }
+            }
+        }
+
+        std::vector<double> outputFlux;
+        outputFlux.reserve(output.size());
+        for(const Triangle& triangle : output)
+        {
+            outputFlux.push_back(Luminance(triangle.Radiance) * Area(triangle));
+        }
+
+        report.InputCount             = input.size();
+        report.OutputCount            = output.size();
+        report.InputFlux              = 0.0;
+        report.OutputFlux             = 0.0;
+        for(double f : inputFlux)
+        {
+            report.InputFlux += f;
+        }
+        for(double f : outputFlux)
+        {
+            report.OutputFlux += f;
+        }
+        report.InputRelativeVariance  = RelativeVariance(inputFlux);
+        report.OutputRelativeVariance = RelativeVariance(outputFlux);
+        return output;
+    }
+}  // namespace light_lod
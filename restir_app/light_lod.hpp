@@ -0,0 +1,54 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <foray_glm.hpp>
+#include <vector>
+
+/// @brief Offline simplification of the emissive triangle set. Vertices of the same material are welded, then interior
+/// vertices are removed by shortest-edge collapses while every resulting triangle stays within MaxNormalAngleDeg of all
+/// source triangles it represents and only similar radiance is merged. The radiance of each output triangle is the flux
+/// of its sources divided by its own area, so the total emitted flux is preserved exactly.
+/// Off by default: on curved emitters the merged triangles cut below the mesh surface, so shadow rays towards them hit the
+/// emitter itself and BRDF hits of the scene triangles no longer match the merged light they map to. Keep the angle small.
+namespace light_lod {
+    struct Settings
+    {
+        bool  Enabled           = false;
+        float MaxNormalAngleDeg = 1.f;
+        /// @brief Max relative luminance difference between merged triangles
+        float MaxRadianceDifference = 0.05f;
+    };
+
+    struct Triangle
+    {
+        glm::vec3 P[3];
+        glm::vec3 Normal;
+        glm::vec3 Radiance;
+        int32_t   MaterialIndex = -1;
+    };
+
+    struct Report
+    {
+        size_t InputCount  = 0;
+        size_t OutputCount = 0;
+        /// @brief Sum of luminance * area
+        double InputFlux  = 0.0;
+        double OutputFlux = 0.0;
+        /// @brief Relative difference between OutputFlux and InputFlux, see FLUX_TOLERANCE
+        inline double FluxError() const { return InputFlux > 0.0 ? std::abs(OutputFlux - InputFlux) / InputFlux : 0.0; }
+        /// @brief Relative variance of a one sample flux estimate with uniform triangle selection, N * sum(flux_i^2) / flux^2 - 1.
+        /// ReSTIR candidates are drawn uniformly, so this is the variance the candidate generation starts from.
+        double InputRelativeVariance  = 0.0;
+        double OutputRelativeVariance = 0.0;
+        /// @brief Index of the output triangle covering each input triangle, ~0u for inputs lost to degenerate triangles
+        std::vector<uint32_t> OutputOfInput;
+    };
+
+    /// @brief Max FluxError of a simplification, above it the merged lights change the image brightness
+    constexpr double FLUX_TOLERANCE = 1e-4;
+
+    std::vector<Triangle> Simplify(const std::vector<Triangle>& input, const Settings& settings, Report& report);
+
+    double Area(const Triangle& triangle);
+    double Luminance(const glm::vec3& radiance);
+}  // namespace light_lod
@@ -1,8 +1,85 @@
 #include "restir_app.hpp"
+#include "image_metrics.hpp"
+
+/// @brief Offline comparison: restir_app --metrics reference.pfm test.pfm [test.pfm ...], prints one csv line per test image
+int CompareImages(int argc, char** argv)
+{
+    FloatImage reference;
+    if(!ReadPfm(argv[2], reference))
+    {
+        std::cerr << "Unable to read reference \"" << argv[2] << "\"\n";
+        return 1;
+    }
+
+    int result = 0;
+    std::cout << "file,rmse,relmse,flip\n";
+    for(int i = 3; i < argc; i++)
+    {
+        FloatImage        test;
+        ImageErrorMetrics metrics;
+        if(!ReadPfm(argv[i], test) || !image_metrics::Compute(test, reference, metrics))
+        {
+            std::cerr << "Unable to compare \"" << argv[i] << "\"\n";
+            result = 1;
+            continue;
+        }
+        std::cout << argv[i] << "," << metrics.Rmse << "," << metrics.RelMse << "," << metrics.Flip << "\n";
+    }
+    return result;
+}
 
 int main(int argv, char** args)
 {
+    if(argv >= 4 && std::strcmp(args[1], "--metrics") == 0)
+    {
+        return CompareImages(argv, args);
+    }
+
     foray::osi::OverrideCurrentWorkingDirectory(CWD_OVERRIDE_PATH);
     RestirProject project;
+    // --sweep sweep.txt runs a parameter sweep and quits, --preset preset.txt overrides the startup preset,
+    // --set name=value overrides a preset parameter, --reference-mode 1 starts accumulating the reference,
+    // --light-lod-angle <degrees> enables the light simplification with this tolerance (off by default, keep it around 1),
+    // --benchmark <prefix> [--benchmark-warmup N --benchmark-frames N --benchmark-accumulate 0|1] measures and quits
+    BenchmarkRun::Settings benchmark;
+    for(int i = 1; i + 1 < argv; i += 2)
+    {
+        if(std::strcmp(args[i], "--sweep") == 0)
+        {
+            project.SetStartupSweep(args[i + 1]);
+        }
+        else if(std::strcmp(args[i], "--preset") == 0)
+        {
+            project.SetStartupPreset(args[i + 1]);
+        }
+        else if(std::strcmp(args[i], "--light-lod-angle") == 0)
+        {
+            // max normal deviation in degrees, 0 disables the light LOD
+            light_lod::Settings& settings = project.GetLightLodSettings();
+            float                angle    = (float)std::atof(args[i + 1]);
+            settings.Enabled              = angle > 0.f;
+            settings.MaxNormalAngleDeg    = angle;
+        }
+        else if(std::strcmp(args[i], "--set") == 0)
+        {
+            std::string assignment = args[i + 1];
+            size_t      separator  = assignment.find('=');
+            if(separator == std::string::npos)
+            {
+                foray::logger()->warn("--set expects name=value, got \"{}\"", assignment);
+                continue;
+            }
+            project.AddStartupParameter(assignment.substr(0, separator), std::atof(assignment.c_str() + separator + 1));
+        }
+        else if(std::strcmp(args[i], "--reference-mode") == 0)
+        {
+            project.SetStartupReferenceMode(std::atoi(args[i + 1]) != 0);
+        }
+        else if(!BenchmarkRun::ParseArgument(args[i], args[i + 1], benchmark))
+        {
+            foray::logger()->warn("Unknown argument \"{}\"", args[i]);
+        }
+    }
+    project.SetBenchmarkRun(benchmark);
     return project.Run();
-}
\ No newline at end of file
+}
@@ -0,0 +1,180 @@
+#include "noise_source_cache.hpp"
+#include <cstring>
+#include <fstream>
+#include <string_view>
+
+#ifndef NOISE_SOURCE_GENERATOR_KEY
+#define NOISE_SOURCE_GENERATOR_KEY ""
+#endif
+
+void NoiseSourceCache::Create(foray::core::Context* context, const std::string& cachePath)
+{
+    mContext = context;
+
+    foray::bench::HostBenchmark bench;
+    bench.Begin();
+    mLoadedFromCache = LoadFromCache(cachePath);
+    if(mLoadedFromCache)
+    {
+        bench.LogTimestamp("Load cache + upload");
+    }
+    else
+    {
+        GenerateAndWriteCache(cachePath);
+        bench.LogTimestamp("Generate + write cache");
+    }
+    bench.End();
+    foray::logger()->info("Create Noise Tex ({})\n{}", mLoadedFromCache ? "cached" : "generated", bench.GetLogs().front().PrintPretty());
+}
+
+uint64_t NoiseSourceCache::GeneratorKey()
+{
+    // FNV-1a
+    uint64_t         hash = 14695981039346656037ULL;
+    std::string_view key  = NOISE_SOURCE_GENERATOR_KEY;
+    for(char c : key)
+    {
+        hash = (hash ^ (uint8_t)c) * 1099511628211ULL;
+    }
+    return (hash ^ VK_FORMAT_R32_UINT) * 1099511628211ULL;
+}
+
+foray::core::ManagedImage& NoiseSourceCache::GetImage()
+{
+    return mLoadedFromCache ? mCachedImage : mNoiseSource.GetImage();
+}
+
+bool NoiseSourceCache::LoadFromCache(const std::string& cachePath)
+{
+    std::ifstream file(cachePath, std::ios::binary);
+    if(!file.is_open())
+    {
+        return false;
+    }
+
+    CacheHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if(!file || std::memcmp(header.Magic, "RNSC", 4) != 0 || header.Version != CACHE_VERSION || header.GeneratorKey != GeneratorKey() || header.Format != VK_FORMAT_R32_UINT
+       || header.ByteSize != (uint64_t)header.Width * header.Height * sizeof(uint32_t))
+    {
+        foray::logger()->warn("Noise source cache \"{}\" is outdated or corrupt, regenerating", cachePath);
+        return false;
+    }
+
+    std::vector<uint8_t> texels(header.ByteSize);
+    file.read(reinterpret_cast<char*>(texels.data()), texels.size());
+    if(!file)
+    {
+        foray::logger()->warn("Noise source cache \"{}\" is truncated, regenerating", cachePath);
+        return false;
+    }
+
+    // same usage as the generated image, so the raytracing stages can bind either one as storage image
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    foray::core::ManagedImage::CreateInfo ci(usage, VK_FORMAT_R32_UINT, VkExtent2D{header.Width, header.Height}, "Noise Source (cached)");
+    mCachedImage.Create(mContext, ci);
+
+    // single staging copy straight into the final layout
+    mCachedImage.WriteDeviceLocalData(texels.data(), texels.size(), VK_IMAGE_LAYOUT_GENERAL);
+    return true;
+}
+
+void NoiseSourceCache::GenerateAndWriteCache(const std::string& cachePath)
+{
+    mNoiseSource.Create(mContext);
+    mGenerated = true;
+
+    foray::core::ManagedImage& image = mNoiseSource.GetImage();
+    if(image.GetFormat() != VK_FORMAT_R32_UINT)
+    {
+        foray::logger()->warn("Noise source format changed, not writing cache \"{}\"", cachePath);
+        return;
+    }
+
+    std::vector<uint8_t> texels;
+    ReadbackGeneratedImage(texels);
+
+    VkExtent3D  extent = image.GetExtent3D();
+    CacheHeader header{.Magic        = {'R', 'N', 'S', 'C'},
+                       .Version      = CACHE_VERSION,
+                       .Format       = VK_FORMAT_R32_UINT,
+                       .Width        = extent.width,
+                       .Height       = extent.height,
+                       .Reserved     = 0,
+                       .ByteSize     = texels.size(),
+                       .GeneratorKey = GeneratorKey()};
+
+    std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+    if(!file.is_open())
+    {
+        foray::logger()->warn("Unable to write noise source cache \"{}\"", cachePath);
+        return;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(texels.data()), texels.size());
+}
+
+void NoiseSourceCache::ReadbackGeneratedImage(std::vector<uint8_t>& texels)
+{
+    foray::core::ManagedImage& image  = mNoiseSource.GetImage();
+    VkExtent3D                 extent = image.GetExtent3D();
+    VkDeviceSize               size   = (VkDeviceSize)extent.width * extent.height * sizeof(uint32_t);
+
+    foray::core::ManagedBuffer staging;
+    staging.Create(mContext, VK_BUFFER_USAGE_TRANSFER_DST_BIT, size, VMA_MEMORY_USAGE_AUTO_PREFER_HOST, VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT,
+                   "NoiseSourceReadback");
+
+    foray::core::HostSyncCommandBuffer cmdBuffer;
+    cmdBuffer.Create(mContext);
+    cmdBuffer.Begin();
+
+    // NoiseSource leaves its image in general layout for storage image access
+    VkImageMemoryBarrier barrier{.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                                 .srcAccessMask       = VK_ACCESS_MEMORY_WRITE_BIT,
+                                 .dstAccessMask       = VK_ACCESS_TRANSFER_READ_BIT,
+                                 .oldLayout           = VK_IMAGE_LAYOUT_GENERAL,
+                                 .newLayout           = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                 .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                 .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                 .image               = image.GetImage(),
+                                 .subresourceRange    = VkImageSubresourceRange{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}};
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{.bufferOffset      = 0,
+                             .bufferRowLength   = 0,
+                             .bufferImageHeight = 0,
+                             .imageSubresource  = VkImageSubresourceLayers{VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+                             .imageOffset       = VkOffset3D{},
+                             .imageExtent       = extent};
+    vkCmdCopyImageToBuffer(cmdBuffer, image.GetImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, staging.GetBuffer(), 1, &region);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout     = VK_IMAGE_LAYOUT_GENERAL;
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    cmdBuffer.SubmitAndWait();
+    cmdBuffer.Destroy();
+
+    texels.resize(size);
+    void* mapped = nullptr;
+    staging.Map(mapped);
+    std::memcpy(texels.data(), mapped, size);
+    staging.Unmap();
+    staging.Destroy();
+}
+
+void NoiseSourceCache::Destroy()
+{
+    // the generator only exists after a cache miss
+    if(mGenerated)
+    {
+        mNoiseSource.Destroy();
+        mGenerated = false;
+    }
+    if(mCachedImage.Exists())
+    {
+        mCachedImage.Destroy();
+    }
+}
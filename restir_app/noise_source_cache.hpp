@@ -0,0 +1,56 @@
+#pragma once
+#include <foray_api.hpp>
+#include <util/foray_noisesource.hpp>
+
+/// @brief Provides the noise texture used for seeding the per pixel rng.
+/// The texture produced by foray::util::NoiseSource is stored on disk in its final GPU format after the first run.
+/// Subsequent startups upload the cached texels with a single staging copy, which yields bit-identical content without rerunning the generator.
+class NoiseSourceCache
+{
+  public:
+    /// @brief Loads the noise texture from cachePath. Generates it with foray::util::NoiseSource and writes the cache if the file is missing or does not match.
+    void Create(foray::core::Context* context, const std::string& cachePath);
+    void Destroy();
+
+    foray::core::ManagedImage& GetImage();
+
+    /// @brief True, if the texture was uploaded from the cache file
+    inline bool LoadedFromCache() const { return mLoadedFromCache; }
+
+  protected:
+    /// @brief Header preceding the raw texel data in the cache file
+    struct CacheHeader
+    {
+        char     Magic[4];
+        uint32_t Version;
+        uint32_t Format;
+        uint32_t Width;
+        uint32_t Height;
+        uint32_t Reserved;
+        uint64_t ByteSize;
+        /// @brief GeneratorKey() of the build that wrote the cache
+        uint64_t GeneratorKey;
+    };
+
+    /// @brief Increment whenever the cache file layout changes, generator changes are caught by GeneratorKey
+    static constexpr uint32_t CACHE_VERSION = 2;
+
+    /// @brief Hash of the generator sources (hashed by CMake into NOISE_SOURCE_GENERATOR_KEY) and the cached format
+    static uint64_t GeneratorKey();
+
+    bool LoadFromCache(const std::string& cachePath);
+    void GenerateAndWriteCache(const std::string& cachePath);
+
+    /// @brief Copies the generated noise image into host memory
+    void ReadbackGeneratedImage(std::vector<uint8_t>& texels);
+
+    foray::core::Context* mContext = nullptr;
+
+    /// @brief Generator, only used on a cache miss
+    foray::util::NoiseSource mNoiseSource;
+    bool                     mGenerated = false;
+    /// @brief Image uploaded from the cache file
+    foray::core::ManagedImage mCachedImage;
+
+    bool mLoadedFromCache = false;
+};
@@ -0,0 +1,341 @@
+#include "parameter_sweep.hpp"
+#include "reference_comparison.hpp"
+#include "restirstage.hpp"
+#include <algorithm>
+#include <fstream>
+#include <imgui/imgui.h>
+#include <random>
+#include <sstream>
+
+void ParameterSweep::Init(foray::RestirStage* restirStage, ReferenceComparison* referenceComparison, const std::string& directory)
+{
+    mRestirStage         = restirStage;
+    mReferenceComparison = referenceComparison;
+    mDirectory           = directory;
+}
+
+std::string ParameterSweep::GetPresetPath() const
+{
+    return mDirectory + "/restir_preset.txt";
+}
+
+bool ParameterSweep::LoadSpec(const std::string& path)
+{
+    std::ifstream file(path);
+    if(!file.is_open())
+    {
+        foray::logger()->warn("Unable to read sweep \"{}\"", path);
+        return false;
+    }
+
+    std::vector<std::string_view> parameterNames = foray::RestirStage::GetParameterNames();
+
+    Settings          settings;
+    std::vector<Axis> axes;
+    std::string       line;
+    while(std::getline(file, line))
+    {
+        std::string name;
+        std::string valueList;
+        if(!restir_preset::ParseLine(line, name, valueList))
+        {
+            continue;
+        }
+
+        std::vector<double> values;
+        std::stringstream   stream(valueList);
+        std::string         value;
+        try
+        {
+            while(std::getline(stream, value, ','))
+            {
+                values.push_back(std::stod(value));
+            }
+        }
+        catch(const std::exception&)
+        {
+            foray::logger()->warn("Sweep \"{}\": \"{}\" is not a list of numbers", path, valueList);
+            return false;
+        }
+
+        if(name == "warmup_frames")
+        {
+            settings.WarmupFrames = (uint32_t)values[0];
+        }
+        else if(name == "measure_frames")
+        {
+            settings.MeasureFrames = std::max((uint32_t)values[0], 1U);
+        }
+        else if(name == "budget_ms")
+        {
+            settings.BudgetMs = (float)values[0];
+        }
+        else if(name == "max_configurations")
+        {
+            settings.MaxConfigurations = (uint32_t)values[0];
+        }
+        else if(name == "seed")
+        {
+            settings.Seed = (uint32_t)values[0];
+        }
+        else if(std::find(parameterNames.begin(), parameterNames.end(), name) != parameterNames.end())
+        {
+            axes.push_back(Axis{.Parameter = name, .Values = values});
+        }
+        else
+        {
+            foray::logger()->warn("Sweep \"{}\": unknown parameter \"{}\"", path, name);
+        }
+    }
+
+    mSettings = settings;
+    mAxes     = axes;
+    return true;
+}
+
+void ParameterSweep::BuildConfigurations()
+{
+    mConfigurations.clear();
+    size_t count = 1;
+    for(const Axis& axis : mAxes)
+    {
+        count *= axis.Values.size();
+    }
+
+    // mixed radix enumeration of the grid, first axis varies fastest
+    for(size_t index = 0; index < count; index++)
+    {
+        std::vector<uint32_t>& configuration = mConfigurations.emplace_back(mAxes.size());
+        size_t                 remainder     = index;
+        for(size_t axis = 0; axis < mAxes.size(); axis++)
+        {
+            configuration[axis] = (uint32_t)(remainder % mAxes[axis].Values.size());
+            remainder /= mAxes[axis].Values.size();
+        }
+    }
+
+    if(mSettings.MaxConfigurations > 0 && mConfigurations.size() > mSettings.MaxConfigurations)
+    {
+        std::mt19937 rng(mSettings.Seed);
+        std::shuffle(mConfigurations.begin(), mConfigurations.end(), rng);
+        mConfigurations.resize(mSettings.MaxConfigurations);
+    }
+}
+
+bool ParameterSweep::Start()
+{
+    if(mAxes.empty() || std::any_of(mAxes.begin(), mAxes.end(), [](const Axis& axis) { return axis.Values.empty(); }))
+    {
+        foray::logger()->warn("Parameter sweep has no values to measure");
+        return false;
+    }
+    if(!mReferenceComparison->HasReference() && !mReferenceComparison->LoadReference())
+    {
+        foray::logger()->warn("Parameter sweep requires a reference, save one in reference mode first");
+        return false;
+    }
+    if(mRestirStage->IsReferenceMode())
+    {
+        foray::logger()->warn("Parameter sweep can not run in reference mode");
+        return false;
+    }
+
+    BuildConfigurations();
+    mPresetBeforeSweep = mRestirStage->GetPreset();
+    mResults.clear();
+    mCurrentConfiguration = 0;
+    foray::logger()->info("Parameter sweep over {} configurations, {} frames each", mConfigurations.size(), mSettings.WarmupFrames + mSettings.MeasureFrames);
+    BeginConfiguration();
+    return true;
+}
+
+void ParameterSweep::Stop()
+{
+    if(!IsRunning())
+    {
+        return;
+    }
+    mPhase = EPhase::Idle;
+    mResults.pop_back();
+    mRestirStage->ApplyPreset(mPresetBeforeSweep);
+    foray::logger()->info("Parameter sweep aborted after {} configurations", mResults.size());
+}
+
+void ParameterSweep::BeginConfiguration()
+{
+    const std::vector<uint32_t>& configuration = mConfigurations[mCurrentConfiguration];
+
+    Result& result = mResults.emplace_back();
+    for(size_t axis = 0; axis < mAxes.size(); axis++)
+    {
+        result.Parameters.emplace_back(mAxes[axis].Parameter, mAxes[axis].Values[configuration[axis]]);
+    }
+    mRestirStage->ApplyPreset(result.Parameters);
+    // timings of frames recorded with the previous configuration are still in flight
+    mRestirStage->ResetGpuTimes();
+
+    mPhase       = EPhase::Warmup;
+    mPhaseFrames = 0;
+    mGpuMsSum    = 0.0;
+    mGpuMsFrames = 0;
+}
+
+void ParameterSweep::Update(uint64_t frameNumber)
+{
+    switch(mPhase)
+    {
+        case EPhase::Warmup:
+            if(++mPhaseFrames >= mSettings.WarmupFrames)
+            {
+                mPhase       = EPhase::Measure;
+                mPhaseFrames = 0;
+            }
+            break;
+        case EPhase::Measure: {
+            // 0 until the first frame of this configuration is read back, which a short warmup may not cover
+            float gpuMs = mRestirStage->GetLastGpuMs();
+            if(gpuMs > 0.f)
+            {
+                mGpuMsSum += gpuMs;
+                mGpuMsFrames++;
+            }
+            if(++mPhaseFrames >= mSettings.MeasureFrames)
+            {
+                mResults.back().GpuMs = mGpuMsFrames > 0 ? mGpuMsSum / mGpuMsFrames : 0.0;
+                mReferenceComparison->RequestMetrics();
+                mMetricsRequestFrame = frameNumber;
+                mPhase               = EPhase::WaitMetrics;
+            }
+            break;
+        }
+        case EPhase::WaitMetrics: {
+            ImageErrorMetrics metrics;
+            int64_t           metricsFrame = -1;
+            if(mReferenceComparison->GetLastMetrics(metrics, metricsFrame) && metricsFrame >= (int64_t)mMetricsRequestFrame)
+            {
+                mResults.back().Metrics = metrics;
+                if(++mCurrentConfiguration < mConfigurations.size())
+                {
+                    BeginConfiguration();
+                }
+                else
+                {
+                    Finish();
+                }
+            }
+            else if(frameNumber > mMetricsRequestFrame + 120)
+            {
+                // the readback was dropped (no free capture slot), measure again
+                mReferenceComparison->RequestMetrics();
+                mMetricsRequestFrame = frameNumber;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void ParameterSweep::MarkParetoFront(std::vector<Result>& results)
+{
+    for(Result& result : results)
+    {
+        result.Pareto = std::none_of(results.begin(), results.end(), [&result](const Result& other) {
+            bool noWorse = other.GpuMs <= result.GpuMs && other.Metrics.RelMse <= result.Metrics.RelMse;
+            bool better  = other.GpuMs < result.GpuMs || other.Metrics.RelMse < result.Metrics.RelMse;
+            return noWorse && better;
+        });
+    }
+}
+
+void ParameterSweep::WriteResults() const
+{
+    std::string   path = mDirectory + "/sweep_results.csv";
+    std::ofstream file(path, std::ios::trunc);
+    if(!file.is_open())
+    {
+        foray::logger()->warn("Unable to write sweep results \"{}\"", path);
+        return;
+    }
+
+    for(const Axis& axis : mAxes)
+    {
+        file << axis.Parameter << ",";
+    }
+    file << "gpu ms,rmse,relmse,flip,pareto\n";
+    for(const Result& result : mResults)
+    {
+        for(const auto& [name, value] : result.Parameters)
+        {
+            file << value << ",";
+        }
+        file << result.GpuMs << "," << result.Metrics.Rmse << "," << result.Metrics.RelMse << "," << result.Metrics.Flip << "," << (result.Pareto ? 1 : 0) << "\n";
+    }
+    foray::logger()->info("Wrote {} sweep results to \"{}\"", mResults.size(), path);
+}
+
+void ParameterSweep::Finish()
+{
+    mPhase = EPhase::Idle;
+    MarkParetoFront(mResults);
+    WriteResults();
+
+    // lowest error within the budget, the fastest combination if none fits
+    const Result* chosen = nullptr;
+    for(const Result& result : mResults)
+    {
+        if(!result.Pareto)
+        {
+            continue;
+        }
+        foray::logger()->info("Pareto front: {:.3f} ms relMSE {:.5f}", result.GpuMs, result.Metrics.RelMse);
+        bool fits = result.GpuMs <= mSettings.BudgetMs;
+        if(!chosen || (fits && (chosen->GpuMs > mSettings.BudgetMs || result.Metrics.RelMse < chosen->Metrics.RelMse))
+           || (!fits && chosen->GpuMs > mSettings.BudgetMs && result.GpuMs < chosen->GpuMs))
+        {
+            chosen = &result;
+        }
+    }
+
+    // the preset contains all parameters, the swept ones at the chosen values
+    mRestirStage->ApplyPreset(mPresetBeforeSweep);
+    mRestirStage->ApplyPreset(chosen->Parameters);
+    std::stringstream comment;
+    comment << "Parameter sweep result: " << chosen->GpuMs << " ms (budget " << mSettings.BudgetMs << " ms), relMSE " << chosen->Metrics.RelMse;
+    if(mRestirStage->SavePreset(GetPresetPath(), comment.str()))
+    {
+        foray::logger()->info("Wrote preset \"{}\" ({:.3f} ms, relMSE {:.5f})", GetPresetPath(), chosen->GpuMs, chosen->Metrics.RelMse);
+    }
+}
+
+void ParameterSweep::ImguiControls()
+{
+    if(IsRunning())
+    {
+        ImGui::Text("Parameter sweep: configuration %zu / %zu", mCurrentConfiguration + 1, mConfigurations.size());
+        if(ImGui::Button("Abort sweep"))
+        {
+            Stop();
+        }
+        return;
+    }
+
+    if(ImGui::Button("Run sweep (sweep.txt)") && LoadSpec(mDirectory + "/sweep.txt"))
+    {
+        Start();
+    }
+    ImGui::SameLine();
+    if(ImGui::Button("Save preset"))
+    {
+        mRestirStage->SavePreset(GetPresetPath());
+    }
+    ImGui::SameLine();
+    if(ImGui::Button("Load preset"))
+    {
+        mRestirStage->LoadPreset(GetPresetPath());
+    }
+    if(!mResults.empty())
+    {
+        ImGui::Text("Last sweep: %zu configurations, see sweep_results.csv", mResults.size());
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include "image_metrics.hpp"
+#include "restir_preset.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace foray {
+    class RestirStage;
+}
+class ReferenceComparison;
+
+/// @brief Measures GPU time and error against the reference for a grid of ReSTIR parameter combinations.
+/// Every combination is applied, rendered for a warmup period (history, GPU timer latency), timed over a number of
+/// frames and compared against the reference once. The results are written as csv with the Pareto front of
+/// (GPU time, relMSE) marked, the lowest error combination within the frame budget is saved as preset.
+class ParameterSweep
+{
+  public:
+    struct Axis
+    {
+        /// @brief One of RestirStage::GetParameterNames()
+        std::string         Parameter;
+        std::vector<double> Values;
+    };
+
+    struct Settings
+    {
+        uint32_t WarmupFrames  = 60;
+        uint32_t MeasureFrames = 30;
+        /// @brief GPU time budget of the ReSTIR passes for the preset choice
+        float BudgetMs = 5.f;
+        /// @brief 0 = full grid, otherwise a random subset of the grid of this size is measured
+        uint32_t MaxConfigurations = 0;
+        uint32_t Seed              = 1;
+    };
+
+    struct Result
+    {
+        RestirPreset      Parameters;
+        double            GpuMs = 0.0;
+        ImageErrorMetrics Metrics{};
+        bool              Pareto = false;
+    };
+
+    /// @brief Results and presets are written to directory
+    void Init(foray::RestirStage* restirStage, ReferenceComparison* referenceComparison, const std::string& directory);
+
+    /// @brief Reads a sweep file: settings (warmup_frames, measure_frames, budget_ms, max_configurations, seed) as
+    /// "name = value" and axes as "parameter = value, value, ..."
+    bool LoadSpec(const std::string& path);
+    inline void SetSettings(const Settings& settings) { mSettings = settings; }
+    inline void SetAxes(const std::vector<Axis>& axes) { mAxes = axes; }
+
+    /// @brief Fails without axes or without a loadable reference
+    bool Start();
+    /// @brief Aborts and restores the parameters from before the sweep
+    void Stop();
+    inline bool IsRunning() const { return mPhase != EPhase::Idle; }
+
+    /// @brief Advances the sweep. Call once per frame before the ReSTIR stage and the reference comparison are recorded.
+    void Update(uint64_t frameNumber);
+
+    inline const std::vector<Result>& GetResults() const { return mResults; }
+
+    /// @brief Start / stop, progress and preset buttons for the current ImGui window
+    void ImguiControls();
+
+    /// @brief Default preset location, loaded by the app at startup if present
+    std::string GetPresetPath() const;
+
+  protected:
+    enum class EPhase
+    {
+        Idle,
+        Warmup,
+        Measure,
+        WaitMetrics,
+    };
+
+    void BuildConfigurations();
+    void BeginConfiguration();
+    void Finish();
+    static void MarkParetoFront(std::vector<Result>& results);
+    void        WriteResults() const;
+
+    foray::RestirStage*  mRestirStage         = nullptr;
+    ReferenceComparison* mReferenceComparison = nullptr;
+    std::string          mDirectory;
+
+    Settings          mSettings;
+    std::vector<Axis> mAxes;
+
+    /// @brief Parameter combinations still to measure, as value index per axis
+    std::vector<std::vector<uint32_t>> mConfigurations;
+    size_t                             mCurrentConfiguration = 0;
+    RestirPreset                       mPresetBeforeSweep;
+
+    EPhase   mPhase               = EPhase::Idle;
+    uint32_t mPhaseFrames         = 0;
+    double   mGpuMsSum            = 0.0;
+    uint32_t mGpuMsFrames         = 0;
+    uint64_t mMetricsRequestFrame = 0;
+
+    std::vector<Result> mResults;
+};
@@ -0,0 +1,168 @@
+#include "reference_comparison.hpp"
+#include <imgui/imgui.h>
+#include <limits>
+
+void ReferenceComparison::Init(FrameCapture* capture, const std::string& directory)
+{
+    mCapture   = capture;
+    mDirectory = directory;
+}
+
+bool ReferenceComparison::HasReference()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mReference != nullptr;
+}
+
+bool ReferenceComparison::LoadReference()
+{
+    std::string path      = mDirectory + "/reference.pfm";
+    auto        reference = std::make_shared<FloatImage>();
+    if(!ReadPfm(path, *reference))
+    {
+        foray::logger()->warn("Unable to load reference \"{}\"", path);
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mMutex);
+    mReference = reference;
+    return true;
+}
+
+bool ReferenceComparison::GetLastMetrics(ImageErrorMetrics& metrics, int64_t& frame) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    metrics = mLastMetrics;
+    frame   = mLastMetricsFrame;
+    return mLastMetricsFrame >= 0;
+}
+
+void ReferenceComparison::BeginFrame(uint64_t frameNumber, bool benchmarkRecording)
+{
+    // periodic measurement while benchmarking, skipped while the previous one is still computing
+    if(benchmarkRecording && !mBenchmarkRecording)
+    {
+        mLastScheduledFrame = frameNumber;
+    }
+    mBenchmarkRecording = benchmarkRecording;
+    if(benchmarkRecording && mRequested == EReadback::None && !mMetricsInFlight && frameNumber >= mLastScheduledFrame + (uint64_t)std::max(mMetricsInterval, 1)
+       && HasReference())
+    {
+        mRequested          = EReadback::Metrics;
+        mLastScheduledFrame = frameNumber;
+    }
+}
+
+void ReferenceComparison::ComputeMetrics(const FloatImage& image, uint64_t frame)
+{
+    std::shared_ptr<const FloatImage> reference;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        reference = mReference;
+    }
+
+    ImageErrorMetrics metrics;
+    if(!reference || !image_metrics::Compute(image, *reference, metrics))
+    {
+        foray::logger()->warn("Reference size does not match the output, not computing metrics");
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mLastMetrics      = metrics;
+        mLastMetricsFrame = (int64_t)frame;
+    }
+    mMetricsInFlight = false;
+}
+
+void ReferenceComparison::CmdRecord(VkCommandBuffer cmdBuffer, foray::base::FrameRenderInfo& renderInfo, foray::core::ManagedImage* referenceSource, foray::core::ManagedImage* measured)
+{
+    if(mRequested == EReadback::None)
+    {
+        return;
+    }
+
+    switch(mRequested)
+    {
+        case EReadback::SaveReference:
+            mCapture->CmdReadback(cmdBuffer, renderInfo, referenceSource, [this](FloatImage& image, uint64_t) {
+                std::string path = mDirectory + "/reference.pfm";
+                if(!WritePfm(path, image))
+                {
+                    foray::logger()->warn("Unable to write reference \"{}\"", path);
+                }
+                std::lock_guard<std::mutex> lock(mMutex);
+                mReference = std::make_shared<const FloatImage>(std::move(image));
+            });
+            break;
+        case EReadback::SaveOutput:
+            mCapture->CmdReadback(cmdBuffer, renderInfo, measured, [this](FloatImage& image, uint64_t frame) {
+                std::string path = mDirectory + "/output_" + std::to_string(frame) + ".pfm";
+                if(!WritePfm(path, image))
+                {
+                    foray::logger()->warn("Unable to write output \"{}\"", path);
+                }
+            });
+            break;
+        case EReadback::Metrics:
+            mMetricsInFlight = mCapture->CmdReadback(cmdBuffer, renderInfo, measured, [this](FloatImage& image, uint64_t frame) { ComputeMetrics(image, frame); });
+            break;
+        default:
+            break;
+    }
+    mRequested = EReadback::None;
+}
+
+void ReferenceComparison::AppendBenchmarkColumns(BenchmarkCsv::Row& row) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    bool                        measured = mLastMetricsFrame >= 0;
+    double                      nan      = std::numeric_limits<double>::quiet_NaN();
+    row.emplace_back("rmse", measured ? mLastMetrics.Rmse : nan);
+    row.emplace_back("relmse", measured ? mLastMetrics.RelMse : nan);
+    row.emplace_back("flip", measured ? mLastMetrics.Flip : nan);
+    row.emplace_back("metrics frame", measured ? (double)mLastMetricsFrame : nan);
+}
+
+void ReferenceComparison::ImguiControls()
+{
+    if(ImGui::Button("Save reference"))
+    {
+        mRequested = EReadback::SaveReference;
+    }
+    ImGui::SameLine();
+    if(ImGui::Button("Load reference"))
+    {
+        LoadReference();
+    }
+    ImGui::SameLine();
+    if(ImGui::Button("Save output"))
+    {
+        mRequested = EReadback::SaveOutput;
+    }
+
+    if(!HasReference())
+    {
+        ImGui::Text("No reference loaded");
+        return;
+    }
+
+    if(ImGui::Button("Measure error"))
+    {
+        mRequested = EReadback::Metrics;
+    }
+    ImGui::SameLine();
+    ImGui::InputInt("Benchmark measure interval", &mMetricsInterval);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if(mLastMetricsFrame >= 0)
+    {
+        ImGui::Text("Frame %lld: RMSE %.5f relMSE %.5f FLIP %.5f", (long long)mLastMetricsFrame, mLastMetrics.Rmse, mLastMetrics.RelMse, mLastMetrics.Flip);
+    }
+}
+
+void ReferenceComparison::Destroy()
+{
+    // the capture drains its workers before this is called
+    std::lock_guard<std::mutex> lock(mMutex);
+    mReference = nullptr;
+}
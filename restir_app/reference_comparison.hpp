@@ -0,0 +1,67 @@
+#pragma once
+#include "benchmark_csv.hpp"
+#include "float_image.hpp"
+#include "image_metrics.hpp"
+#include "frame_capture.hpp"
+#include <foray_api.hpp>
+#include <memory>
+#include <mutex>
+
+/// @brief Quality measurement against a converged reference. Saves the reference (accumulated by the ReSTIR reference mode),
+/// reads back the displayed output on request or every N frames while a benchmark is recorded, and computes the error
+/// metrics on the capture workers, so the benchmark rows carry the error next to the GPU pass times.
+class ReferenceComparison
+{
+  public:
+    /// @brief Reference and output images are written to / read from directory, readbacks go through capture
+    void Init(FrameCapture* capture, const std::string& directory);
+    void Destroy();
+
+    /// @brief Schedules the periodic measurement. Call before recording the frame.
+    void BeginFrame(uint64_t frameNumber, bool benchmarkRecording);
+    /// @brief Records a requested copy. referenceSource is saved as reference, measured is compared against the reference or saved as output.
+    void CmdRecord(VkCommandBuffer cmdBuffer, foray::base::FrameRenderInfo& renderInfo, foray::core::ManagedImage* referenceSource, foray::core::ManagedImage* measured);
+
+    /// @brief Adds the most recent metrics and the frame they were measured on (nan before the first measurement)
+    void AppendBenchmarkColumns(BenchmarkCsv::Row& row) const;
+
+    /// @brief Draws the reference / metrics controls into the current ImGui window
+    void ImguiControls();
+
+    bool HasReference();
+    /// @brief Reads reference.pfm from the directory
+    bool LoadReference();
+
+    /// @brief Measures the next recorded frame against the reference
+    inline void RequestMetrics() { mRequested = EReadback::Metrics; }
+    /// @brief Most recent metrics and the frame they were measured on, false before the first measurement
+    bool GetLastMetrics(ImageErrorMetrics& metrics, int64_t& frame) const;
+
+  protected:
+    enum class EReadback
+    {
+        None,
+        SaveReference,
+        SaveOutput,
+        Metrics,
+    };
+
+    /// @brief Runs on a capture worker
+    void ComputeMetrics(const FloatImage& image, uint64_t frame);
+
+    FrameCapture* mCapture = nullptr;
+    std::string   mDirectory;
+
+    EReadback         mRequested = EReadback::None;
+    std::atomic<bool> mMetricsInFlight{false};
+
+    /// @brief Guards the reference and the last metrics, both are written by capture workers
+    mutable std::mutex                mMutex;
+    std::shared_ptr<const FloatImage> mReference;
+    ImageErrorMetrics                 mLastMetrics{};
+    int64_t                           mLastMetricsFrame = -1;
+
+    int      mMetricsInterval    = 60;
+    uint64_t mLastScheduledFrame = 0;
+    bool     mBenchmarkRecording = false;
+};
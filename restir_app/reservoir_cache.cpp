@@ -0,0 +1,71 @@
+#include "reservoir_cache.hpp"
+
+void ReservoirCache::Create(foray::core::Context* context, VkDeviceSize reservoirSize)
+{
+    mContext           = context;
+    VkDeviceSize bytes = sizeof(Header) + (VkDeviceSize)ENTRY_COUNT * (ENTRY_HEADER_SIZE + reservoirSize);
+    mBuffer.Create(mContext, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, bytes, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0, "ReservoirCache");
+    mCleared = false;
+}
+
+void ReservoirCache::CreatePipeline(const std::vector<VkDescriptorSetLayout>& descriptorSetLayouts, const std::unordered_map<std::string, std::string>& definitions)
+{
+    mUpdatePass.Create(mContext, UPDATE_FILE, descriptorSetLayouts, 0, "ReservoirCacheUpdate", definitions);
+}
+
+void ReservoirCache::DestroyPipeline()
+{
+    mUpdatePass.Destroy();
+}
+
+void ReservoirCache::AddShaderDefinitions(std::unordered_map<std::string, std::string>& definitions)
+{
+    definitions["RESERVOIR_CACHE_BUCKETS"] = std::to_string(BUCKET_COUNT);
+    definitions["RESERVOIR_CACHE_WAYS"]    = std::to_string(WAYS);
+}
+
+void ReservoirCache::CmdBeginFrame(VkCommandBuffer cmdBuffer)
+{
+    if(mCleared)
+    {
+        return;
+    }
+
+    // zero keys and stamps mark every entry as never written
+    VkMemoryBarrier clearBarrier{.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                 .srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                                 .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT};
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1,
+                         &clearBarrier, 0, nullptr, 0, nullptr);
+    vkCmdFillBuffer(cmdBuffer, mBuffer.GetBuffer(), 0, VK_WHOLE_SIZE, 0);
+    VkMemoryBarrier readBarrier{.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                                .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                         &readBarrier, 0, nullptr, 0, nullptr);
+    mCleared = true;
+}
+
+void ReservoirCache::CmdUpdate(VkCommandBuffer cmdBuffer, const std::vector<VkDescriptorSet>& descriptorSets, VkExtent2D renderExtent)
+{
+    // final reservoirs are written by raygen or the compute spatial reuse, raygen lookups have to finish before the inserts
+    VkMemoryBarrier readBarrier{.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                .srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                                .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                         &readBarrier, 0, nullptr, 0, nullptr);
+
+    mUpdatePass.CmdBind(cmdBuffer, descriptorSets);
+    mUpdatePass.CmdDispatch(cmdBuffer, renderExtent);
+
+    // next frames raygen looks up the inserted entries
+    VkMemoryBarrier writeBarrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER, .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT, .dstAccessMask = VK_ACCESS_SHADER_READ_BIT};
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                         &writeBarrier, 0, nullptr, 0, nullptr);
+}
+
+void ReservoirCache::Destroy()
+{
+    DestroyPipeline();
+    mBuffer.Destroy();
+}
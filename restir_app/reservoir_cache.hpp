@@ -0,0 +1,56 @@
+#pragma once
+#include "compute_pass.hpp"
+#include <foray_api.hpp>
+#include <string>
+#include <unordered_map>
+
+/// @brief World space reservoir cache (shaders/restir/reservoirCache.glsl). A fixed size, set associative hash table of
+/// reservoirs keyed by quantized surface position and normal. reservoirCacheUpdate.comp inserts the final reservoirs of every
+/// frame with LRU eviction per bucket, raygen seeds disoccluded pixels and pixels that just came on screen from it.
+class ReservoirCache
+{
+  public:
+    static constexpr uint32_t BUCKET_COUNT = 1U << 14;
+    static constexpr uint32_t WAYS         = 4;
+    static constexpr uint32_t ENTRY_COUNT  = BUCKET_COUNT * WAYS;
+
+    /// @brief reservoirSize is the std430 size of the shader Reservoir struct
+    void Create(foray::core::Context* context, VkDeviceSize reservoirSize);
+    void Destroy();
+    inline bool Exists() const { return mBuffer.Exists(); }
+
+    /// @brief Builds the update pipeline. Set 0 provides the bindings of the compute spatial reuse (ReSTIR config, GBuffer,
+    /// statistics, cache), set 1 is a reservoir swap set.
+    void CreatePipeline(const std::vector<VkDescriptorSetLayout>& descriptorSetLayouts, const std::unordered_map<std::string, std::string>& definitions);
+    void DestroyPipeline();
+    inline uint64_t GetShaderKey() const { return mUpdatePass.GetShaderKey(); }
+
+    /// @brief RESERVOIR_CACHE_BUCKETS and RESERVOIR_CACHE_WAYS for every shader including reservoirCache.glsl
+    static void AddShaderDefinitions(std::unordered_map<std::string, std::string>& definitions);
+
+    /// @brief Empties the cache with the next CmdBeginFrame
+    inline void Clear() { mCleared = false; }
+    /// @brief Clears the table if requested (and once after creation), record before the raygen pass
+    void CmdBeginFrame(VkCommandBuffer cmdBuffer);
+    /// @brief Inserts the final reservoirs of renderExtent, record after they are written
+    void CmdUpdate(VkCommandBuffer cmdBuffer, const std::vector<VkDescriptorSet>& descriptorSets, VkExtent2D renderExtent);
+
+    /// @brief Bound at set 0 binding 29
+    inline foray::core::ManagedBuffer& GetBuffer() { return mBuffer; }
+
+  protected:
+    /// @brief std430 header of the buffer, followed by the entries (16 bytes of key and stamps, then the reservoir)
+    struct Header
+    {
+        uint32_t UsedEntries;
+        uint32_t Padding[3];
+    };
+    static constexpr VkDeviceSize ENTRY_HEADER_SIZE = 16;
+
+    static inline const std::string UPDATE_FILE = "shaders/restir/reservoirCacheUpdate.comp";
+
+    foray::core::Context*      mContext = nullptr;
+    foray::core::ManagedBuffer mBuffer;
+    ComputePass                mUpdatePass;
+    bool                       mCleared = false;
+};
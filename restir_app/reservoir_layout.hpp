@@ -0,0 +1,101 @@
+#pragma once
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+/// @brief CPU mirror of shaders/restir/reservoirLayout.glsl
+namespace reservoir_layout {
+    enum class ELayout : uint32_t
+    {
+        Linear = 0,
+        /// @brief 8x8 pixel blocks stored contiguously, Morton order inside each block
+        Tiled = 1,
+    };
+
+    inline constexpr uint32_t TILE_SIZE = 8;
+
+    inline constexpr uint32_t MortonEncode3Bit(uint32_t x, uint32_t y)
+    {
+        x &= 7u;
+        y &= 7u;
+        x = (x | (x << 2)) & 0x33u;
+        x = (x | (x << 1)) & 0x55u;
+        y = (y | (y << 2)) & 0x33u;
+        y = (y | (y << 1)) & 0x55u;
+        return x | (y << 1);
+    }
+
+    /// @brief Inverse of MortonEncode3Bit for one coordinate, code shifted so the coordinate occupies the even bits
+    inline constexpr uint32_t MortonCompact3Bit(uint32_t code)
+    {
+        code &= 0x15u;
+        code = (code | (code >> 1)) & 0x33u;
+        code = (code | (code >> 2)) & 0x07u;
+        return code;
+    }
+
+    inline constexpr uint32_t ReservoirIndex(uint32_t x, uint32_t y, uint32_t width, ELayout layout)
+    {
+        if(layout == ELayout::Tiled)
+        {
+            uint32_t tilesPerRow = (width + TILE_SIZE - 1) / TILE_SIZE;
+            return ((y / TILE_SIZE) * tilesPerRow + x / TILE_SIZE) * (TILE_SIZE * TILE_SIZE) + MortonEncode3Bit(x, y);
+        }
+        return y * width + x;
+    }
+
+    /// @brief Inverse of ReservoirIndex
+    inline void PixelOf(uint32_t index, uint32_t width, ELayout layout, uint32_t& x, uint32_t& y)
+    {
+        if(layout == ELayout::Tiled)
+        {
+            uint32_t tilesPerRow = (width + TILE_SIZE - 1) / TILE_SIZE;
+            uint32_t tile        = index / (TILE_SIZE * TILE_SIZE);
+            uint32_t morton      = index % (TILE_SIZE * TILE_SIZE);
+            x                    = (tile % tilesPerRow) * TILE_SIZE + MortonCompact3Bit(morton);
+            y                    = (tile / tilesPerRow) * TILE_SIZE + MortonCompact3Bit(morton >> 1);
+            return;
+        }
+        x = index % width;
+        y = index / width;
+    }
+
+    /// @brief Number of reservoirs to allocate, large enough for every layout (tiled layout rounds up to whole tiles)
+    inline constexpr uint64_t ReservoirCount(VkExtent2D extent)
+    {
+        uint64_t tilesX = (extent.width + TILE_SIZE - 1) / TILE_SIZE;
+        uint64_t tilesY = (extent.height + TILE_SIZE - 1) / TILE_SIZE;
+        return tilesX * tilesY * TILE_SIZE * TILE_SIZE;
+    }
+
+    /// @brief True if every pixel of extent maps to an index below ReservoirCount(extent) that PixelOf maps back to the pixel,
+    /// so no two pixels share a reservoir. Visits every pixel, the static_asserts below only cover whole tiles.
+    inline bool CheckRoundTrip(VkExtent2D extent, ELayout layout)
+    {
+        uint64_t count = ReservoirCount(extent);
+        for(uint32_t y = 0; y < extent.height; y++)
+        {
+            for(uint32_t x = 0; x < extent.width; x++)
+            {
+                uint32_t index = ReservoirIndex(x, y, extent.width, layout);
+                uint32_t pixelX = 0;
+                uint32_t pixelY = 0;
+                PixelOf(index, extent.width, layout, pixelX, pixelY);
+                if(index >= count || pixelX != x || pixelY != y)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    static_assert(MortonCompact3Bit(MortonEncode3Bit(5, 3)) == 5);
+    static_assert(MortonCompact3Bit(MortonEncode3Bit(5, 3) >> 1) == 3);
+    static_assert(ReservoirIndex(0, 0, 16, ELayout::Tiled) == 0);
+    static_assert(ReservoirIndex(1, 0, 16, ELayout::Tiled) == 1);
+    static_assert(ReservoirIndex(0, 1, 16, ELayout::Tiled) == 2);
+    static_assert(ReservoirIndex(7, 7, 16, ELayout::Tiled) == 63);
+    static_assert(ReservoirIndex(8, 0, 16, ELayout::Tiled) == 64);
+    static_assert(ReservoirIndex(0, 8, 16, ELayout::Tiled) == 128);
+    static_assert(ReservoirIndex(3, 2, 16, ELayout::Linear) == 35);
+}  // namespace reservoir_layout
@@ -0,0 +1,108 @@
+#include "resolution_upsampler.hpp"
+
+void ResolutionUpsampler::Create(foray::core::Context*        context,
+                                 foray::stages::GBufferStage* gbufferStage,
+                                 foray::core::ManagedImage*   output,
+                                 foray::core::ManagedBuffer*  restirConfigUbo)
+{
+    mContext         = context;
+    mGBufferStage    = gbufferStage;
+    mOutput          = output;
+    mRestirConfigUbo = restirConfigUbo;
+
+    CreateImages();
+    CreateOrUpdateDescriptorSet();
+    mUpsamplePass.Create(mContext, UPSAMPLE_FILE, {mDescriptorSet.GetDescriptorSetLayout()}, 0, "ResolutionUpsample");
+}
+
+void ResolutionUpsampler::Resize(foray::core::ManagedImage* output)
+{
+    mOutput = output;
+    DestroyImages();
+    CreateImages();
+    CreateOrUpdateDescriptorSet();
+}
+
+void ResolutionUpsampler::CreateImages()
+{
+    VkImageUsageFlags                     usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    foray::core::ManagedImage::CreateInfo ci(usage, VK_FORMAT_R16G16B16A16_SFLOAT, mContext->GetSwapchainSize(), "RestirLowResOutput");
+    mLowRes.Create(mContext, ci);
+    mLowResSampled.Init(mContext, &mLowRes, mSamplerCi);
+
+    mGuidesSampled[0].Init(mContext, mGBufferStage->GetImageEOutput(foray::stages::GBufferStage::EOutput::Normal), mSamplerCi);
+    mGuidesSampled[1].Init(mContext, mGBufferStage->GetImageEOutput(foray::stages::GBufferStage::EOutput::Position), mSamplerCi);
+}
+
+void ResolutionUpsampler::DestroyImages()
+{
+    for(foray::core::CombinedImageSampler& sampler : mGuidesSampled)
+    {
+        sampler.Destroy();
+    }
+    mLowResSampled.Destroy();
+    mLowRes.Destroy();
+}
+
+void ResolutionUpsampler::CreateOrUpdateDescriptorSet()
+{
+    mDescriptorSet.SetDescriptorAt(0, std::vector<const foray::core::CombinedImageSampler*>{&mLowResSampled}, VK_IMAGE_LAYOUT_GENERAL,
+                                   VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT);
+    for(uint32_t i = 0; i < mGuidesSampled.size(); i++)
+    {
+        mDescriptorSet.SetDescriptorAt(1 + i, std::vector<const foray::core::CombinedImageSampler*>{&mGuidesSampled[i]}, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                       VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT);
+    }
+    std::vector<VkDescriptorImageInfo> outputInfos{VkDescriptorImageInfo{.imageView = mOutput->GetImageView(), .imageLayout = VK_IMAGE_LAYOUT_GENERAL}};
+    mDescriptorSet.SetDescriptorAt(3, outputInfos, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT);
+    mDescriptorSet.SetDescriptorAt(11, mRestirConfigUbo, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+
+    if(mDescriptorSet.Exists())
+    {
+        mDescriptorSet.Update();
+    }
+    else
+    {
+        mDescriptorSet.Create(mContext, "ResolutionUpsample_DescriptorSet");
+    }
+}
+
+void ResolutionUpsampler::CmdPrepareLowRes(VkCommandBuffer cmdBuffer, foray::base::FrameRenderInfo& renderInfo, VkPipelineStageFlagBits dstStage)
+{
+    // previous contents are never read
+    foray::core::ImageLayoutCache::Barrier barrier;
+    barrier.SrcAccessMask               = VK_ACCESS_SHADER_READ_BIT;
+    barrier.DstAccessMask               = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.NewLayout                   = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.SubresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    renderInfo.GetImageLayoutCache().CmdBarrier(cmdBuffer, &mLowRes, barrier, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dstStage);
+}
+
+void ResolutionUpsampler::CmdUpsample(VkCommandBuffer cmdBuffer, foray::base::FrameRenderInfo& renderInfo, VkPipelineStageFlagBits srcStage)
+{
+    foray::core::ImageLayoutCache& layoutCache = renderInfo.GetImageLayoutCache();
+
+    foray::core::ImageLayoutCache::Barrier lowResBarrier;
+    lowResBarrier.SrcAccessMask               = VK_ACCESS_SHADER_WRITE_BIT;
+    lowResBarrier.DstAccessMask               = VK_ACCESS_SHADER_READ_BIT;
+    lowResBarrier.NewLayout                   = VK_IMAGE_LAYOUT_GENERAL;
+    lowResBarrier.SubresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    layoutCache.CmdBarrier(cmdBuffer, &mLowRes, lowResBarrier, srcStage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    foray::core::ImageLayoutCache::Barrier outputBarrier;
+    outputBarrier.SrcAccessMask               = VK_ACCESS_SHADER_WRITE_BIT;
+    outputBarrier.DstAccessMask               = VK_ACCESS_SHADER_WRITE_BIT;
+    outputBarrier.NewLayout                   = VK_IMAGE_LAYOUT_GENERAL;
+    outputBarrier.SubresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    layoutCache.CmdBarrier(cmdBuffer, mOutput, outputBarrier, srcStage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    mUpsamplePass.CmdBind(cmdBuffer, {mDescriptorSet.GetDescriptorSet()});
+    mUpsamplePass.CmdDispatch(cmdBuffer, mContext->GetSwapchainSize());
+}
+
+void ResolutionUpsampler::Destroy()
+{
+    mUpsamplePass.Destroy();
+    mDescriptorSet.Destroy();
+    DestroyImages();
+}
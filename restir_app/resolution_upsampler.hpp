@@ -0,0 +1,57 @@
+#pragma once
+#include "compute_pass.hpp"
+#include <array>
+#include <foray_api.hpp>
+
+/// @brief Holds the reduced resolution ReSTIR output and upsamples it to the output image, guided by the full resolution GBuffer.
+/// The low resolution image is allocated at output size, the ReSTIR passes only write its top left render extent.
+class ResolutionUpsampler
+{
+  public:
+    void Create(foray::core::Context*        context,
+                foray::stages::GBufferStage* gbufferStage,
+                foray::core::ManagedImage*   output,
+                foray::core::ManagedBuffer*  restirConfigUbo);
+    /// @brief Recreates the low resolution image after the output was resized
+    void Resize(foray::core::ManagedImage* output);
+    void Destroy();
+    inline bool Exists() const { return mUpsamplePass.Exists(); }
+
+    /// @brief Makes the low resolution image writable for the ReSTIR pass writing the color (dstStage)
+    void CmdPrepareLowRes(VkCommandBuffer cmdBuffer, foray::base::FrameRenderInfo& renderInfo, VkPipelineStageFlagBits dstStage);
+    /// @brief Resolves the low resolution image to the output image. srcStage is the stage that wrote the low resolution color
+    void CmdUpsample(VkCommandBuffer cmdBuffer, foray::base::FrameRenderInfo& renderInfo, VkPipelineStageFlagBits srcStage);
+
+    inline foray::core::ManagedImage* GetLowResImage() { return &mLowRes; }
+
+  protected:
+    void CreateImages();
+    void DestroyImages();
+    void CreateOrUpdateDescriptorSet();
+
+    static inline const std::string UPSAMPLE_FILE = "shaders/restir/upsample.comp";
+
+    foray::core::Context*        mContext{};
+    foray::stages::GBufferStage* mGBufferStage{};
+    foray::core::ManagedImage*   mOutput{};
+    foray::core::ManagedBuffer*  mRestirConfigUbo{};
+
+    foray::core::ManagedImage                        mLowRes;
+    foray::core::CombinedImageSampler                mLowResSampled;
+    std::array<foray::core::CombinedImageSampler, 2> mGuidesSampled;
+
+    foray::core::DescriptorSet mDescriptorSet;
+    ComputePass                mUpsamplePass;
+
+    static constexpr VkSamplerCreateInfo mSamplerCi = VkSamplerCreateInfo{.sType                   = VkStructureType::VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+                                                                          .magFilter               = VkFilter::VK_FILTER_NEAREST,
+                                                                          .minFilter               = VkFilter::VK_FILTER_NEAREST,
+                                                                          .addressModeU            = VkSamplerAddressMode::VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                                          .addressModeV            = VkSamplerAddressMode::VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                                          .addressModeW            = VkSamplerAddressMode::VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                                          .anisotropyEnable        = VK_FALSE,
+                                                                          .compareEnable           = VK_FALSE,
+                                                                          .minLod                  = 0,
+                                                                          .maxLod                  = 0,
+                                                                          .unnormalizedCoordinates = VK_FALSE};
+};
@@ -37,6 +37,9 @@ VkBool32 myDebugCallback(VkDebugReportFlagsEXT      flags,
 
 void RestirProject::ApiBeforeInit()
 {
+    // the gap before the ApiInit span is the instance, device and swapchain creation of foray
+    HostTrace::Get().Start();
+
 #ifdef USE_PRINTF
     mInstance.SetDebugReportFunc(&myDebugCallback);
 #endif
@@ -46,18 +49,26 @@ void RestirProject::ApiBeforeInit()
 
     // allow drawing mesh in polygon line mode
     mDevice.GetPhysicalDeviceFeatures().fillModeNonSolid = true;
+
+    // GL_EXT_ray_query in spatialReuse.comp
+    mDevice.SetBeforePhysicalDeviceSelectFunc([](vkb::PhysicalDeviceSelector& selector) { selector.add_required_extension(VK_KHR_RAY_QUERY_EXTENSION_NAME); });
+    mDevice.SetBeforeDeviceBuildFunc([this](vkb::DeviceBuilder& builder) { builder.add_pNext(&mRayQueryFeatures); });
 }
 
 void RestirProject::ApiInit()
 {
     //mRenderLoop.GetFrameTiming().DisableFpsLimit();
     foray::logger()->set_level(spdlog::level::debug);
-    LoadEnvironmentMap();
-    GenerateNoiseSource();
-    loadScene();
-    CollectEmissiveTriangles();
-    UploadLightsToGpu();
-    ConfigureStages();
+    {
+        TraceScope trace("ApiInit");
+        LoadEnvironmentMap();
+        GenerateNoiseSource();
+        loadScene();
+        CollectEmissiveTriangles();
+        UploadLightsToGpu();
+        ConfigureStages();
+    }
+    HostTrace::Get().Finish(std::string(foray::osi::CurrentWorkingDirectory()) + "/startup_trace.json");
 }
 
 void RestirProject::ApiOnEvent(const foray::osi::Event* event)
@@ -94,14 +105,19 @@ void RestirProject::loadScene()
     });
     // clang-format on
 
+    TraceScope trace("loadScene");
     mScene = std::make_unique<foray::scene::Scene>(&mContext);
     foray::gltf::ModelConverter converter(mScene.get());
     for(const auto& modelLoad : modelLoads)
     {
+        TraceScope modelTrace("LoadGltfModel " + std::filesystem::path(modelLoad.ModelPath).filename().string());
         converter.LoadGltfModel(foray::osi::MakeRelativePath(modelLoad.ModelPath), &mContext, modelLoad.ModelConverterOptions);
     }
 
-    mScene->UpdateTlasManager();
+    {
+        TraceScope tlasTrace("Build TLAS");
+        mScene->UpdateTlasManager();
+    }
     mScene->UseDefaultCamera(true);
 
     auto ptr = mScene->GetComponent<foray::scene::gcomp::AnimationManager>();
@@ -118,6 +134,7 @@ void RestirProject::loadScene()
 
 void RestirProject::LoadEnvironmentMap()
 {
+    TraceScope trace("LoadEnvironmentMap");
 
     constexpr VkFormat                    hdrVkFormat = VK_FORMAT_R32G32B32A32_SFLOAT;
     foray::util::ImageLoader<hdrVkFormat> imageLoader;
@@ -157,15 +174,14 @@ void RestirProject::LoadEnvironmentMap()
 
 void RestirProject::GenerateNoiseSource()
 {
-    foray::bench::HostBenchmark bench;
-    bench.Begin();
-    mNoiseSource.Create(&mContext);
-    bench.End();
-    foray::logger()->info("Create Noise Tex \n{}", bench.GetLogs().front().PrintPretty());
+    TraceScope trace("GenerateNoiseSource");
+    // startup timings for the cached and the generating path are logged by the cache itself
+    mNoiseSource.Create(&mContext, std::string(foray::osi::CurrentWorkingDirectory()) + "/noisesource.cache");
 }
 
 void RestirProject::CollectEmissiveTriangles()
 {
+    TraceScope trace("CollectEmissiveTriangles");
     // find cube mesh vertices and indices
     std::vector<foray::scene::Node*> nodesWithMeshInstances{};
     mScene->FindNodesWithComponent<foray::scene::ncomp::MeshInstance>(nodesWithMeshInstances);
@@ -176,6 +192,17 @@ void RestirProject::CollectEmissiveTriangles()
     foray::scene::gcomp::MaterialManager* materialManager = mScene->GetComponent<foray::scene::gcomp::MaterialManager>();
     std::vector<foray::scene::Material>&  materials       = materialManager->GetVector();
 
+    struct EmissiveTriangle
+    {
+        glm::vec3 P[3];
+        glm::vec3 Normal;
+        glm::vec3 EmissiveFactor;
+        int32_t   MaterialIndex;
+    };
+    std::vector<EmissiveTriangle>                    emissiveTriangles;
+    std::vector<EmissiveTextureIntegrator::Triangle> footprints;
+    std::set<int32_t>                                emissiveTextures;
+
     for(foray::scene::Node* node : nodesWithMeshInstances)
     {
         foray::scene::ncomp::MeshInstance* meshInstance = node->GetComponent<foray::scene::ncomp::MeshInstance>();
@@ -209,56 +236,143 @@ void RestirProject::CollectEmissiveTriangles()
             glm::mat4                       transformMat = transform->GetGlobalMatrix();
 
             // create triangles from vertices & indices
-            uint32_t baseCount    = mTriangleLights.size();
-            uint32_t numTriangles = (indices->size() / 3);
-            mTriangleLights.resize(baseCount + numTriangles);
             for(size_t i = 0; i < indices->size(); i += 3)
             {
-                // collect vertices
-                glm::vec3 p1_vec3 = vertices->at(indices->at(i)).Pos;
-                glm::vec3 p2_vec3 = vertices->at(indices->at(i + 1)).Pos;
-                glm::vec3 p3_vec3 = vertices->at(indices->at(i + 2)).Pos;
-
-                // TODO: world matrix of primitive has to be considered for triangle position.
-                shader::TriLight& triLight = mTriangleLights[baseCount + (i / 3)];
-                triLight.p1                = transformMat * glm::vec4(p1_vec3, 1.0);
-                triLight.p2                = transformMat * glm::vec4(p2_vec3, 1.0);
-                triLight.p3                = transformMat * glm::vec4(p3_vec3, 1.0);
-
-                // material index for shader lookup
-                triLight.materialIndex = materialIndex;
-
-                // compute triangle area
-                glm::vec3 normal            = vertices->at(indices->at(i)).Normal + vertices->at(indices->at(i + 1)).Normal + vertices->at(indices->at(i + 2)).Normal;
-                glm::vec3 normal_normalized = glm::normalize(normal);
-                triLight.normal             = glm::vec4(normal_normalized.x, normal_normalized.y, normal_normalized.z, normal.length());
-                //foray::logger()->debug("TriLightNormal: {},{},{},{}", triLight.normal.x, triLight.normal.y, triLight.normal.z, triLight.normal.w);
+                const foray::scene::Vertex& v1 = vertices->at(indices->at(i));
+                const foray::scene::Vertex& v2 = vertices->at(indices->at(i + 1));
+                const foray::scene::Vertex& v3 = vertices->at(indices->at(i + 2));
+
+                EmissiveTriangle& triangle = emissiveTriangles.emplace_back();
+                triangle.P[0]              = glm::vec3(transformMat * glm::vec4(v1.Pos, 1.0));
+                triangle.P[1]              = glm::vec3(transformMat * glm::vec4(v2.Pos, 1.0));
+                triangle.P[2]              = glm::vec3(transformMat * glm::vec4(v3.Pos, 1.0));
+                triangle.Normal            = glm::normalize(v1.Normal + v2.Normal + v3.Normal);
+                triangle.EmissiveFactor    = material.EmissiveFactor;
+                triangle.MaterialIndex     = materialIndex;
+
+                EmissiveTextureIntegrator::Triangle& footprint = footprints.emplace_back();
+                footprint.Uv[0]                                = v1.Uv;
+                footprint.Uv[1]                                = v2.Uv;
+                footprint.Uv[2]                                = v3.Uv;
+                footprint.TextureIndex                         = material.EmissiveTextureIndex;
+                if(material.EmissiveTextureIndex >= 0)
+                {
+                    emissiveTextures.insert(material.EmissiveTextureIndex);
+                }
             }
         }
     }
+
+    // average radiance per triangle: emissive factor times the mean of the emissive texture over the triangle's uv footprint
+    auto                   start = std::chrono::steady_clock::now();
+    std::vector<glm::vec3> textureAverages;
+    {
+        EmissiveTextureIntegrator integrator;
+        {
+            TraceScope loadTrace("Load emissive textures");
+            integrator.LoadTextures(&mContext, mScene.get(), emissiveTextures);
+        }
+        TraceScope integrateTrace("Integrate emissive textures");
+        integrator.Integrate(footprints, textureAverages);
+    }
+
+    // below one 8 bit texture step the triangle contributes nothing visible, but would still be sampled
+    constexpr float                  blackThreshold = 1.f / 255.f;
+    std::vector<light_lod::Triangle> lights;
+    std::vector<uint32_t>            lightOfTriangle(emissiveTriangles.size(), EmissiveTriangleLookup::EMPTY);
+    lights.reserve(emissiveTriangles.size());
+    for(size_t i = 0; i < emissiveTriangles.size(); i++)
+    {
+        const EmissiveTriangle& triangle = emissiveTriangles[i];
+        if(glm::dot(textureAverages[i], glm::vec3(0.2126f, 0.7152f, 0.0722f)) < blackThreshold)
+        {
+            continue;
+        }
+        lightOfTriangle[i]         = (uint32_t)lights.size();
+        light_lod::Triangle& light = lights.emplace_back();
+        std::copy(std::begin(triangle.P), std::end(triangle.P), std::begin(light.P));
+        light.Normal        = triangle.Normal;
+        light.Radiance      = triangle.EmissiveFactor * textureAverages[i];
+        light.MaterialIndex = triangle.MaterialIndex;
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    foray::logger()->info("Emissive triangles: {} of {} kept, {} emissive textures integrated in {:.1f} ms", lights.size(), emissiveTriangles.size(),
+                          emissiveTextures.size(), ms);
+
+    // fewer, larger lights of the same flux: candidate generation picks triangles uniformly, so this lowers its variance
+    start = std::chrono::steady_clock::now();
+    light_lod::Report report;
+    {
+        TraceScope lodTrace("Light LOD");
+        lights = light_lod::Simplify(lights, mLightLodSettings, report);
+    }
+    ms     = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if(mLightLodSettings.Enabled)
+    {
+        foray::logger()->info("Light LOD: {} -> {} triangles in {:.1f} ms, flux {:.4g} -> {:.4g}, relative variance of uniform selection {:.3g} -> {:.3g}",
+                              report.InputCount, report.OutputCount, ms, report.InputFlux, report.OutputFlux, report.InputRelativeVariance,
+                              report.OutputRelativeVariance);
+        if(report.FluxError() > light_lod::FLUX_TOLERANCE)
+        {
+            foray::logger()->warn("Light LOD changed the emitted flux by {:.3g}%", report.FluxError() * 100.0);
+        }
+    }
+
+    // BRDF sampled ReSTIR candidates find the light of a hit scene triangle by its centroid
+    std::vector<glm::vec3> centroids;
+    centroids.reserve(emissiveTriangles.size());
+    for(size_t i = 0; i < emissiveTriangles.size(); i++)
+    {
+        const EmissiveTriangle& triangle = emissiveTriangles[i];
+        centroids.push_back((triangle.P[0] + triangle.P[1] + triangle.P[2]) / 3.f);
+        if(lightOfTriangle[i] != EmissiveTriangleLookup::EMPTY)
+        {
+            lightOfTriangle[i] = report.OutputOfInput[lightOfTriangle[i]];
+        }
+    }
+    {
+        TraceScope lookupTrace("Build emissive lookup");
+        mEmissiveTriangleLookup.Build(centroids, lightOfTriangle);
+    }
+
+    // emission is folded into the light record, the area is derived from its edges in the shaders
+    mTriangleLights.clear();
+    mTriangleLights.reserve(lights.size());
+    for(const light_lod::Triangle& light : lights)
+    {
+        mTriangleLights.push_back(tri_light::Pack(light.P[0], light.P[1], light.P[2], light.Normal, light.Radiance));
+    }
 }
 
 void RestirProject::UploadLightsToGpu()
 {
+    TraceScope trace("UploadLightsToGpu");
     VkBufferUsageFlags       bufferUsage    = VkBufferUsageFlagBits::VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
     VkDeviceSize             bufferSize     = mTriangleLights.size() * sizeof(shader::TriLight);
     VmaMemoryUsage           bufferMemUsage = VmaMemoryUsage::VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
     VmaAllocationCreateFlags allocFlags     = 0;
     mTriangleLightsBuffer.Create(&mContext, bufferUsage, bufferSize, bufferMemUsage, allocFlags, "TriangleLightsBuffer");
     mTriangleLightsBuffer.WriteDataDeviceLocal(mTriangleLights.data(), bufferSize);
+    mEmissiveTriangleLookup.Upload(&mContext);
 }
 
 void RestirProject::ApiDestroy()
 {
+    // finishes outstanding readbacks, which may still call into the reference comparison
+    mFrameCapture.Destroy();
+    mBenchmarkRun.Destroy();
     mNoiseSource.Destroy();
     mScene->Destroy();
     mScene = nullptr;
     mGbufferStage.Destroy();
     mImguiStage.Destroy();
     mRestirStage.Destroy();
+    mDenoiserStage.Destroy();
+    mReferenceComparison.Destroy();
 	mETMStage.Destroy();
     mSphericalEnvMap.Destroy();
     mTriangleLightsBuffer.Destroy();
+    mEmissiveTriangleLookup.Destroy();
 }
 
 void RestirProject::ApiOnShadersRecompiled(std::unordered_set<uint64_t>& recompiledShaderKeys)
@@ -302,35 +416,104 @@ void RestirProject::PrepareImguiWindow()
             ImGui::EndCombo();
         }
 
+        ImGui::Separator();
+        mBenchmarkCsv.ImguiControls(std::string(foray::osi::CurrentWorkingDirectory()) + "/benchmark.csv");
+
+        ImGui::Separator();
+        mFrameCapture.ImguiControls();
+
+        ImGui::Separator();
+        mReferenceComparison.ImguiControls();
+
+        ImGui::Separator();
+        mParameterSweep.ImguiControls();
+
         ImGui::End();
     });
+    mImguiStage.AddWindowDraw([this]() { mMemoryReport.ImguiWindow(std::string(foray::osi::CurrentWorkingDirectory()) + "/memory_report.json"); });
 }
 
 void RestirProject::ConfigureStages()
 {
-    mGbufferStage.Init(&mContext, mScene.get());
-    mRestirStage.Init(&mContext, mScene.get(), &mSphericalEnvMapSampler, &mNoiseSource.GetImage(), &mGbufferStage, &mImguiStage, this);
-    mRestirStage.SetNumberOfTriangleLights(mTriangleLights.size());
+    TraceScope trace("ConfigureStages");
+    {
+        TraceScope stageTrace("GBufferStage::Init");
+        mGbufferStage.Init(&mContext, mScene.get());
+    }
+    {
+        TraceScope stageTrace("RestirStage::Init");
+        mRestirStage.Init(&mContext, mScene.get(), &mSphericalEnvMapSampler, &mNoiseSource.GetImage(), &mGbufferStage, &mImguiStage, this);
+        mRestirStage.SetNumberOfTriangleLights(mTriangleLights.size());
+    }
 
     auto depthImage = mGbufferStage.GetImageOutput(mGbufferStage.DepthOutputName);
     auto colorImage = mGbufferStage.GetImageOutput(mGbufferStage.AlbedoOutputName);
-    auto rtOutput   = mRestirStage.GetImageOutput(mRestirStage.OutputName);
-    mETMStage.Init(&mContext, &mTriangleLights, depthImage, rtOutput, mScene.get());
+    {
+        TraceScope stageTrace("DenoiserStage::Init");
+        mDenoiserStage.Init(&mContext, &mGbufferStage, &mRestirStage, foray::stages::DefaultRaytracingStageBase::OutputName);
+    }
     UpdateOutputs();
+    // emissive triangles are highlighted on the displayed image, after denoising, so they stay sharp
+    {
+        TraceScope stageTrace("EmissiveTriangleMeshStage::Init");
+        mETMStage.Init(&mContext, &mTriangleLightsBuffer, (uint32_t)mTriangleLights.size(), depthImage, mOutputs[mCurrentOutput], mScene.get());
+    }
+    mFrameCapture.Init(&mContext, std::string(foray::osi::CurrentWorkingDirectory()));
+    mFrameCapture.SetFlipY(true);
+    mReferenceComparison.Init(&mFrameCapture, std::string(foray::osi::CurrentWorkingDirectory()));
+    mParameterSweep.Init(&mRestirStage, &mReferenceComparison, std::string(foray::osi::CurrentWorkingDirectory()));
+
+    // benchmark runs start from the defaults unless a preset is given, so a sweep result does not change them
+    std::string presetPath = mStartupPreset.empty() ? mParameterSweep.GetPresetPath() : mStartupPreset;
+    if(!mStartupPreset.empty() || (mBenchmarkSettings.OutputPrefix.empty() && std::filesystem::exists(presetPath)))
+    {
+        mRestirStage.LoadPreset(presetPath);
+    }
+    if(!mStartupParameters.empty())
+    {
+        mRestirStage.ApplyPreset(mStartupParameters);
+    }
+    if(mStartupReferenceMode)
+    {
+        mRestirStage.SetReferenceMode(true);
+    }
 
-    mImguiStage.InitForSwapchain(&mContext);
-    PrepareImguiWindow();
-    mRestirStage.PrepareImguiWindow();
+    mBenchmarkRun.Init(&mContext, &mFrameCapture, mBenchmarkSettings);
+    mBenchmarkRun.SetInfo("app", "restir");
+    mBenchmarkRun.SetInfo("reference_mode", mStartupReferenceMode ? "1" : "0");
+    for(const auto& [name, value] : mRestirStage.GetPreset())
+    {
+        mBenchmarkRun.SetInfo(name, std::to_string(value));
+    }
+    if(!mStartupSweep.empty())
+    {
+        mQuitAfterSweep = mParameterSweep.LoadSpec(mStartupSweep) && mParameterSweep.Start();
+    }
+
+    {
+        TraceScope stageTrace("ImguiStage::Init");
+        mImguiStage.InitForSwapchain(&mContext);
+        PrepareImguiWindow();
+        mRestirStage.PrepareImguiWindow();
+        mDenoiserStage.PrepareImguiWindow(&mImguiStage);
+    }
 
     // Init copy stage
-    mImageToSwapchainStage.Init(&mContext, mOutputs[mCurrentOutput]);
-    mImageToSwapchainStage.SetFlipY(true);
+    {
+        TraceScope stageTrace("ImageToSwapchainStage::Init");
+        mImageToSwapchainStage.Init(&mContext, mOutputs[mCurrentOutput]);
+        mImageToSwapchainStage.SetFlipY(true);
+    }
 
     RegisterRenderStage(&mGbufferStage);
     RegisterRenderStage(&mRestirStage);
+    RegisterRenderStage(&mDenoiserStage);
     RegisterRenderStage(&mETMStage);
     RegisterRenderStage(&mImguiStage);
     RegisterRenderStage(&mImageToSwapchainStage);
+
+    mMemoryReport.Init(&mContext);
+    mMemoryReport.Update();
 }
 
 void RestirProject::ApiRender(foray::base::FrameRenderInfo& renderInfo)
@@ -341,6 +524,26 @@ void RestirProject::ApiRender(foray::base::FrameRenderInfo& renderInfo)
         mOutputChanged = false;
     }
 
+    RecordBenchmarkFrame(renderInfo);
+    if(mBenchmarkRun.IsFinished())
+    {
+        GetRenderLoop().RequestStop();
+    }
+    mBenchmarkRun.BeginFrame();
+    mParameterSweep.Update(renderInfo.GetFrameNumber());
+    // measured runs keep the host free of the periodic allocation walk
+    if(!mBenchmarkRun.IsActive() && !mParameterSweep.IsRunning())
+    {
+        mMemoryReport.OnFrame(renderInfo.GetFrameNumber());
+    }
+    if(mQuitAfterSweep && !mParameterSweep.IsRunning())
+    {
+        GetRenderLoop().RequestStop();
+        mQuitAfterSweep = false;
+    }
+    mFrameCapture.Update();
+    mReferenceComparison.BeginFrame(renderInfo.GetFrameNumber(), mBenchmarkCsv.IsRecording());
+
     foray::core::DeviceSyncCommandBuffer& commandBuffer = renderInfo.GetPrimaryCommandBuffer();
     commandBuffer.Begin();
 
@@ -361,8 +564,26 @@ void RestirProject::ApiRender(foray::base::FrameRenderInfo& renderInfo)
 
     mRestirStage.RecordFrame(commandBuffer, renderInfo);
 
-    if(mHighlightEmissiveTriangles)
+    // the suite compares sampling, so it measures the raw ReSTIR output. Rasterized primary visibility casts no rays.
+    mBenchmarkRun.AddGpuMs(mRestirStage.GetLastGpuMs());
+#ifdef RESTIR_STATS
+    // shadow rays, BRDF candidate rays and GI rays are consecutive counters. Without them the run reports rays_counted = 0.
+    mBenchmarkRun.CmdCopyRayCounter(commandBuffer, mRestirStage.GetStatistics().GetCounterBuffer().GetBuffer(), RestirStatistics::SHADOW_RAYS * sizeof(uint32_t), 3);
+#endif
+    mBenchmarkRun.CmdCaptureOutput(commandBuffer, renderInfo, mRestirStage.GetImageOutput(foray::stages::DefaultRaytracingStageBase::OutputName));
+
+    mDenoiserStage.RecordFrame(commandBuffer, renderInfo);
+
+    // the reference is taken from the raw ReSTIR output, captures and measurements from the displayed output before the overlay is drawn
+    mFrameCapture.CmdCapture(commandBuffer, renderInfo, mOutputs[mCurrentOutput], mCurrentOutput);
+    mReferenceComparison.CmdRecord(commandBuffer, renderInfo, mRestirStage.GetImageOutput(foray::stages::DefaultRaytracingStageBase::OutputName),
+                                   mOutputs[mCurrentOutput]);
+
+    // the material index output is an integer image, the overlay is drawn onto the color outputs only
+    if(mHighlightEmissiveTriangles && mCurrentOutput != foray::stages::GBufferStage::MaterialIdxOutputName)
+    {
         mETMStage.RecordFrame(commandBuffer, renderInfo);
+    }
 
     // copy final image to swapchain
     mImageToSwapchainStage.RecordFrame(commandBuffer, renderInfo);
@@ -374,14 +595,38 @@ void RestirProject::ApiRender(foray::base::FrameRenderInfo& renderInfo)
     commandBuffer.Submit();
 }
 
+void RestirProject::RecordBenchmarkFrame(foray::base::FrameRenderInfo& renderInfo)
+{
+    auto   now     = std::chrono::steady_clock::now();
+    double frameMs = std::chrono::duration<double, std::milli>(now - mLastFrameStart).count();
+    mLastFrameStart = now;
+
+    if(!mBenchmarkCsv.IsRecording())
+    {
+        return;
+    }
+
+    // gpu timings are read back with a few frames latency, rows describe the last completed frame
+    BenchmarkCsv::Row row{{"frame", (double)renderInfo.GetFrameNumber()}, {"cpu frame ms", frameMs}};
+    mRestirStage.AppendBenchmarkColumns(row);
+    mDenoiserStage.AppendBenchmarkColumns(row);
+    mReferenceComparison.AppendBenchmarkColumns(row);
+    mBenchmarkCsv.RecordFrame(row);
+}
+
 void RestirProject::ApiOnResized(VkExtent2D size)
 {
     mScene->InvokeOnResized(size);
     mGbufferStage.Resize(size);
     mRestirStage.Resize(size);
+    mDenoiserStage.Resize(size);
     UpdateOutputs();
+    // the overlay framebuffer references the views of the old targets
+    mETMStage.SetOutput(mOutputs[mCurrentOutput]);
     mImguiStage.Resize(size);
     mImageToSwapchainStage.Resize(size);
+    // the resized targets exist now, the old ones are freed
+    mMemoryReport.Update();
 }
 
 void lUpdateOutput(std::unordered_map<std::string_view, foray::core::ManagedImage*>& map, foray::stages::RenderStage& stage, const std::string_view name)
@@ -397,6 +642,7 @@ void RestirProject::UpdateOutputs()
     lUpdateOutput(mOutputs, mGbufferStage, foray::stages::GBufferStage::NormalOutputName);
     lUpdateOutput(mOutputs, mGbufferStage, foray::stages::GBufferStage::MaterialIdxOutputName);
     lUpdateOutput(mOutputs, mRestirStage, foray::stages::DefaultRaytracingStageBase::OutputName);
+    lUpdateOutput(mOutputs, mDenoiserStage, DenoiserStage::OutputName);
 
     if(mCurrentOutput.size() == 0 || !mOutputs.contains(mCurrentOutput))
     {
@@ -416,4 +662,5 @@ void RestirProject::ApplyOutput()
     vkDeviceWaitIdle(mContext.Device());
     auto output = mOutputs[mCurrentOutput];
     mImageToSwapchainStage.SetSrcImage(output);
+    mETMStage.SetOutput(output);
 }
\ No newline at end of file
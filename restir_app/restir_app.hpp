@@ -4,9 +4,11 @@
 
 #include <algorithm>
 #include <array>
+#include <chrono>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <filesystem>
 #include <foray_glm.hpp>
 #include <fstream>
 #include <iostream>
@@ -18,13 +20,25 @@
 #include <vector>
 
 #include "structs.hpp"
+#include "tri_light_packing.hpp"
 #include <stdint.h>
 
 #include <foray_api.hpp>
-#include <util/foray_noisesource.hpp>
 
+#include "benchmark_csv.hpp"
+#include "benchmark_run.hpp"
+#include "denoiser_stage.hpp"
 #include "restirstage.hpp"
+#include "emissive_texture_integrator.hpp"
+#include "emissive_triangle_lookup.hpp"
 #include "emissive_triangle_mesh_stage.hpp"
+#include "frame_capture.hpp"
+#include "host_trace.hpp"
+#include "light_lod.hpp"
+#include "memory_report.hpp"
+#include "noise_source_cache.hpp"
+#include "parameter_sweep.hpp"
+#include "reference_comparison.hpp"
 
 class RestirProject : public foray::base::DefaultAppBase
 {
@@ -34,6 +48,19 @@ class RestirProject : public foray::base::DefaultAppBase
     RestirProject() = default;
     ~RestirProject(){};
 
+    /// @brief Runs the sweep file after startup and quits once the results and the preset are written
+    inline void SetStartupSweep(const std::string& path) { mStartupSweep = path; }
+    /// @brief Preset loaded at startup instead of restir_preset.txt in the working directory
+    inline void SetStartupPreset(const std::string& path) { mStartupPreset = path; }
+    /// @brief ReSTIR parameters applied after the preset
+    inline void AddStartupParameter(const std::string& name, double value) { mStartupParameters.emplace_back(name, value); }
+    /// @brief Starts in reference mode (accumulation)
+    inline void SetStartupReferenceMode(bool referenceMode) { mStartupReferenceMode = referenceMode; }
+    /// @brief Measures the startup configuration for the benchmark suite and quits. restir_preset.txt is not loaded, only --preset.
+    inline void SetBenchmarkRun(const BenchmarkRun::Settings& settings) { mBenchmarkSettings = settings; }
+    /// @brief Light LOD used when collecting the emissive triangles
+    inline light_lod::Settings& GetLightLodSettings() { return mLightLodSettings; }
+
   protected:
     virtual void ApiBeforeInit() override;
     virtual void ApiInit() override;
@@ -59,6 +86,9 @@ class RestirProject : public foray::base::DefaultAppBase
 
     std::vector<shader::TriLight> mTriangleLights;
 
+    /// @brief Scene triangle -> TriLight index for the BRDF sampled ReSTIR candidates
+    EmissiveTriangleLookup mEmissiveTriangleLookup;
+
     /// @brief generates a GBuffer (Albedo, Positions, Normal, Motion Vectors, Mesh Instance Id as output images)
     foray::stages::GBufferStage mGbufferStage;
 
@@ -71,6 +101,9 @@ class RestirProject : public foray::base::DefaultAppBase
     /// @brief Generates a raytraced image
     foray::RestirStage mRestirStage;
 
+    /// @brief Temporal accumulation + a-trous filter of the ReSTIR output
+    DenoiserStage mDenoiserStage;
+
 	/// @brief Debug stage to visualize all triangles
 	EmissiveTriangleMeshStage mETMStage;
 
@@ -78,16 +111,50 @@ class RestirProject : public foray::base::DefaultAppBase
     foray::core::CombinedImageSampler mSphericalEnvMapSampler{};
 
 
-    foray::util::NoiseSource mNoiseSource;
+    /// @brief Noise texture for rng seeding, cached on disk after the first generation
+    NoiseSourceCache mNoiseSource;
 
     void ConfigureStages();
 
     std::unordered_map<std::string_view, foray::core::ManagedImage*> mOutputs;
-    std::string_view                                                 mCurrentOutput = "";
+    std::string_view                                                 mCurrentOutput = DenoiserStage::OutputName;
     bool                                                             mOutputChanged = false;
 
     void UpdateOutputs();
     void ApplyOutput();
 
 	bool mHighlightEmissiveTriangles = false;
+
+    /// @brief Enabled at device creation, the compute spatial reuse traces its visibility rays with ray queries
+    VkPhysicalDeviceRayQueryFeaturesKHR mRayQueryFeatures{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_QUERY_FEATURES_KHR, .rayQuery = VK_TRUE};
+
+    /// @brief Merges coplanar emissive triangles of similar radiance before upload
+    light_lod::Settings mLightLodSettings;
+
+    /// @brief Per frame timings and ReSTIR state, written as csv on request from the UI
+    BenchmarkCsv                          mBenchmarkCsv;
+    std::chrono::steady_clock::time_point mLastFrameStart = std::chrono::steady_clock::now();
+    void                                  RecordBenchmarkFrame(foray::base::FrameRenderInfo& renderInfo);
+
+    /// @brief Asynchronous readback of the displayed output to EXR / PNG files
+    FrameCapture mFrameCapture;
+
+    /// @brief Saves / loads the converged reference and measures the displayed output against it
+    ReferenceComparison mReferenceComparison;
+
+    /// @brief Searches ReSTIR parameters for the lowest error within a GPU time budget
+    ParameterSweep mParameterSweep;
+    std::string    mStartupSweep;
+    std::string    mStartupPreset;
+    bool           mQuitAfterSweep = false;
+
+    RestirPreset mStartupParameters;
+    bool         mStartupReferenceMode = false;
+
+    /// @brief VMA allocations by resource and category, heap budgets and their peaks
+    MemoryReport mMemoryReport;
+
+    /// @brief Benchmark suite measurement of the raw ReSTIR output
+    BenchmarkRun           mBenchmarkRun;
+    BenchmarkRun::Settings mBenchmarkSettings;
 };
\ No newline at end of file
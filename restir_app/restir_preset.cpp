@@ -0,0 +1,83 @@
+#include "restir_preset.hpp"
+#include <foray_api.hpp>
+#include <fstream>
+#include <sstream>
+
+namespace restir_preset {
+    std::string lTrim(const std::string& text)
+    {
+        size_t begin = text.find_first_not_of(" \t\r");
+        if(begin == std::string::npos)
+        {
+            return "";
+        }
+        size_t end = text.find_last_not_of(" \t\r");
+        return text.substr(begin, end - begin + 1);
+    }
+
+    bool ParseLine(const std::string& line, std::string& name, std::string& value)
+    {
+        std::string content = line.substr(0, line.find('#'));
+        size_t      equals  = content.find('=');
+        if(equals == std::string::npos)
+        {
+            return false;
+        }
+        name  = lTrim(content.substr(0, equals));
+        value = lTrim(content.substr(equals + 1));
+        return !name.empty() && !value.empty();
+    }
+
+    bool Read(const std::string& path, RestirPreset& preset)
+    {
+        std::ifstream file(path);
+        if(!file.is_open())
+        {
+            return false;
+        }
+
+        preset.clear();
+        std::string line;
+        uint32_t    lineNumber = 0;
+        while(std::getline(file, line))
+        {
+            lineNumber++;
+            std::string name;
+            std::string value;
+            if(!ParseLine(line, name, value))
+            {
+                continue;
+            }
+            try
+            {
+                preset.emplace_back(name, std::stod(value));
+            }
+            catch(const std::exception&)
+            {
+                foray::logger()->warn("Preset \"{}\" line {}: \"{}\" is not a number", path, lineNumber, value);
+            }
+        }
+        return true;
+    }
+
+    bool Write(const std::string& path, const RestirPreset& preset, const std::string& comment)
+    {
+        std::ofstream file(path, std::ios::trunc);
+        if(!file.is_open())
+        {
+            return false;
+        }
+
+        std::istringstream commentLines(comment);
+        std::string        line;
+        while(std::getline(commentLines, line))
+        {
+            file << "# " << line << "\n";
+        }
+        for(const auto& [name, value] : preset)
+        {
+            file << name << " = " << value << "\n";
+        }
+        return true;
+    }
+}  // namespace restir_preset
@@ -0,0 +1,17 @@
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+
+/// @brief Named RestirConfiguration values (see RestirStage::GetParameterNames), in file order
+using RestirPreset = std::vector<std::pair<std::string, double>>;
+
+/// @brief Plain text preset files, one "name = value" per line. '#' starts a comment, unknown names are left to the caller.
+namespace restir_preset {
+    /// @brief Splits "name = value # comment" into trimmed name and value. Returns false for empty and comment lines.
+    bool ParseLine(const std::string& line, std::string& name, std::string& value);
+
+    bool Read(const std::string& path, RestirPreset& preset);
+    /// @brief comment is written as '#' lines above the values
+    bool Write(const std::string& path, const RestirPreset& preset, const std::string& comment = "");
+}  // namespace restir_preset
@@ -0,0 +1,185 @@
+#include "restir_statistics.hpp"
+#include "reservoir_cache.hpp"
+#include <cfloat>
+#include <cstring>
+#include <imgui/imgui.h>
+
+void RestirStatistics::Create(foray::core::Context* context)
+{
+    mContext = context;
+    mCounters.Create(mContext, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, COUNTERS_SIZE,
+                     VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0, "RestirStatsCounters");
+    mReadback.Create(mContext, VK_BUFFER_USAGE_TRANSFER_DST_BIT, SLOT_SIZE * STATS_SLOT_COUNT, VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+                     VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT, "RestirStatsReadback");
+
+    void* mapped = nullptr;
+    mReadback.Map(mapped);
+    mReadbackMapped = reinterpret_cast<const uint8_t*>(mapped);
+}
+
+void RestirStatistics::Destroy()
+{
+    if(mReadback.Exists())
+    {
+        mReadback.Unmap();
+        mReadback.Destroy();
+        mReadbackMapped = nullptr;
+    }
+    if(mCounters.Exists())
+    {
+        mCounters.Destroy();
+    }
+}
+
+void RestirStatistics::CmdBeginFrame(VkCommandBuffer cmdBuffer, uint64_t frameNumber)
+{
+    mFrameNumber  = frameNumber;
+    uint32_t slot = (uint32_t)(frameNumber % STATS_SLOT_COUNT);
+    if(mSlotWritten[slot])
+    {
+        ReadbackSlot(slot);
+    }
+
+    // previous frame's shaders and copy are done with the counters before they are cleared
+    VkMemoryBarrier clearBarrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER, .srcAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+                                 .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT};
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+    vkCmdFillBuffer(cmdBuffer, mCounters.GetBuffer(), 0, COUNTERS_SIZE, 0);
+
+    VkMemoryBarrier shaderBarrier{.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                  .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                                  .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                         &shaderBarrier, 0, nullptr, 0, nullptr);
+}
+
+void RestirStatistics::CmdEndFrame(VkCommandBuffer cmdBuffer)
+{
+    uint32_t     slot   = (uint32_t)(mFrameNumber % STATS_SLOT_COUNT);
+    VkDeviceSize offset = slot * SLOT_SIZE;
+
+    VkMemoryBarrier copyBarrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER, .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT, .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT};
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1,
+                         &copyBarrier, 0, nullptr, 0, nullptr);
+
+    VkBufferCopy region{.srcOffset = 0, .dstOffset = offset, .size = COUNTERS_SIZE};
+    vkCmdCopyBuffer(cmdBuffer, mCounters.GetBuffer(), mReadback.GetBuffer(), 1, &region);
+
+    // the stamp is written after the counters, so a matching stamp implies complete counters
+    VkMemoryBarrier stampBarrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER, .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT, .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT};
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &stampBarrier, 0, nullptr, 0, nullptr);
+    vkCmdUpdateBuffer(cmdBuffer, mReadback.GetBuffer(), offset + COUNTERS_SIZE, sizeof(uint64_t), &mFrameNumber);
+
+    VkMemoryBarrier hostBarrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER, .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT, .dstAccessMask = VK_ACCESS_HOST_READ_BIT};
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0, nullptr, 0, nullptr);
+
+    mSlotFrame[slot]   = mFrameNumber;
+    mSlotWritten[slot] = true;
+}
+
+void RestirStatistics::ReadbackSlot(uint32_t slot)
+{
+    const uint8_t* slotData = mReadbackMapped + slot * SLOT_SIZE;
+    uint64_t       stamp    = 0;
+    std::memcpy(&stamp, slotData + COUNTERS_SIZE, sizeof(stamp));
+    if(stamp != mSlotFrame[slot])
+    {
+        // copy not finished yet
+        return;
+    }
+
+    std::memcpy(mLast.data(), slotData, COUNTERS_SIZE);
+    mLastFrame = stamp;
+
+    mTemporalAcceptHistory[mHistoryOffset] = GetRatio(TEMPORAL_ACCEPTED, TEMPORAL_CANDIDATES);
+    mSpatialAcceptHistory[mHistoryOffset]  = GetRatio(SPATIAL_ACCEPTED, SPATIAL_CANDIDATES);
+    mHistoryOffset                         = (mHistoryOffset + 1) % HISTORY_LENGTH;
+}
+
+float RestirStatistics::GetRatio(ECounter numerator, ECounter denominator) const
+{
+    return mLast[denominator] > 0 ? (float)mLast[numerator] / (float)mLast[denominator] : 0.f;
+}
+
+float RestirStatistics::GetPerUpdatedPixel(ECounter counter) const
+{
+    uint32_t updated = mLast[PIXELS] - mLast[CHECKERBOARD_REUSED];
+    return updated > 0 ? (float)mLast[counter] / (float)updated : 0.f;
+}
+
+void RestirStatistics::ImguiStatistics()
+{
+    ImGui::Text("Stats of frame %llu", (unsigned long long)mLastFrame);
+    ImGui::Text("Pixels: %u (invalid %u, checkerboard reused %u)", mLast[PIXELS], mLast[INVALID_PIXELS], mLast[CHECKERBOARD_REUSED]);
+
+    ImGui::PlotLines("Temporal accept", mTemporalAcceptHistory.data(), HISTORY_LENGTH, mHistoryOffset, nullptr, 0.f, 1.f, ImVec2(0, 40));
+    ImGui::Text("Temporal: accept %.3f | offscreen %.3f position %.3f normal %.3f discarded %.3f", GetRatio(TEMPORAL_ACCEPTED, TEMPORAL_CANDIDATES),
+                GetRatio(TEMPORAL_REJECT_OFFSCREEN, TEMPORAL_CANDIDATES), GetRatio(TEMPORAL_REJECT_POSITION, TEMPORAL_CANDIDATES),
+                GetRatio(TEMPORAL_REJECT_NORMAL, TEMPORAL_CANDIDATES), GetRatio(TEMPORAL_DISCARDED, TEMPORAL_CANDIDATES));
+
+    ImGui::PlotLines("Spatial accept", mSpatialAcceptHistory.data(), HISTORY_LENGTH, mHistoryOffset, nullptr, 0.f, 1.f, ImVec2(0, 40));
+    ImGui::Text("Spatial: accept %.3f | invalid %.3f position %.3f normal %.3f", GetRatio(SPATIAL_ACCEPTED, SPATIAL_CANDIDATES),
+                GetRatio(SPATIAL_REJECT_INVALID, SPATIAL_CANDIDATES), GetRatio(SPATIAL_REJECT_POSITION, SPATIAL_CANDIDATES),
+                GetRatio(SPATIAL_REJECT_NORMAL, SPATIAL_CANDIDATES));
+
+    ImGui::Text("History clamped: %u", mLast[HISTORY_CLAMPED]);
+    ImGui::Text("Per updated pixel: %.2f initial candidates, %.2f spatial neighbors", GetPerUpdatedPixel(INITIAL_CANDIDATES), GetPerUpdatedPixel(SPATIAL_CANDIDATES));
+    ImGui::Text("Invalid samples: %.3f  Shadow rays: %u (occluded %.3f)  BRDF candidate rays: %u", GetRatio(SAMPLES_INVALID, SAMPLES), mLast[SHADOW_RAYS],
+                GetRatio(SHADOW_RAYS_OCCLUDED, SHADOW_RAYS), mLast[BRDF_CANDIDATE_RAYS]);
+    if(mLast[CACHE_LOOKUPS] > 0 || mLast[CACHE_INSERTS] > 0)
+    {
+        ImGui::Text("Reservoir cache: hit rate %.3f of %u lookups, %u inserts (%u evictions), occupancy %.3f", GetRatio(CACHE_HITS, CACHE_LOOKUPS),
+                    mLast[CACHE_LOOKUPS], mLast[CACHE_INSERTS], mLast[CACHE_EVICTIONS], (float)mLast[CACHE_USED_ENTRIES] / (float)ReservoirCache::ENTRY_COUNT);
+    }
+    if(mLast[GI_RAYS] > 0)
+    {
+        ImGui::Text("ReSTIR GI: %u secondary rays, %u reused reservoirs (Jacobian rejected %.3f)", mLast[GI_RAYS], mLast[GI_REUSED],
+                    GetRatio(GI_REJECT_JACOBIAN, GI_REUSED));
+    }
+    if(mLast[TILES] > 0)
+    {
+        ImGui::Text("Tile light culling: %.1f candidate lights / tile, %u of %u tiles over capacity", GetRatio(TILE_CANDIDATE_LIGHTS, TILES),
+                    mLast[TILE_OVERFLOW], mLast[TILES]);
+    }
+
+    float histogram[M_HISTOGRAM_BINS];
+    for(uint32_t bin = 0; bin < M_HISTOGRAM_BINS; bin++)
+    {
+        histogram[bin] = (float)mLast[M_HISTOGRAM + bin];
+    }
+    ImGui::PlotHistogram("M (log2 bins)", histogram, M_HISTOGRAM_BINS, 0, nullptr, 0.f, FLT_MAX, ImVec2(0, 60));
+}
+
+void RestirStatistics::AppendBenchmarkColumns(BenchmarkCsv::Row& row) const
+{
+    row.emplace_back("stats frame", (double)mLastFrame);
+    row.emplace_back("temporal accept", GetRatio(TEMPORAL_ACCEPTED, TEMPORAL_CANDIDATES));
+    row.emplace_back("temporal reject offscreen", GetRatio(TEMPORAL_REJECT_OFFSCREEN, TEMPORAL_CANDIDATES));
+    row.emplace_back("temporal reject position", GetRatio(TEMPORAL_REJECT_POSITION, TEMPORAL_CANDIDATES));
+    row.emplace_back("temporal reject normal", GetRatio(TEMPORAL_REJECT_NORMAL, TEMPORAL_CANDIDATES));
+    row.emplace_back("temporal discarded", GetRatio(TEMPORAL_DISCARDED, TEMPORAL_CANDIDATES));
+    row.emplace_back("spatial accept", GetRatio(SPATIAL_ACCEPTED, SPATIAL_CANDIDATES));
+    row.emplace_back("spatial reject invalid", GetRatio(SPATIAL_REJECT_INVALID, SPATIAL_CANDIDATES));
+    row.emplace_back("spatial reject position", GetRatio(SPATIAL_REJECT_POSITION, SPATIAL_CANDIDATES));
+    row.emplace_back("spatial reject normal", GetRatio(SPATIAL_REJECT_NORMAL, SPATIAL_CANDIDATES));
+    row.emplace_back("history clamped", mLast[HISTORY_CLAMPED]);
+    row.emplace_back("initial candidates per pixel", GetPerUpdatedPixel(INITIAL_CANDIDATES));
+    row.emplace_back("spatial neighbors per pixel", GetPerUpdatedPixel(SPATIAL_CANDIDATES));
+    row.emplace_back("invalid samples", GetRatio(SAMPLES_INVALID, SAMPLES));
+    row.emplace_back("shadow rays", mLast[SHADOW_RAYS]);
+    row.emplace_back("shadow rays occluded", GetRatio(SHADOW_RAYS_OCCLUDED, SHADOW_RAYS));
+    row.emplace_back("brdf candidate rays", mLast[BRDF_CANDIDATE_RAYS]);
+    row.emplace_back("gi rays", mLast[GI_RAYS]);
+    row.emplace_back("gi reject jacobian", GetRatio(GI_REJECT_JACOBIAN, GI_REUSED));
+    row.emplace_back("tile candidate lights", GetRatio(TILE_CANDIDATE_LIGHTS, TILES));
+    row.emplace_back("tile overflow", mLast[TILE_OVERFLOW]);
+    row.emplace_back("cache hit rate", GetRatio(CACHE_HITS, CACHE_LOOKUPS));
+    row.emplace_back("cache inserts", mLast[CACHE_INSERTS]);
+    row.emplace_back("cache evictions", mLast[CACHE_EVICTIONS]);
+    row.emplace_back("cache occupancy", (float)mLast[CACHE_USED_ENTRIES] / (float)ReservoirCache::ENTRY_COUNT);
+    for(uint32_t bin = 0; bin < M_HISTOGRAM_BINS; bin++)
+    {
+        row.emplace_back("M bin " + std::to_string(bin), mLast[M_HISTOGRAM + bin]);
+    }
+}
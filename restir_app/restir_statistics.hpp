@@ -0,0 +1,98 @@
+#pragma once
+#include "benchmark_csv.hpp"
+#include <array>
+#include <foray_api.hpp>
+
+/// @brief Optional ReSTIR statistics (restirStats.glsl), compiled into the app and the shaders with the RESTIR_STATS CMake option. The shaders add into a device buffer that is cleared at the start of
+/// every frame and copied into a host visible slot at its end. A slot is read back without waiting when it is reused
+/// STATS_SLOT_COUNT frames later, the frame number stamped after the counters tells whether the copy has completed.
+class RestirStatistics
+{
+  public:
+    /// @brief Mirrors the STAT_ defines in restirStats.glsl
+    enum ECounter : uint32_t
+    {
+        PIXELS = 0,
+        INVALID_PIXELS,
+        CHECKERBOARD_REUSED,
+        TEMPORAL_CANDIDATES,
+        TEMPORAL_ACCEPTED,
+        TEMPORAL_REJECT_OFFSCREEN,
+        TEMPORAL_REJECT_POSITION,
+        TEMPORAL_REJECT_NORMAL,
+        TEMPORAL_DISCARDED,
+        HISTORY_CLAMPED,
+        SPATIAL_CANDIDATES,
+        SPATIAL_ACCEPTED,
+        SPATIAL_REJECT_INVALID,
+        SPATIAL_REJECT_POSITION,
+        SPATIAL_REJECT_NORMAL,
+        SAMPLES,
+        SAMPLES_INVALID,
+        SHADOW_RAYS,
+        BRDF_CANDIDATE_RAYS,
+        GI_RAYS,
+        SHADOW_RAYS_OCCLUDED,
+        TILES,
+        TILE_CANDIDATE_LIGHTS,
+        TILE_OVERFLOW,
+        INITIAL_CANDIDATES,
+        CACHE_LOOKUPS,
+        CACHE_HITS,
+        CACHE_INSERTS,
+        CACHE_EVICTIONS,
+        CACHE_USED_ENTRIES,
+        GI_REUSED,
+        GI_REJECT_JACOBIAN,
+        M_HISTOGRAM,
+    };
+    static constexpr uint32_t M_HISTOGRAM_BINS = 16;
+    static constexpr uint32_t COUNTER_COUNT    = M_HISTOGRAM + M_HISTOGRAM_BINS;
+
+    void Create(foray::core::Context* context);
+    void Destroy();
+    inline bool Exists() const { return mCounters.Exists(); }
+
+    /// @brief Bound at set 0 binding 24 of the raygen and compute spatial reuse descriptor sets
+    inline foray::core::ManagedBuffer& GetCounterBuffer() { return mCounters; }
+
+    /// @brief Reads back the slot of this frame and clears the counters. Record before the first ReSTIR pass.
+    void CmdBeginFrame(VkCommandBuffer cmdBuffer, uint64_t frameNumber);
+    /// @brief Copies the counters into the slot of this frame. Record after the last ReSTIR pass.
+    void CmdEndFrame(VkCommandBuffer cmdBuffer);
+
+    /// @brief numerator / denominator of the most recently read back frame, 0 if the denominator is 0
+    float GetRatio(ECounter numerator, ECounter denominator) const;
+    /// @brief counter / pixels with a full ReSTIR update (not reused by the checkerboard) of the most recently read back frame
+    float GetPerUpdatedPixel(ECounter counter) const;
+
+    /// @brief Rates, rejection reasons and M histogram of the last read back frame
+    void ImguiStatistics();
+    void AppendBenchmarkColumns(BenchmarkCsv::Row& row) const;
+
+  protected:
+    static constexpr uint32_t     STATS_SLOT_COUNT = 4;
+    static constexpr uint32_t     HISTORY_LENGTH   = 120;
+    static constexpr VkDeviceSize COUNTERS_SIZE    = COUNTER_COUNT * sizeof(uint32_t);
+    /// @brief Counters followed by the 64 bit frame stamp
+    static constexpr VkDeviceSize SLOT_SIZE = COUNTERS_SIZE + sizeof(uint64_t);
+
+    void ReadbackSlot(uint32_t slot);
+
+    foray::core::Context*      mContext = nullptr;
+    foray::core::ManagedBuffer mCounters;
+    foray::core::ManagedBuffer mReadback;
+    const uint8_t*             mReadbackMapped = nullptr;
+
+    uint64_t mFrameNumber = 0;
+    uint64_t mSlotFrame[STATS_SLOT_COUNT]{};
+    bool     mSlotWritten[STATS_SLOT_COUNT]{};
+
+    std::array<uint32_t, COUNTER_COUNT> mLast{};
+    uint64_t                            mLastFrame = 0;
+
+    /// @brief Accept rates of the last HISTORY_LENGTH read back frames for the ImGui plots
+    std::array<float, HISTORY_LENGTH> mTemporalAcceptHistory{};
+    std::array<float, HISTORY_LENGTH> mSpatialAcceptHistory{};
+    uint32_t                          mHistoryOffset = 0;
+};
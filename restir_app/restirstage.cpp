@@ -1,8 +1,14 @@
 #include "restirstage.hpp"
+#include "host_trace.hpp"
 #include "restir_app.hpp"
 #include <core/foray_shadermanager.hpp>
 #include <foray_api.hpp>
 #include <scene/globalcomponents/foray_cameramanager.hpp>
+#include <scene/globalcomponents/foray_materialmanager.hpp>
+#include <scene/globalcomponents/foray_texturemanager.hpp>
+#include <scene/globalcomponents/foray_tlasmanager.hpp>
+#include <cmath>
+#include <cstddef>
 #include <imgui/imgui.h>
 
 // only testwise
@@ -11,6 +17,20 @@
 
 #define RTSTAGEFLAGS VkShaderStageFlagBits::VK_SHADER_STAGE_RAYGEN_BIT_KHR | VkShaderStageFlagBits::VK_SHADER_STAGE_MISS_BIT_KHR | VkShaderStageFlagBits::VK_SHADER_STAGE_ANY_HIT_BIT_KHR
 
+namespace {
+    /// @brief subgroupAdd / subgroupElect in the ray generation and compute stages, used to reduce the statistics and adaptive budget sums
+    bool lSubgroupReduceSupported(foray::core::Context* context)
+    {
+        VkPhysicalDeviceSubgroupProperties subgroupProperties{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES};
+        VkPhysicalDeviceProperties2        properties{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, .pNext = &subgroupProperties};
+        vkGetPhysicalDeviceProperties2(context->PhysicalDevice(), &properties);
+
+        const VkShaderStageFlags     stages     = VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_COMPUTE_BIT;
+        const VkSubgroupFeatureFlags operations = VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_ARITHMETIC_BIT;
+        return (subgroupProperties.supportedStages & stages) == stages && (subgroupProperties.supportedOperations & operations) == operations;
+    }
+}  // namespace
+
 namespace foray {
 #pragma region Init
     void RestirStage::Init(foray::core::Context*              context,
@@ -24,6 +44,16 @@ namespace foray {
         mRestirApp    = restirApp;
         mGBufferStage = gbufferStage;
         mImguiStageRef = imguiStage;
+#ifndef NDEBUG
+        // the extent is no multiple of the tile size, so the partial tiles at the right and bottom edge are covered
+        for(reservoir_layout::ELayout layout : {reservoir_layout::ELayout::Linear, reservoir_layout::ELayout::Tiled})
+        {
+            if(!reservoir_layout::CheckRoundTrip(VkExtent2D{1921, 1081}, layout))
+            {
+                foray::logger()->error("Reservoir layout {} does not map 1921x1081 pixels to distinct reservoirs", (uint32_t)layout);
+            }
+        }
+#endif
         GetGBufferImages();
         stages::DefaultRaytracingStageBase::Init(context, scene, envmap, noiseSource);
         mRngSeedPushCOffset = ~0U;
@@ -31,12 +61,51 @@ namespace foray {
 
     void RestirStage::ApiCustomObjectsCreate()
     {
+        TraceScope trace("RestirStage::ApiCustomObjectsCreate");
         mRestirConfigurationUbo.Create(mContext, "RestirConfigurationUbo");
 
         RestirConfiguration& restirConfig    = mRestirConfigurationUbo.GetData();
         restirConfig.ReservoirSize           = RESERVOIR_SIZE;
         restirConfig.InitialLightSampleCount = 32;  // number of samples to initally sample?
         restirConfig.ScreenSize              = glm::uvec2(mContext->GetSwapchainSize().width, mContext->GetSwapchainSize().height);
+        restirConfig.PrevScreenSize          = restirConfig.ScreenSize;
+        restirConfig.OutputSize              = restirConfig.ScreenSize;
+        mRenderExtent                        = mContext->GetSwapchainSize();
+
+        // spatial reuse parameters, shared by the raygen and the compute spatial reuse
+        restirConfig.SpatialNeighbors       = 10;
+        restirConfig.SpatialRadius          = 3.0f;
+        restirConfig.SpatialPosThreshold    = 0.5f;
+        restirConfig.SpatialNormalThreshold = 20.0f;
+
+        // temporal reprojection tolerances and history length
+        restirConfig.HistoryClamp            = 50;
+        restirConfig.TemporalPosThreshold    = 0.35f;
+        restirConfig.TemporalNormalThreshold = 0.05f;
+
+        restirConfig.ReferenceSamplesPerFrame = 16;
+        restirConfig.TileLightCulling         = 0;
+        restirConfig.BrdfCandidateCount       = 0;
+
+        restirConfig.AdaptiveBudget          = 0;
+        restirConfig.AdaptiveBudgetCap       = 1.0f;
+        restirConfig.AdaptiveBudgetMinWeight = 0.25f;
+        restirConfig.AdaptiveBudgetMaxWeight = 2.0f;
+
+        restirConfig.ReservoirCache         = 0;
+        restirConfig.ReservoirCacheCellSize = 0.25f;
+        restirConfig.ReservoirCacheMaxAge   = 120;
+
+        restirConfig.EnableGi           = 0;
+        restirConfig.GiSpatialNeighbors = 5;
+        restirConfig.GiSpatialRadius    = 10.0f;
+
+        mGBufferPacker.Create(mContext, mGBufferStage);
+        mTileLightCulling.Create(mContext);
+        mAdaptiveBudget.Create(mContext);
+        mReservoirCache.Create(mContext, sizeof(Reservoir));
+        mPassTimer.Create(mContext, {"GBuffer pack", "ReSTIR raygen", "Spatial reuse (compute)", "Upsample", "Tile light culling", "Reservoir cache update"});
+        mStatistics.Create(mContext);
     }
 
     void RestirStage::GetGBufferImages()
@@ -48,6 +117,7 @@ namespace foray {
 
     void RestirStage::CreateOutputImages()
     {
+        TraceScope trace("RestirStage::CreateOutputImages");
         foray::stages::DefaultRaytracingStageBase::CreateOutputImages();
 
         mHistoryImages[PreviousFrame::Albedo].Create(mContext, mGBufferImages[UsedGBufferImages::GBUFFER_ALBEDO]);
@@ -58,7 +128,7 @@ namespace foray {
 
         VkExtent2D   windowSize    = mContext->GetSwapchainSize();
         VkDeviceSize reservoirSize = sizeof(Reservoir);
-        VkDeviceSize bufferSize    = windowSize.width * windowSize.height * reservoirSize;
+        VkDeviceSize bufferSize    = reservoir_layout::ReservoirCount(windowSize) * reservoirSize;
         for(size_t i = 0; i < mReservoirBuffers.size(); i++)
         {
             if(mReservoirBuffers[i].Exists())
@@ -69,24 +139,116 @@ namespace foray {
             mReservoirBuffers[i].Create(mContext, VkBufferUsageFlagBits::VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, bufferSize, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0,
                                         std::string("RestirStorageBuffer#") + std::to_string(i));
         }
+
+        VkDeviceSize giBufferSize = reservoir_layout::ReservoirCount(windowSize) * sizeof(GiReservoir);
+        for(size_t i = 0; i < mGiReservoirBuffers.size(); i++)
+        {
+            if(mGiReservoirBuffers[i].Exists())
+            {
+                mGiReservoirBuffers[i].Destroy();
+            }
+
+            mGiReservoirBuffers[i].Create(mContext, VkBufferUsageFlagBits::VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, giBufferSize, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0,
+                                          std::string("RestirGiReservoirs#") + std::to_string(i));
+        }
+
+        if(mTemporalReservoirBuffer.Exists())
+        {
+            mTemporalReservoirBuffer.Destroy();
+        }
+        mTemporalReservoirBuffer.Create(mContext, VkBufferUsageFlagBits::VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, bufferSize, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0,
+                                        "RestirTemporalReservoirs");
+
+        if(mReferenceAccumulationBuffer.Exists())
+        {
+            mReferenceAccumulationBuffer.Destroy();
+        }
+        VkDeviceSize referenceSize = (VkDeviceSize)windowSize.width * windowSize.height * 2 * sizeof(glm::vec4);
+        mReferenceAccumulationBuffer.Create(mContext, VkBufferUsageFlagBits::VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, referenceSize, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0,
+                                            "RestirReferenceAccumulation");
+        mReferenceFrameCount = 0;
+    }
+
+    std::unordered_map<std::string, std::string> RestirStage::GetShaderDefinitions() const
+    {
+        std::unordered_map<std::string, std::string> definitions;
+#ifdef RESTIR_STATS
+        definitions["RESTIR_STATS"] = "1";
+#endif
+        if(lSubgroupReduceSupported(mContext))
+        {
+            definitions["SUBGROUP_REDUCE"] = "1";
+        }
+        TileLightCulling::AddShaderDefinitions(definitions);
+        AdaptiveBudget::AddShaderDefinitions(definitions);
+        ReservoirCache::AddShaderDefinitions(definitions);
+        return definitions;
     }
 
     void RestirStage::ApiCreateRtPipeline()
     {
-        // default shaders
-		foray::core::ShaderCompilerConfig options{.IncludeDirs = {FORAY_SHADER_DIR}};
+        TraceScope trace("RestirStage::ApiCreateRtPipeline");
+        {
+            TraceScope compileTrace("Compile raytracing shaders");
 
-        mShaderKeys.push_back(mRaygen.CompileFromSource(mContext, RAYGEN_FILE, options));
-        mShaderKeys.push_back(mAnyHit.CompileFromSource(mContext, ANYHIT_FILE, options));
-        mShaderKeys.push_back(mVisiMiss.CompileFromSource(mContext, VISI_MISS_FILE, options));
-        mShaderKeys.push_back(mVisiAnyHit.CompileFromSource(mContext, VISI_ANYHIT_FILE, options));
+            // default shaders
+            foray::core::ShaderCompilerConfig options{.IncludeDirs = {FORAY_SHADER_DIR}, .Definitions = GetShaderDefinitions()};
+
+            mShaderKeys.push_back(mRaygen.CompileFromSource(mContext, RAYGEN_FILE, options));
+            mShaderKeys.push_back(mAnyHit.CompileFromSource(mContext, ANYHIT_FILE, options));
+            mShaderKeys.push_back(mVisiMiss.CompileFromSource(mContext, VISI_MISS_FILE, options));
+            mShaderKeys.push_back(mVisiAnyHit.CompileFromSource(mContext, VISI_ANYHIT_FILE, options));
+            mShaderKeys.push_back(mBrdfCandidateHit.CompileFromSource(mContext, BRDF_CANDIDATE_HIT_FILE, options));
+            mShaderKeys.push_back(mBrdfCandidateMiss.CompileFromSource(mContext, BRDF_CANDIDATE_MISS_FILE, options));
+            mShaderKeys.push_back(mGiBounceHit.CompileFromSource(mContext, GI_BOUNCE_HIT_FILE, options));
+            mShaderKeys.push_back(mGiBounceMiss.CompileFromSource(mContext, GI_BOUNCE_MISS_FILE, options));
+        }
 
         // visibility test
         mPipeline.GetRaygenSbt().SetGroup(0, &mRaygen);
         mPipeline.GetMissSbt().SetGroup(0, &mVisiMiss);
         mPipeline.GetHitSbt().SetGroup(0, &mVisiAnyHit, &mAnyHit, nullptr);
 
-        mPipeline.Build(mContext, mPipelineLayout);
+        // BRDF sampled candidates, sbt offset and miss index 1
+        mPipeline.GetMissSbt().SetGroup(1, &mBrdfCandidateMiss);
+        mPipeline.GetHitSbt().SetGroup(1, &mBrdfCandidateHit, &mAnyHit, nullptr);
+
+        // ReSTIR GI secondary rays, sbt offset and miss index 2
+        mPipeline.GetMissSbt().SetGroup(2, &mGiBounceMiss);
+        mPipeline.GetHitSbt().SetGroup(2, &mGiBounceHit, &mAnyHit, nullptr);
+
+        {
+            TraceScope buildTrace("Build raytracing pipeline");
+            mPipeline.Build(mContext, mPipelineLayout);
+        }
+
+        // compute spatial reuse shares the reservoir swap sets with the raytracing pipeline. Its tile staging exceeds the 16 KiB of
+        // shared memory Vulkan guarantees, devices with less keep the spatial reuse in raygen.
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(mContext->PhysicalDevice(), &properties);
+        mSpatialReuseComputeSupported = SPATIAL_REUSE_SHARED_BYTES <= properties.limits.maxComputeSharedMemorySize;
+        if(mSpatialReuseComputeSupported)
+        {
+            mSpatialReusePass.Create(mContext, SPATIAL_REUSE_FILE,
+                                     {mSpatialReuseDescriptorSet.GetDescriptorSetLayout(), mDescriptorSetsReservoirSwap[0].GetDescriptorSetLayout(),
+                                      mSpatialReuseTlasSet.GetDescriptorSetLayout()},
+                                     sizeof(uint32_t), "SpatialReuse", GetShaderDefinitions());
+            mShaderKeys.push_back(mSpatialReusePass.GetShaderKey());
+        }
+        else
+        {
+            foray::logger()->warn("Compute spatial reuse needs {} bytes of shared memory, the device has {}. Using the raygen spatial reuse.",
+                                  SPATIAL_REUSE_SHARED_BYTES, properties.limits.maxComputeSharedMemorySize);
+        }
+
+        // the culling pass reads the same bindings as the compute spatial reuse
+        mTileLightCulling.CreatePipeline({mSpatialReuseDescriptorSet.GetDescriptorSetLayout()}, GetShaderDefinitions());
+        mShaderKeys.push_back(mTileLightCulling.GetShaderKey());
+
+        // the cache update reads the final reservoirs from the swap set like the compute spatial reuse
+        mReservoirCache.CreatePipeline({mSpatialReuseDescriptorSet.GetDescriptorSetLayout(), mDescriptorSetsReservoirSwap[0].GetDescriptorSetLayout()},
+                                       GetShaderDefinitions());
+        mShaderKeys.push_back(mReservoirCache.GetShaderKey());
 
         //mShaderSourcePaths.insert(mShaderSourcePaths.begin(), {mRaygen.Path, mDefault_AnyHit.Path, mRtShader_VisibilityTestHit.Path, mRtShader_VisibilityTestHit.Path});
     }
@@ -101,6 +263,7 @@ namespace foray {
 
     void RestirStage::CreateOrUpdateDescriptors()
     {
+        TraceScope trace("RestirStage::CreateOrUpdateDescriptors");
         for(int32_t i = 0; i < mGBufferImages.size(); i++)
         {
             if(mGBufferImagesSampled[i].GetSampler() == nullptr)
@@ -116,13 +279,21 @@ namespace foray {
             }
         }
 
+        const VkShaderStageFlags reservoirStages = VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_COMPUTE_BIT;
+
         // swap set 0
-        mDescriptorSetsReservoirSwap[0].SetDescriptorAt(0, mReservoirBuffers[0], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR);
-        mDescriptorSetsReservoirSwap[0].SetDescriptorAt(1, mReservoirBuffers[1], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR);
+        mDescriptorSetsReservoirSwap[0].SetDescriptorAt(0, mReservoirBuffers[0], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, reservoirStages);
+        mDescriptorSetsReservoirSwap[0].SetDescriptorAt(1, mReservoirBuffers[1], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, reservoirStages);
+        mDescriptorSetsReservoirSwap[0].SetDescriptorAt(2, mTemporalReservoirBuffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, reservoirStages);
+        mDescriptorSetsReservoirSwap[0].SetDescriptorAt(3, mGiReservoirBuffers[0], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, reservoirStages);
+        mDescriptorSetsReservoirSwap[0].SetDescriptorAt(4, mGiReservoirBuffers[1], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, reservoirStages);
 
         // swap set 1
-        mDescriptorSetsReservoirSwap[1].SetDescriptorAt(0, mReservoirBuffers[1], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR);
-        mDescriptorSetsReservoirSwap[1].SetDescriptorAt(1, mReservoirBuffers[0], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR);
+        mDescriptorSetsReservoirSwap[1].SetDescriptorAt(0, mReservoirBuffers[1], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, reservoirStages);
+        mDescriptorSetsReservoirSwap[1].SetDescriptorAt(1, mReservoirBuffers[0], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, reservoirStages);
+        mDescriptorSetsReservoirSwap[1].SetDescriptorAt(2, mTemporalReservoirBuffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, reservoirStages);
+        mDescriptorSetsReservoirSwap[1].SetDescriptorAt(3, mGiReservoirBuffers[1], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, reservoirStages);
+        mDescriptorSetsReservoirSwap[1].SetDescriptorAt(4, mGiReservoirBuffers[0], VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, reservoirStages);
 
         // create reservoir swap descriptor sets
         for(size_t i = 0; i < 2; i++)
@@ -162,18 +333,114 @@ namespace foray {
         mDescriptorSet.SetDescriptorAt(15, historyImagesSampled, VkImageLayout::VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
                                        VK_SHADER_STAGE_RAYGEN_BIT_KHR);
 
+        // =======================================================================================
+        // Binding packed gbuffer (current frame + previous frame geometry)
+        mDescriptorSet.SetDescriptorAt(17, mGBufferPacker.GetSampledPackedImages(), VkImageLayout::VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                       VK_SHADER_STAGE_RAYGEN_BIT_KHR);
+        mDescriptorSet.SetDescriptorAt(18, std::vector<const core::CombinedImageSampler*>{mGBufferPacker.GetSampledGeometryHistory()}, VkImageLayout::VK_IMAGE_LAYOUT_GENERAL,
+                                       VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_RAYGEN_BIT_KHR);
+
         // create base descriptor sets
         mDescriptorSet.SetDescriptorAt(11, &mRestirConfigurationUbo.GetUboBuffer().GetDeviceBuffer(), VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR);
         mDescriptorSet.SetDescriptorAt(16, mRestirApp->mTriangleLightsBuffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR);
+        mDescriptorSet.SetDescriptorAt(23, mReferenceAccumulationBuffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR);
+        mDescriptorSet.SetDescriptorAt(24, mStatistics.GetCounterBuffer(), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR);
+        mDescriptorSet.SetDescriptorAt(25, mTileLightCulling.GetTileLightCounts(), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR);
+        mDescriptorSet.SetDescriptorAt(26, mTileLightCulling.GetTileLightIndices(), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR);
+        mDescriptorSet.SetDescriptorAt(27, mRestirApp->mEmissiveTriangleLookup.GetBuffer(), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR);
+        mDescriptorSet.SetDescriptorAt(28, mAdaptiveBudget.GetBuffer(), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR);
+        mDescriptorSet.SetDescriptorAt(29, mReservoirCache.GetBuffer(), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_RAYGEN_BIT_KHR);
+
+        if(!mUpsampler.Exists())
+        {
+            mUpsampler.Create(mContext, mGBufferStage, GetImageOutput(OutputName), &mRestirConfigurationUbo.GetUboBuffer().GetDeviceBuffer());
+        }
+        CreateOrUpdateLowResOutputDescriptor(mDescriptorSet, VK_SHADER_STAGE_RAYGEN_BIT_KHR);
         stages::DefaultRaytracingStageBase::CreateOrUpdateDescriptors();
+
+        CreateOrUpdateSpatialReuseDescriptors();
+    }
+
+    void RestirStage::CreateOrUpdateLowResOutputDescriptor(core::DescriptorSet& descriptorSet, VkShaderStageFlags stages)
+    {
+        std::vector<VkDescriptorImageInfo> lowResInfos{VkDescriptorImageInfo{.imageView = mUpsampler.GetLowResImage()->GetImageView(), .imageLayout = VK_IMAGE_LAYOUT_GENERAL}};
+        descriptorSet.SetDescriptorAt(22, lowResInfos, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, stages);
+    }
+
+    void RestirStage::CreateOrUpdateSpatialReuseDescriptors()
+    {
+        TraceScope trace("RestirStage::CreateOrUpdateSpatialReuseDescriptors");
+        // same binding numbers as the raygen shader, so the restir glsl includes can be shared
+        std::vector<const core::CombinedImageSampler*> gbufferImagesSampled;
+        for(core::CombinedImageSampler& image : mGBufferImagesSampled)
+        {
+            gbufferImagesSampled.push_back(&image);
+        }
+        std::vector<const core::CombinedImageSampler*> historyImagesSampled;
+        for(core::CombinedImageSampler& image : mHistoryImagesSampled)
+        {
+            historyImagesSampled.push_back(&image);
+        }
+
+        mSpatialReuseDescriptorSet.SetDescriptorAt(11, &mRestirConfigurationUbo.GetUboBuffer().GetDeviceBuffer(), VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+        mSpatialReuseDescriptorSet.SetDescriptorAt(14, gbufferImagesSampled, VkImageLayout::VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                   VK_SHADER_STAGE_COMPUTE_BIT);
+        mSpatialReuseDescriptorSet.SetDescriptorAt(15, historyImagesSampled, VkImageLayout::VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                   VK_SHADER_STAGE_COMPUTE_BIT);
+        mSpatialReuseDescriptorSet.SetDescriptorAt(16, mRestirApp->mTriangleLightsBuffer, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+        mSpatialReuseDescriptorSet.SetDescriptorAt(17, mGBufferPacker.GetSampledPackedImages(), VkImageLayout::VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                   VK_SHADER_STAGE_COMPUTE_BIT);
+        mSpatialReuseDescriptorSet.SetDescriptorAt(18, std::vector<const core::CombinedImageSampler*>{mGBufferPacker.GetSampledGeometryHistory()},
+                                                   VkImageLayout::VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT);
+
+        scene::Scene* scene = mRestirApp->mScene.get();
+        mSpatialReuseDescriptorSet.SetDescriptorAt(19, scene->GetComponent<scene::gcomp::MaterialManager>()->GetVkDescriptorInfo(), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                                   VK_SHADER_STAGE_COMPUTE_BIT);
+        mSpatialReuseDescriptorSet.SetDescriptorAt(20, scene->GetComponent<scene::gcomp::TextureManager>()->GetDescriptorInfos(), VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                   VK_SHADER_STAGE_COMPUTE_BIT);
+
+        std::vector<VkDescriptorImageInfo> outputInfos{VkDescriptorImageInfo{.imageView = GetImageOutput(OutputName)->GetImageView(), .imageLayout = VK_IMAGE_LAYOUT_GENERAL}};
+        mSpatialReuseDescriptorSet.SetDescriptorAt(21, outputInfos, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT);
+        mSpatialReuseDescriptorSet.SetDescriptorAt(24, mStatistics.GetCounterBuffer(), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+        mSpatialReuseDescriptorSet.SetDescriptorAt(25, mTileLightCulling.GetTileLightCounts(), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+        mSpatialReuseDescriptorSet.SetDescriptorAt(26, mTileLightCulling.GetTileLightIndices(), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+        mSpatialReuseDescriptorSet.SetDescriptorAt(28, mAdaptiveBudget.GetBuffer(), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+        mSpatialReuseDescriptorSet.SetDescriptorAt(29, mReservoirCache.GetBuffer(), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+        CreateOrUpdateLowResOutputDescriptor(mSpatialReuseDescriptorSet, VK_SHADER_STAGE_COMPUTE_BIT);
+
+        if(mSpatialReuseDescriptorSet.Exists())
+        {
+            mSpatialReuseDescriptorSet.Update();
+        }
+        else
+        {
+            mSpatialReuseDescriptorSet.Create(mContext, "DescriptorSet_SpatialReuse");
+        }
+
+        VkAccelerationStructureKHR tlas = scene->GetComponent<scene::gcomp::TlasManager>()->GetTlas().GetAccelerationStructure();
+        if(mSpatialReuseTlasSet.Exists())
+        {
+            mSpatialReuseTlasSet.Update(tlas);
+        }
+        else
+        {
+            mSpatialReuseTlasSet.Create(mContext, tlas);
+        }
     }
 
     void RestirStage::Resize(const VkExtent2D& extent)
     {
         RestirConfiguration& restirConfig = mRestirConfigurationUbo.GetData();
         restirConfig.ScreenSize           = glm::uvec2(extent.width, extent.height);
+        restirConfig.PrevScreenSize       = restirConfig.ScreenSize;
+        restirConfig.OutputSize           = restirConfig.ScreenSize;
+        mRenderExtent                     = extent;
         DestroyOutputImages();
         CreateOutputImages();
+        mGBufferPacker.Resize();
+        mTileLightCulling.Resize();
+        mAdaptiveBudget.Resize();
+        mUpsampler.Resize(GetImageOutput(OutputName));
         CreateOrUpdateDescriptors();
     }
 
@@ -186,8 +453,83 @@ namespace foray {
     {
         mImguiStageRef->AddWindowDraw([this]() {
             ImGui::Begin("ReSTIR Config");
+            ImGui::SliderInt("Initial light samples", (int*)(&mRestirConfigurationUbo.GetData().InitialLightSampleCount), 1, 64);
+            ImGui::SliderInt("of which BRDF sampled", (int*)(&mRestirConfigurationUbo.GetData().BrdfCandidateCount), 0, 64);
             ImGui::Checkbox("Enable temporal", (bool*)(&mRestirConfigurationUbo.GetData().EnableTemporal));
             ImGui::Checkbox("Enable spatial", (bool*)(&mRestirConfigurationUbo.GetData().EnableSpatial));
+            ImGui::Checkbox("Packed GBuffer", (bool*)(&mRestirConfigurationUbo.GetData().PackedGBuffer));
+            ImGui::BeginDisabled(!mSpatialReuseComputeSupported);
+            ImGui::Checkbox("Spatial reuse in compute", (bool*)(&mRestirConfigurationUbo.GetData().SpatialReuseCompute));
+            ImGui::EndDisabled();
+            const char* layouts[] = {"Linear", "Tiled 8x8 (Morton)"};
+            ImGui::Combo("Reservoir layout", (int*)(&mRestirConfigurationUbo.GetData().ReservoirLayout), layouts, 2);
+            ImGui::Checkbox("Checkerboard (half rate updates)", (bool*)(&mRestirConfigurationUbo.GetData().Checkerboard));
+            ImGui::Checkbox("Tile light culling (16x16)", (bool*)(&mRestirConfigurationUbo.GetData().TileLightCulling));
+            ImGui::Checkbox("Adaptive per pixel budget", (bool*)(&mRestirConfigurationUbo.GetData().AdaptiveBudget));
+            if(mRestirConfigurationUbo.GetData().AdaptiveBudget)
+            {
+                RestirConfiguration& config = mRestirConfigurationUbo.GetData();
+                ImGui::SliderFloat("Budget cap (x fixed budget)", &config.AdaptiveBudgetCap, 0.1f, 2.f);
+                ImGui::SliderFloat("Weight converged", &config.AdaptiveBudgetMinWeight, 0.f, 1.f);
+                ImGui::SliderFloat("Weight disoccluded", &config.AdaptiveBudgetMaxWeight, 1.f, 8.f);
+            }
+            ImGui::Checkbox("World space reservoir cache", (bool*)(&mRestirConfigurationUbo.GetData().ReservoirCache));
+            if(mRestirConfigurationUbo.GetData().ReservoirCache)
+            {
+                RestirConfiguration& config = mRestirConfigurationUbo.GetData();
+                // entries of other cell sizes are never found again
+                if(ImGui::SliderFloat("Cache cell size", &config.ReservoirCacheCellSize, 0.01f, 2.f))
+                {
+                    mReservoirCache.Clear();
+                }
+                ImGui::SliderInt("Cache max age (frames)", (int*)(&config.ReservoirCacheMaxAge), 1, 600);
+                if(ImGui::Button("Clear cache"))
+                {
+                    mReservoirCache.Clear();
+                }
+            }
+            ImGui::Checkbox("ReSTIR GI (one bounce)", (bool*)(&mRestirConfigurationUbo.GetData().EnableGi));
+            if(mRestirConfigurationUbo.GetData().EnableGi)
+            {
+                RestirConfiguration& config = mRestirConfigurationUbo.GetData();
+                ImGui::SliderInt("GI spatial neighbors", (int*)(&config.GiSpatialNeighbors), 0, 16);
+                ImGui::SliderFloat("GI spatial radius", &config.GiSpatialRadius, 1.f, 50.f);
+            }
+            if(ImGui::CollapsingHeader("Reuse parameters"))
+            {
+                RestirConfiguration& config = mRestirConfigurationUbo.GetData();
+                ImGui::SliderInt("History clamp (M)", (int*)(&config.HistoryClamp), 1, 500);
+                ImGui::SliderFloat("Temporal position threshold", &config.TemporalPosThreshold, 0.01f, 2.f);
+                ImGui::SliderFloat("Temporal normal threshold", &config.TemporalNormalThreshold, 0.001f, 1.f);
+                ImGui::SliderInt("Spatial neighbors", (int*)(&config.SpatialNeighbors), 0, 32);
+                ImGui::SliderFloat("Spatial radius", &config.SpatialRadius, 1.f, 30.f);
+                ImGui::SliderFloat("Spatial position threshold", &config.SpatialPosThreshold, 0.01f, 2.f);
+                ImGui::SliderFloat("Spatial normal threshold (deg)", &config.SpatialNormalThreshold, 1.f, 90.f);
+            }
+#ifdef RESTIR_STATS
+            if(ImGui::CollapsingHeader("Statistics"))
+            {
+                mStatistics.ImguiStatistics();
+            }
+#endif
+            ImGui::Separator();
+            if(ImGui::Checkbox("Reference mode (accumulate)", (bool*)(&mRestirConfigurationUbo.GetData().ReferenceMode)))
+            {
+                mReferenceFrameCount = 0;
+            }
+            if(mRestirConfigurationUbo.GetData().ReferenceMode)
+            {
+                ImGui::SliderInt("Reference samples / frame", (int*)(&mRestirConfigurationUbo.GetData().ReferenceSamplesPerFrame), 1, 128);
+                ImGui::Text("Accumulated frames: %u", mReferenceFrameCount);
+                if(ImGui::Button("Restart accumulation"))
+                {
+                    mReferenceFrameCount = 0;
+                }
+            }
+            ImGui::Separator();
+            mResolutionController.ImguiControls();
+            ImGui::Separator();
+            mPassTimer.ImguiPassTimes();
             ImGui::End();
         });
     }
@@ -229,16 +571,92 @@ namespace foray {
             imageMemoryBarriers.push_back(renderInfo.GetImageLayoutCache().MakeBarrier(image, barrier));
         }
 
-        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VkPipelineStageFlagBits::VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, 0, 0, nullptr, 0, nullptr,
-                             imageMemoryBarriers.size(), imageMemoryBarriers.data());
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                             VkPipelineStageFlagBits::VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VkPipelineStageFlagBits::VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0,
+                             nullptr, imageMemoryBarriers.size(), imageMemoryBarriers.data());
+
+        uint32_t frameNumber = renderInfo.GetFrameNumber();
+        mPassTimer.CmdBeginFrame(commandBuffer, frameNumber);
+#ifdef RESTIR_STATS
+        mStatistics.CmdBeginFrame(commandBuffer, frameNumber);
+#endif
+
+        RestirConfiguration& restirConfig = mRestirConfigurationUbo.GetData();
+        // presets and the sweep may request it on devices without the shared memory for it
+        restirConfig.SpatialReuseCompute = restirConfig.SpatialReuseCompute && mSpatialReuseComputeSupported;
+
+        // pick the render extent from the GPU time of the last read back frame, the reference is always accumulated at output resolution
+        VkExtent2D outputExtent = mContext->GetSwapchainSize();
+        if(restirConfig.ReferenceMode)
+        {
+            mRenderExtent = outputExtent;
+        }
+        else
+        {
+            // toggled off passes read back as 0 ms, so the controller follows pass toggles after the readback latency
+            mResolutionController.Update(GetLastGpuMs(), mPassTimer.PassSetChanged());
+            mRenderExtent = mResolutionController.GetRenderExtent(outputExtent);
+        }
+        restirConfig.PrevScreenSize = restirConfig.ScreenSize;
+        restirConfig.ScreenSize     = glm::uvec2(mRenderExtent.width, mRenderExtent.height);
+        restirConfig.OutputSize     = glm::uvec2(outputExtent.width, outputExtent.height);
+        restirConfig.UpscaleOutput  = mRenderExtent.width != outputExtent.width || mRenderExtent.height != outputExtent.height;
+        if(restirConfig.UpscaleOutput)
+        {
+            mUpsampler.CmdPrepareLowRes(commandBuffer, renderInfo,
+                                        restirConfig.SpatialReuseCompute ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR);
+        }
+
+        if(restirConfig.PackedGBuffer)
+        {
+            mPassTimer.CmdBeginPass(commandBuffer, PASS_GBUFFER_PACK);
+            mGBufferPacker.CmdPack(commandBuffer, renderInfo);
+            mPassTimer.CmdEndPass(commandBuffer, PASS_GBUFFER_PACK, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        }
 
-        uint32_t             frameNumber           = renderInfo.GetFrameNumber();
-        RestirConfiguration& restirConfig          = mRestirConfigurationUbo.GetData();
-        restirConfig.Frame                         = frameNumber;
-        restirConfig.PrevFrameProjectionViewMatrix = mRestirApp->mScene->GetComponent<scene::gcomp::CameraManager>()->GetUbo().GetData().PreviousProjectionViewMatrix;
+        const auto& cameraUbo = mRestirApp->mScene->GetComponent<scene::gcomp::CameraManager>()->GetUbo().GetData();
+
+        restirConfig.Frame                                = frameNumber;
+        restirConfig.CameraPos                            = cameraUbo.InverseViewMatrix[3];
+        restirConfig.PrevFrameProjectionViewMatrix        = cameraUbo.PreviousProjectionViewMatrix;
+        restirConfig.PrevFrameInverseProjectionViewMatrix = glm::inverse(cameraUbo.PreviousProjectionViewMatrix);
+        restirConfig.InverseProjectionViewMatrix          = glm::inverse(cameraUbo.ProjectionViewMatrix);
+
+        // the reference only converges for a fixed camera
+        if(restirConfig.ReferenceMode && cameraUbo.ProjectionViewMatrix != mReferenceProjectionView)
+        {
+            mReferenceFrameCount = 0;
+        }
+        mReferenceProjectionView         = cameraUbo.ProjectionViewMatrix;
+        restirConfig.ReferenceFrameCount = mReferenceFrameCount;
+        if(restirConfig.ReferenceMode)
+        {
+            mReferenceFrameCount++;
+        }
         mRestirConfigurationUbo.UpdateTo(frameNumber);
         mRestirConfigurationUbo.CmdCopyToDevice(frameNumber, commandBuffer);
-        mRestirConfigurationUbo.CmdPrepareForRead(commandBuffer, VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR, VK_ACCESS_SHADER_READ_BIT);
+        mRestirConfigurationUbo.CmdPrepareForRead(commandBuffer, VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+        // the weight sums of the last frame only normalize this one if it ran with the adaptive budget too
+        bool adaptiveBudget = restirConfig.AdaptiveBudget && !restirConfig.ReferenceMode;
+        if(adaptiveBudget)
+        {
+            mAdaptiveBudget.CmdBeginFrame(commandBuffer, frameNumber, !mPrevFrameAdaptiveBudget);
+        }
+        mPrevFrameAdaptiveBudget = adaptiveBudget;
+
+        if(restirConfig.ReservoirCache)
+        {
+            mReservoirCache.CmdBeginFrame(commandBuffer);
+        }
+
+        // the reference samples all lights, it is not culled
+        if(restirConfig.TileLightCulling && !restirConfig.ReferenceMode)
+        {
+            mPassTimer.CmdBeginPass(commandBuffer, PASS_TILE_CULLING);
+            mTileLightCulling.CmdCull(commandBuffer, {mSpatialReuseDescriptorSet.GetDescriptorSet()}, mRenderExtent);
+            mPassTimer.CmdEndPass(commandBuffer, PASS_TILE_CULLING, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        }
 
         DefaultRaytracingStageBase::RecordFramePrepare(commandBuffer, renderInfo);
     }
@@ -258,13 +676,55 @@ namespace foray {
     void RestirStage::RecordFrameTraceRays(VkCommandBuffer commandBuffer, base::FrameRenderInfo& renderInfo)
     {
         mPushConstantRestir.RngSeed                   = renderInfo.GetFrameNumber();
-        mPushConstantRestir.DiscardPrevFrameReservoir = false;
+        // previous reservoirs are unreadable after a layout switch, and are not written in reference mode. The GI reservoirs
+        // are only written while GI is enabled. Only the history of the active GBuffer mode is kept, so a mode switch
+        // has no previous surfaces to validate the reservoirs against.
+        const RestirConfiguration& restirConfig       = mRestirConfigurationUbo.GetData();
+        mPushConstantRestir.DiscardPrevFrameReservoir = restirConfig.ReservoirLayout != mPrevFrameReservoirLayout || mPrevFrameReference || mDiscardHistory
+                                                        || (restirConfig.EnableGi && !mPrevFrameGi) || (restirConfig.PackedGBuffer != 0) != mPrevFramePackedGBuffer;
+        mDiscardHistory                               = false;
+        mPrevFrameReservoirLayout                     = restirConfig.ReservoirLayout;
+        mPrevFrameReference                           = restirConfig.ReferenceMode != 0;
+        mPrevFrameGi                                  = restirConfig.EnableGi != 0;
+        mPrevFramePackedGBuffer                       = restirConfig.PackedGBuffer != 0;
 
         vkCmdPushConstants(commandBuffer, mPipelineLayout, RTSTAGEFLAGS, 0U, sizeof(mPushConstantRestir), &mPushConstantRestir);
 
+        mPassTimer.CmdBeginPass(commandBuffer, PASS_RAYGEN);
         stages::DefaultRaytracingStageBase::RecordFrameTraceRays(commandBuffer, renderInfo);
+        mPassTimer.CmdEndPass(commandBuffer, PASS_RAYGEN, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR);
+
+        if(restirConfig.SpatialReuseCompute && !restirConfig.ReferenceMode)
+        {
+            RecordSpatialReuse(commandBuffer, renderInfo);
+        }
+
+        if(restirConfig.ReservoirCache && !restirConfig.ReferenceMode)
+        {
+            uint32_t frameNumber = renderInfo.GetFrameNumber();
+            mPassTimer.CmdBeginPass(commandBuffer, PASS_CACHE_UPDATE);
+            mReservoirCache.CmdUpdate(commandBuffer, {mSpatialReuseDescriptorSet.GetDescriptorSet(), mDescriptorSetsReservoirSwap[frameNumber % 2].GetDescriptorSet()},
+                                      mRenderExtent);
+            mPassTimer.CmdEndPass(commandBuffer, PASS_CACHE_UPDATE, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        }
+
+        if(restirConfig.UpscaleOutput)
+        {
+            mPassTimer.CmdBeginPass(commandBuffer, PASS_UPSAMPLE);
+            mUpsampler.CmdUpsample(commandBuffer, renderInfo,
+                                   restirConfig.SpatialReuseCompute ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR);
+            mPassTimer.CmdEndPass(commandBuffer, PASS_UPSAMPLE, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        }
+#ifdef RESTIR_STATS
+        mStatistics.CmdEndFrame(commandBuffer);
+#endif
 
         // copy gbuffer to prev frame
+        if(restirConfig.PackedGBuffer)
+        {
+            mGBufferPacker.CmdCopyToHistory(commandBuffer, renderInfo);
+            return;
+        }
 
         std::vector<util::HistoryImage*> historyImages;
         historyImages.reserve(mHistoryImages.size());
@@ -276,16 +736,244 @@ namespace foray {
         util::HistoryImage::sMultiCopySourceToHistory(historyImages, commandBuffer, renderInfo);
     }
 
+    void RestirStage::RecordSpatialReuse(VkCommandBuffer commandBuffer, base::FrameRenderInfo& renderInfo)
+    {
+        // temporal reservoirs, gbuffer and packed gbuffer (written by raygen / earlier passes) are read in compute
+        VkMemoryBarrier readBarrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER, .srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT, .dstAccessMask = VK_ACCESS_SHADER_READ_BIT};
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &readBarrier, 0, nullptr, 0, nullptr);
+
+        core::ImageLayoutCache::Barrier outputBarrier;
+        outputBarrier.SrcAccessMask               = VK_ACCESS_SHADER_WRITE_BIT;
+        outputBarrier.DstAccessMask               = VK_ACCESS_SHADER_WRITE_BIT;
+        outputBarrier.NewLayout                   = VK_IMAGE_LAYOUT_GENERAL;
+        outputBarrier.SubresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        renderInfo.GetImageLayoutCache().CmdBarrier(commandBuffer, GetImageOutput(OutputName), outputBarrier, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR,
+                                                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+        uint32_t frameNumber = renderInfo.GetFrameNumber();
+        uint32_t rngSeed     = frameNumber;
+
+        mPassTimer.CmdBeginPass(commandBuffer, PASS_SPATIAL);
+        mSpatialReusePass.CmdBind(commandBuffer, {mSpatialReuseDescriptorSet.GetDescriptorSet(), mDescriptorSetsReservoirSwap[frameNumber % 2].GetDescriptorSet(),
+                                                  mSpatialReuseTlasSet.GetDescriptorSet()});
+        mSpatialReusePass.CmdPushConstants(commandBuffer, &rngSeed, sizeof(rngSeed));
+        mSpatialReusePass.CmdDispatch(commandBuffer, mRenderExtent);
+        mPassTimer.CmdEndPass(commandBuffer, PASS_SPATIAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+        // final reservoirs are read by next frames raygen
+        VkMemoryBarrier writeBarrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER, .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT, .dstAccessMask = VK_ACCESS_SHADER_READ_BIT};
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                             &writeBarrier, 0, nullptr, 0, nullptr);
+    }
+
+    void RestirStage::AppendBenchmarkColumns(BenchmarkCsv::Row& row)
+    {
+        for(uint32_t pass = 0; pass < mPassTimer.GetPassNames().size(); pass++)
+        {
+            row.emplace_back(mPassTimer.GetPassNames()[pass] + " ms", mPassTimer.GetLastPassMs(pass));
+        }
+        row.emplace_back("initial light samples", mRestirConfigurationUbo.GetData().InitialLightSampleCount);
+        row.emplace_back("brdf candidates", mRestirConfigurationUbo.GetData().BrdfCandidateCount);
+        row.emplace_back("adaptive budget", mRestirConfigurationUbo.GetData().AdaptiveBudget);
+        row.emplace_back("adaptive budget cap", mRestirConfigurationUbo.GetData().AdaptiveBudgetCap);
+        row.emplace_back("reservoir cache", mRestirConfigurationUbo.GetData().ReservoirCache);
+        row.emplace_back("reservoir cache cell size", mRestirConfigurationUbo.GetData().ReservoirCacheCellSize);
+        row.emplace_back("gi", mRestirConfigurationUbo.GetData().EnableGi);
+        row.emplace_back("gi spatial neighbors", mRestirConfigurationUbo.GetData().GiSpatialNeighbors);
+        row.emplace_back("checkerboard", mRestirConfigurationUbo.GetData().Checkerboard);
+        row.emplace_back("tile light culling", mRestirConfigurationUbo.GetData().TileLightCulling);
+        row.emplace_back("history clamp", mRestirConfigurationUbo.GetData().HistoryClamp);
+        row.emplace_back("temporal pos threshold", mRestirConfigurationUbo.GetData().TemporalPosThreshold);
+        row.emplace_back("temporal normal threshold", mRestirConfigurationUbo.GetData().TemporalNormalThreshold);
+        row.emplace_back("spatial neighbors", mRestirConfigurationUbo.GetData().SpatialNeighbors);
+        row.emplace_back("spatial radius", mRestirConfigurationUbo.GetData().SpatialRadius);
+        row.emplace_back("spatial pos threshold", mRestirConfigurationUbo.GetData().SpatialPosThreshold);
+        row.emplace_back("spatial normal threshold", mRestirConfigurationUbo.GetData().SpatialNormalThreshold);
+        row.emplace_back("reference frames", mRestirConfigurationUbo.GetData().ReferenceMode ? mReferenceFrameCount : 0U);
+        row.emplace_back("render scale", mResolutionController.GetScale());
+        row.emplace_back("render width", mRenderExtent.width);
+        row.emplace_back("render height", mRenderExtent.height);
+        row.emplace_back("drs target ms", mResolutionController.Enabled() ? mResolutionController.GetTargetMs() : 0.0);
+        row.emplace_back("drs measured ms", mResolutionController.GetMeasuredMs());
+        row.emplace_back("drs error", mResolutionController.GetError());
+        row.emplace_back("drs integral", mResolutionController.GetIntegral());
+        row.emplace_back("drs derivative", mResolutionController.GetDerivative());
+#ifdef RESTIR_STATS
+        mStatistics.AppendBenchmarkColumns(row);
+#endif
+    }
+
+    float RestirStage::GetLastGpuMs() const
+    {
+        float gpuMs = 0.f;
+        for(uint32_t pass = 0; pass < mPassTimer.GetPassNames().size(); pass++)
+        {
+            gpuMs += mPassTimer.GetLastPassMs(pass);
+        }
+        return gpuMs;
+    }
+
+#pragma endregion
+#pragma region Parameters
+
+    const std::vector<RestirStage::TunableParameter>& RestirStage::GetTunableParameters()
+    {
+        // clang-format off
+        static const std::vector<TunableParameter> parameters{
+            {"initial_light_samples",     offsetof(RestirConfiguration, InitialLightSampleCount), false},
+            {"enable_temporal",           offsetof(RestirConfiguration, EnableTemporal),          false},
+            {"enable_spatial",            offsetof(RestirConfiguration, EnableSpatial),           false},
+            {"history_clamp",             offsetof(RestirConfiguration, HistoryClamp),            false},
+            {"temporal_pos_threshold",    offsetof(RestirConfiguration, TemporalPosThreshold),    true},
+            {"temporal_normal_threshold", offsetof(RestirConfiguration, TemporalNormalThreshold), true},
+            {"spatial_neighbors",         offsetof(RestirConfiguration, SpatialNeighbors),        false},
+            {"spatial_radius",            offsetof(RestirConfiguration, SpatialRadius),           true},
+            {"spatial_pos_threshold",     offsetof(RestirConfiguration, SpatialPosThreshold),     true},
+            {"spatial_normal_threshold",  offsetof(RestirConfiguration, SpatialNormalThreshold),  true},
+            {"checkerboard",              offsetof(RestirConfiguration, Checkerboard),            false},
+            {"packed_gbuffer",            offsetof(RestirConfiguration, PackedGBuffer),           false},
+            {"spatial_reuse_compute",     offsetof(RestirConfiguration, SpatialReuseCompute),     false},
+            {"reservoir_layout",          offsetof(RestirConfiguration, ReservoirLayout),         false},
+            {"tile_light_culling",        offsetof(RestirConfiguration, TileLightCulling),        false},
+            {"brdf_candidates",           offsetof(RestirConfiguration, BrdfCandidateCount),      false},
+            {"adaptive_budget",           offsetof(RestirConfiguration, AdaptiveBudget),          false},
+            {"adaptive_budget_cap",       offsetof(RestirConfiguration, AdaptiveBudgetCap),       true},
+            {"adaptive_min_weight",       offsetof(RestirConfiguration, AdaptiveBudgetMinWeight), true},
+            {"adaptive_max_weight",       offsetof(RestirConfiguration, AdaptiveBudgetMaxWeight), true},
+            {"reservoir_cache",           offsetof(RestirConfiguration, ReservoirCache),          false},
+            {"reservoir_cache_cell_size", offsetof(RestirConfiguration, ReservoirCacheCellSize),  true},
+            {"reservoir_cache_max_age",   offsetof(RestirConfiguration, ReservoirCacheMaxAge),    false},
+            {"enable_gi",                 offsetof(RestirConfiguration, EnableGi),                false},
+            {"gi_spatial_neighbors",      offsetof(RestirConfiguration, GiSpatialNeighbors),      false},
+            {"gi_spatial_radius",         offsetof(RestirConfiguration, GiSpatialRadius),         true},
+        };
+        // clang-format on
+        return parameters;
+    }
+
+    const RestirStage::TunableParameter* RestirStage::FindTunableParameter(std::string_view name)
+    {
+        for(const TunableParameter& parameter : GetTunableParameters())
+        {
+            if(parameter.Name == name)
+            {
+                return &parameter;
+            }
+        }
+        return nullptr;
+    }
+
+    std::vector<std::string_view> RestirStage::GetParameterNames()
+    {
+        std::vector<std::string_view> names;
+        for(const TunableParameter& parameter : GetTunableParameters())
+        {
+            names.push_back(parameter.Name);
+        }
+        return names;
+    }
+
+    bool RestirStage::GetParameter(std::string_view name, double& value)
+    {
+        const TunableParameter* parameter = FindTunableParameter(name);
+        if(!parameter)
+        {
+            return false;
+        }
+        uint8_t* field = reinterpret_cast<uint8_t*>(&mRestirConfigurationUbo.GetData()) + parameter->Offset;
+        value          = parameter->IsFloat ? (double)*reinterpret_cast<float*>(field) : (double)*reinterpret_cast<uint32_t*>(field);
+        return true;
+    }
+
+    bool RestirStage::SetParameter(std::string_view name, double value)
+    {
+        const TunableParameter* parameter = FindTunableParameter(name);
+        if(!parameter)
+        {
+            return false;
+        }
+        uint8_t* field = reinterpret_cast<uint8_t*>(&mRestirConfigurationUbo.GetData()) + parameter->Offset;
+        if(parameter->IsFloat)
+        {
+            *reinterpret_cast<float*>(field) = (float)value;
+        }
+        else
+        {
+            *reinterpret_cast<uint32_t*>(field) = (uint32_t)std::max(std::round(value), 0.0);
+        }
+        return true;
+    }
+
+    void RestirStage::SetReferenceMode(bool referenceMode)
+    {
+        mRestirConfigurationUbo.GetData().ReferenceMode = referenceMode ? 1 : 0;
+        mReferenceFrameCount                           = 0;
+    }
+
+    RestirPreset RestirStage::GetPreset()
+    {
+        RestirPreset preset;
+        for(const TunableParameter& parameter : GetTunableParameters())
+        {
+            double value = 0.0;
+            GetParameter(parameter.Name, value);
+            preset.emplace_back(std::string(parameter.Name), value);
+        }
+        return preset;
+    }
+
+    void RestirStage::ApplyPreset(const RestirPreset& preset)
+    {
+        for(const auto& [name, value] : preset)
+        {
+            if(!SetParameter(name, value))
+            {
+                logger()->warn("Unknown ReSTIR parameter \"{}\"", name);
+            }
+        }
+        DiscardHistory();
+    }
+
+    bool RestirStage::LoadPreset(const std::string& path)
+    {
+        RestirPreset preset;
+        if(!restir_preset::Read(path, preset))
+        {
+            logger()->warn("Unable to read ReSTIR preset \"{}\"", path);
+            return false;
+        }
+        ApplyPreset(preset);
+        logger()->info("Loaded ReSTIR preset \"{}\"", path);
+        return true;
+    }
+
+    bool RestirStage::SavePreset(const std::string& path, const std::string& comment)
+    {
+        if(!restir_preset::Write(path, GetPreset(), comment))
+        {
+            logger()->warn("Unable to write ReSTIR preset \"{}\"", path);
+            return false;
+        }
+        return true;
+    }
+
 #pragma endregion
 #pragma region Destroy
 
     void RestirStage::ApiDestroyRtPipeline()
     {
         mPipeline.Destroy();
+        mSpatialReusePass.Destroy();
+        mTileLightCulling.DestroyPipeline();
+        mReservoirCache.DestroyPipeline();
         mRaygen.Destroy();
 		mAnyHit.Destroy();
 		mVisiAnyHit.Destroy();
 		mVisiMiss.Destroy();
+        mBrdfCandidateHit.Destroy();
+        mBrdfCandidateMiss.Destroy();
+        mGiBounceHit.Destroy();
+        mGiBounceMiss.Destroy();
     }
 
     void RestirStage::DestroyDescriptors()
@@ -293,6 +981,8 @@ namespace foray {
         stages::DefaultRaytracingStageBase::DestroyDescriptors();
         mDescriptorSetsReservoirSwap[0].Destroy();
         mDescriptorSetsReservoirSwap[1].Destroy();
+        mSpatialReuseDescriptorSet.Destroy();
+        mSpatialReuseTlasSet.Destroy();
 
         for(core::CombinedImageSampler& sampler : mHistoryImagesSampled)
         {
@@ -316,10 +1006,23 @@ namespace foray {
         {
             buffer.Destroy();
         }
+        for(core::ManagedBuffer& buffer : mGiReservoirBuffers)
+        {
+            buffer.Destroy();
+        }
+        mTemporalReservoirBuffer.Destroy();
+        mReferenceAccumulationBuffer.Destroy();
     }
 
     void RestirStage::ApiCustomObjectsDestroy()
     {
+        mPassTimer.Destroy();
+        mStatistics.Destroy();
+        mUpsampler.Destroy();
+        mGBufferPacker.Destroy();
+        mTileLightCulling.Destroy();
+        mAdaptiveBudget.Destroy();
+        mReservoirCache.Destroy();
         mRestirConfigurationUbo.Destroy();
     }
 
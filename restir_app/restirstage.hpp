@@ -1,4 +1,17 @@
 #pragma once
+#include "adaptive_budget.hpp"
+#include "benchmark_csv.hpp"
+#include "compute_pass.hpp"
+#include "dynamic_resolution.hpp"
+#include "gbuffer_packer.hpp"
+#include "gpu_pass_timer.hpp"
+#include "reservoir_cache.hpp"
+#include "reservoir_layout.hpp"
+#include "resolution_upsampler.hpp"
+#include "restir_preset.hpp"
+#include "restir_statistics.hpp"
+#include "tile_light_culling.hpp"
+#include "tlas_descriptor_set.hpp"
 #include <array>
 #include <foray_api.hpp>
 #include <util/foray_historyimage.hpp>
@@ -16,6 +29,8 @@ namespace foray {
         struct RestirConfiguration
         {
             glm::mat4  PrevFrameProjectionViewMatrix;
+            glm::mat4  PrevFrameInverseProjectionViewMatrix;
+            glm::mat4  InverseProjectionViewMatrix;
             glm::vec4  CameraPos;
             glm::uvec2 ScreenSize;
             uint32_t   ReservoirSize = 1;
@@ -30,6 +45,52 @@ namespace foray {
             uint32_t   NumTriLights;
             uint32_t   EnableTemporal;
             uint32_t   EnableSpatial;
+            /// @brief Reuse loops read the packed GBuffer (depth + octahedral normal) instead of the full float images
+            uint32_t   PackedGBuffer;
+            /// @brief Spatial reuse, final visibility and shading run in spatialReuse.comp instead of the raygen shader
+            uint32_t   SpatialReuseCompute;
+            /// @brief reservoir_layout::ELayout of all reservoir buffers
+            uint32_t   ReservoirLayout;
+            /// @brief ScreenSize is below OutputSize, the color is upsampled by ResolutionUpsampler
+            uint32_t   UpscaleOutput;
+            glm::uvec2 PrevScreenSize;
+            glm::uvec2 OutputSize;
+            /// @brief Full ReSTIR update only for pixels with (x + y + Frame) even, the others re-shade their reprojected reservoir
+            uint32_t   Checkerboard;
+            /// @brief Raygen accumulates a brute force reference image instead of running ReSTIR
+            uint32_t   ReferenceMode;
+            uint32_t   ReferenceSamplesPerFrame;
+            /// @brief Frames already accumulated, 0 restarts the accumulation
+            uint32_t   ReferenceFrameCount;
+            /// @brief Upper bound of M for reservoirs taken from the previous frame (temporal and spatial reuse)
+            uint32_t   HistoryClamp;
+            /// @brief Max world space distance between the surface and its reprojection for temporal reuse
+            float      TemporalPosThreshold;
+            /// @brief Max squared length of the difference between the surface normal and its reprojection
+            float      TemporalNormalThreshold;
+            /// @brief Candidates are drawn from the per tile light lists of TileLightCulling instead of all lights
+            uint32_t   TileLightCulling;
+            /// @brief Initial candidates drawn by GGX sampling of the BRDF instead of light sampling, out of InitialLightSampleCount.
+            /// Both sources are combined with balance heuristic weights.
+            uint32_t   BrdfCandidateCount;
+            /// @brief Per pixel candidate and spatial neighbor budgets from the confidence in the history (AdaptiveBudget)
+            uint32_t   AdaptiveBudget;
+            /// @brief Upper bound of the mean budget, as a fraction of InitialLightSampleCount and SpatialNeighbors
+            float      AdaptiveBudgetCap;
+            /// @brief Budget weights of fully converged and of disoccluded pixels
+            float      AdaptiveBudgetMinWeight;
+            float      AdaptiveBudgetMaxWeight;
+            /// @brief Pixels without valid temporal history are seeded from the world space reservoir cache (ReservoirCache)
+            uint32_t   ReservoirCache;
+            /// @brief World space edge length of a cache cell
+            float      ReservoirCacheCellSize;
+            /// @brief Entries written more frames ago are not used for seeding
+            uint32_t   ReservoirCacheMaxAge;
+            /// @brief One bounce indirect light resampled with ReSTIR GI, added to the direct light
+            uint32_t   EnableGi;
+            /// @brief Previous frame GI reservoirs merged per pixel and their pixel radius
+            uint32_t   GiSpatialNeighbors;
+            float      GiSpatialRadius;
         };
 
         struct alignas(16) LightSample
@@ -48,12 +109,37 @@ namespace foray {
             uint32_t    NumSamples;
         };
 
+        /// @brief Mirrors GiReservoir in restirGi.glsl
+        struct alignas(16) GiReservoir
+        {
+            glm::vec4 VisiblePos_W;
+            glm::vec4 SamplePos_M;
+            glm::vec4 SampleNormal_WSum;
+            glm::vec4 Radiance_PHat;
+        };
+
         struct PushConstantRestir
         {
             uint32_t RngSeed                   = 0U;
             VkBool32 DiscardPrevFrameReservoir = VK_TRUE;
         } mPushConstantRestir;
 
+        uint32_t mPrevFrameReservoirLayout = 0;
+        bool     mPrevFrameReference       = false;
+        bool     mDiscardHistory           = false;
+        bool     mPrevFrameAdaptiveBudget  = false;
+        bool     mPrevFrameGi              = false;
+        bool     mPrevFramePackedGBuffer   = false;
+
+        struct TunableParameter
+        {
+            std::string_view Name;
+            size_t           Offset;
+            bool             IsFloat;
+        };
+        static const std::vector<TunableParameter>& GetTunableParameters();
+        static const TunableParameter*              FindTunableParameter(std::string_view name);
+
       public:
         virtual void Init(foray::core::Context*              context,
                           foray::scene::Scene*               scene,
@@ -69,6 +155,38 @@ namespace foray {
 
         void PrepareImguiWindow();
 
+        /// @brief Adds pass timings and dynamic resolution state of the last frame
+        void AppendBenchmarkColumns(BenchmarkCsv::Row& row);
+
+        inline bool     IsReferenceMode() { return mRestirConfigurationUbo.GetData().ReferenceMode != 0; }
+        inline uint32_t GetReferenceFrameCount() const { return mReferenceFrameCount; }
+        /// @brief Switching restarts the reference accumulation
+        void SetReferenceMode(bool referenceMode);
+
+        /// @brief Shader counters of the current frame, valid after RecordFrame (without RESTIR_STATS the counters stay zero)
+        inline RestirStatistics& GetStatistics() { return mStatistics; }
+
+        /// @brief Sum of the GPU pass times of the most recently read back frame in milliseconds
+        float GetLastGpuMs() const;
+        /// @brief Drops the GPU pass times, GetLastGpuMs returns 0 until a frame recorded after the call is read back
+        inline void ResetGpuTimes() { mPassTimer.Reset(); }
+
+        /// @brief Names of the RestirConfiguration fields accessible by preset files and the parameter sweep
+        static std::vector<std::string_view> GetParameterNames();
+        bool GetParameter(std::string_view name, double& value);
+        /// @brief Unsigned fields are rounded. Returns false for unknown names.
+        bool SetParameter(std::string_view name, double value);
+
+        /// @brief Current values of all named parameters
+        RestirPreset GetPreset();
+        /// @brief Sets the listed parameters and discards the temporal history, unknown names are logged and skipped
+        void ApplyPreset(const RestirPreset& preset);
+        bool LoadPreset(const std::string& path);
+        bool SavePreset(const std::string& path, const std::string& comment = "");
+
+        /// @brief The next frame starts without temporal history, e.g. after parameter changes
+        inline void DiscardHistory() { mDiscardHistory = true; }
+
       protected:
         RestirProject* mRestirApp{};
 
@@ -90,6 +208,10 @@ namespace foray {
         virtual void RecordFrameBind(VkCommandBuffer cmdBuffer, base::FrameRenderInfo& renderInfo) override;
         virtual void RecordFrameTraceRays(VkCommandBuffer cmdBuffer, base::FrameRenderInfo& renderInfo) override;
 
+        void CreateOrUpdateSpatialReuseDescriptors();
+        void CreateOrUpdateLowResOutputDescriptor(core::DescriptorSet& descriptorSet, VkShaderStageFlags stages);
+        void RecordSpatialReuse(VkCommandBuffer cmdBuffer, base::FrameRenderInfo& renderInfo);
+
         void GetGBufferImages();
 
         enum UsedGBufferImages
@@ -111,12 +233,32 @@ namespace foray {
         static inline const std::string VISI_MISS_FILE   = "shaders/restir/visibilityTest.rmiss";
         static inline const std::string VISI_ANYHIT_FILE = "shaders/restir/visibilityTest.rchit";
 
+        static inline const std::string BRDF_CANDIDATE_HIT_FILE  = "shaders/restir/brdfCandidate.rchit";
+        static inline const std::string BRDF_CANDIDATE_MISS_FILE = "shaders/restir/brdfCandidate.rmiss";
+
+        static inline const std::string GI_BOUNCE_HIT_FILE  = "shaders/restir/giBounce.rchit";
+        static inline const std::string GI_BOUNCE_MISS_FILE = "shaders/restir/giBounce.rmiss";
+
+        static inline const std::string SPATIAL_REUSE_FILE = "shaders/restir/spatialReuse.comp";
+        /// @brief Shared memory of the spatialReuse.comp tile staging: (TILE_SIZE + 2 * SPATIAL_APRON)^2 entries of surface, M and the compact samples
+        static constexpr uint32_t SPATIAL_REUSE_SHARED_COUNT = (8 + 2 * 3) * (8 + 2 * 3);
+        static constexpr uint32_t SPATIAL_REUSE_SHARED_BYTES =
+            SPATIAL_REUSE_SHARED_COUNT * (sizeof(glm::vec4) + sizeof(uint32_t) + RESERVOIR_SIZE * (sizeof(glm::vec4) + sizeof(glm::uvec2) + sizeof(float)));
+
 		foray::core::ShaderModule mRaygen;
         foray::core::ShaderModule mAnyHit;
 
         foray::core::ShaderModule mVisiMiss;
         foray::core::ShaderModule mVisiAnyHit;
 
+        /// @brief Closest hit and miss of the BRDF sampled candidate rays, report the TriLight hit
+        foray::core::ShaderModule mBrdfCandidateHit;
+        foray::core::ShaderModule mBrdfCandidateMiss;
+
+        /// @brief Closest hit and miss of the ReSTIR GI secondary rays, report the surface hit
+        foray::core::ShaderModule mGiBounceHit;
+        foray::core::ShaderModule mGiBounceMiss;
+
         // access to imgui stage
         foray::stages::ImguiStage* mImguiStageRef{};
 
@@ -132,9 +274,57 @@ namespace foray {
 
         std::array<foray::core::ManagedBuffer, 2> mReservoirBuffers;
         std::array<foray::core::DescriptorSet, 2> mDescriptorSetsReservoirSwap;
+        /// @brief ReSTIR GI reservoirs, swapped like mReservoirBuffers (bindings 3 and 4 of the swap sets)
+        std::array<foray::core::ManagedBuffer, 2> mGiReservoirBuffers;
+
+        // compute spatial reuse: raygen writes initial + temporal reservoirs here, the compute pass reads them
+        foray::core::ManagedBuffer mTemporalReservoirBuffer;
+        foray::core::DescriptorSet mSpatialReuseDescriptorSet;
+        TlasDescriptorSet          mSpatialReuseTlasSet;
+        ComputePass                mSpatialReusePass;
+        /// @brief False if the device has less compute shared memory than the tile staging needs, the raygen spatial reuse is used then
+        bool mSpatialReuseComputeSupported = false;
 
         foray::util::ManagedUbo<RestirConfiguration> mRestirConfigurationUbo;
 
+        /// @brief Reference mode sums (see accumulateReference in raygen.rgen), two vec4 per output pixel
+        foray::core::ManagedBuffer mReferenceAccumulationBuffer;
+        uint32_t                   mReferenceFrameCount = 0;
+        glm::mat4                  mReferenceProjectionView{};
+
+        GBufferPacker mGBufferPacker;
+
+        /// @brief Builds the per tile candidate light lists, runs with the spatial reuse descriptor set
+        TileLightCulling mTileLightCulling;
+
+        /// @brief Weight sums and neighbor budgets of the adaptive budget mode
+        AdaptiveBudget mAdaptiveBudget;
+
+        /// @brief World space reservoir cache, its update pass runs with the spatial reuse descriptor set
+        ReservoirCache mReservoirCache;
+
+        enum TimedPass
+        {
+            PASS_GBUFFER_PACK = 0,
+            PASS_RAYGEN       = 1,
+            PASS_SPATIAL      = 2,
+            PASS_UPSAMPLE     = 3,
+            PASS_TILE_CULLING = 4,
+            PASS_CACHE_UPDATE = 5,
+        };
+        GpuPassTimer mPassTimer;
+
+        /// @brief Reuse acceptance, rejection reasons, M distribution and shadow ray counters (compiled out without RESTIR_STATS)
+        RestirStatistics mStatistics;
+
+        /// @brief Shader definitions shared by the raygen and compute ReSTIR passes
+        std::unordered_map<std::string, std::string> GetShaderDefinitions() const;
+
+        /// @brief ReSTIR runs at a render extent chosen by the controller, RestirConfiguration::ScreenSize mirrors it
+        DynamicResolutionController mResolutionController;
+        ResolutionUpsampler         mUpsampler;
+        VkExtent2D                  mRenderExtent{};
+
         static constexpr VkSamplerCreateInfo mSamplerCi = VkSamplerCreateInfo{.sType                   = VkStructureType::VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
                                                                               .magFilter               = VkFilter::VK_FILTER_NEAREST,
                                                                               .minFilter               = VkFilter::VK_FILTER_NEAREST,
@@ -0,0 +1,38 @@
+#ifndef SVGF_COMMON_GLSL
+#define SVGF_COMMON_GLSL
+
+// Shared helpers of the SVGF denoiser passes. The filter works on illumination, the ReSTIR color
+// divided by the surface albedo, so texture detail is not blurred away and gets remodulated at the end.
+
+#define ALBEDO_EPSILON 0.001
+
+float luminance(vec3 rgb)
+{
+	const vec3 W = vec3(0.2125, 0.7154, 0.0721);
+	return dot(rgb, W);
+}
+
+vec3 demodulate(vec3 color, vec3 albedo)
+{
+	return color / max(albedo, vec3(ALBEDO_EPSILON));
+}
+
+vec3 remodulate(vec3 illumination, vec3 albedo)
+{
+	return illumination * max(albedo, vec3(ALBEDO_EPSILON));
+}
+
+bool surfaceValid(vec3 pos)
+{
+	return !(pos.x == 0 && pos.y == 0 && pos.z == 0);
+}
+
+/// @brief Edge stopping weight between two surfaces (SVGF normal and depth terms, depth replaced by world space distance)
+float surfaceWeight(vec3 pos, vec3 normal, vec3 otherPos, vec3 otherNormal, float phiNormal, float phiPosition)
+{
+	float normalWeight = pow(max(dot(normal, otherNormal), 0.0), phiNormal);
+	float posWeight = exp(-distance(pos, otherPos) / phiPosition);
+	return normalWeight * posWeight;
+}
+
+#endif // SVGF_COMMON_GLSL
@@ -1,8 +1,8 @@
 #version 450
 
-layout(location = 0) out vec4 outColor;
-#extension GL_EXT_debug_printf : enable
 layout(location = 0) in vec3 fragColor;
+layout(location = 0) out vec4 outColor;
+
 void main() {
-     outColor = vec4(1.0,0,0,0);
-}
\ No newline at end of file
+     outColor = vec4(fragColor, 0);
+}
@@ -1,34 +1,39 @@
 #version 450
 #extension GL_KHR_vulkan_glsl : enable // Vulkan-specific syntax
 #extension GL_GOOGLE_include_directive : enable // Include files
-#extension GL_EXT_debug_printf : enable
+
+// Pulls the vertices of the visible triangle lights (etmCull.comp) from the TriLights buffer, no vertex buffer is bound
 
 // Camera Ubo
 #define SET_CAMERA_UBO 0
 #define BIND_CAMERA_UBO 2
 #include "../../../foray/src/shaders/common/camera.glsl"
 
-layout(location = 0) in vec3 inPosition;
-
-vec2 positions[3] = vec2[](
-    vec2(0.0, -0.5),
-    vec2(0.5, 0.5),
-    vec2(-0.5, 0.5)
-);
+#include "../restir/triLights.glsl"
+#include "etmCommon.glsl"
 
-vec3 colors[3] = vec3[](
-    vec3(1.0, 0.0, 0.0),
-    vec3(0.0, 1.0, 0.0),
-    vec3(0.0, 0.0, 1.0)
-);
+// optional float per light, used if pushConstants.UseScalars is set
+layout(std430, set = 0, binding = 5) readonly buffer LightScalars { float lightScalars[]; };
 
 layout(location = 0) out vec3 fragColor;
 
-void main() {
-	//debugPrintfEXT(" inPos %f %f %f \n", inPosition.x, inPosition.y, inPosition.z);
-	//debugPrintfEXT("normalToLightFactor");
-    gl_Position = Camera.ProjectionViewMatrix * vec4(inPosition, 1.f);
-   // gl_Position = vec4(inPosition, 1.f);
-	//gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-    fragColor = colors[gl_VertexIndex];
+/// @brief Blue - green - red ramp over [0, 1]
+vec3 heatRamp(float t)
+{
+	t = clamp(t, 0.0, 1.0);
+	return t < 0.5 ? mix(vec3(0.0, 0.0, 1.0), vec3(0.0, 1.0, 0.0), 2.0 * t) : mix(vec3(0.0, 1.0, 0.0), vec3(1.0, 0.0, 0.0), 2.0 * t - 1.0);
+}
+
+void main()
+{
+	uint lightIndex = visibleLights[gl_VertexIndex / 3];
+	vec3 p[3];
+	triLightVertices(triLights.triLights[lightIndex], p[0], p[1], p[2]);
+	gl_Position = Camera.ProjectionViewMatrix * vec4(p[gl_VertexIndex % 3], 1.0);
+
+	fragColor = vec3(1.0, 0.0, 0.0);
+	if (pushConstants.UseScalars != 0)
+	{
+		fragColor = heatRamp(lightScalars[lightIndex] / max(pushConstants.ScalarMax, 1e-6));
+	}
 }
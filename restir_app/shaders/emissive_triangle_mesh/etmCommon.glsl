@@ -0,0 +1,16 @@
+#ifndef ETM_COMMON_GLSL
+#define ETM_COMMON_GLSL
+
+// Shared by etmCull.comp and etm.vert, mirrors EmissiveTriangleMeshStage::PushConstants
+
+layout(push_constant) uniform PushConstants
+{
+	uint LightCount;
+	uint UseScalars;
+	float ScalarMax;
+} pushConstants;
+
+// lights that passed the frustum culling, three vertices are drawn per entry
+layout(std430, set = 0, binding = 3) buffer VisibleLights { uint visibleLights[]; };
+
+#endif // ETM_COMMON_GLSL
@@ -0,0 +1,89 @@
+#ifndef ADAPTIVE_BUDGET_GLSL
+#define ADAPTIVE_BUDGET_GLSL
+
+// Adaptive per pixel candidate and spatial neighbor budgets (AdaptiveBudget on the host). Requires RestirConfig.
+// Pixels weight the fixed budget by the confidence in their reprojected history. The weights of all fully updated pixels are
+// summed per frame (reduced per subgroup in adaptiveBudgetFlush with SUBGROUP_REDUCE, like the statistics), the next frame scales them down if their
+// mean exceeds AdaptiveBudgetCap. ADAPTIVE_BUDGET_WEIGHT_SCALE is defined by the application.
+
+#ifdef SUBGROUP_REDUCE
+#extension GL_KHR_shader_subgroup_basic : enable
+#extension GL_KHR_shader_subgroup_arithmetic : enable
+#endif
+
+#ifndef ADAPTIVE_BUDGET_WEIGHT_SCALE
+#define ADAPTIVE_BUDGET_WEIGHT_SCALE 64
+#endif
+
+layout(set = 0, binding = 28) buffer AdaptiveBudgetBuffer
+{
+	/// @brief Fixed point weight sums and fully updated pixels, index Frame & 1 is written this frame
+	uint weightSum[2];
+	uint pixelCount[2];
+	/// @brief Spatial neighbor budget per render pixel, written by raygen for the compute spatial reuse
+	uint neighbors[];
+} adaptiveBudget;
+
+uint gAdaptiveWeight = 0;
+uint gAdaptivePixels = 0;
+
+/// @brief Weight of the fixed budget for a pixel. The confidence is the M of the reprojected reservoir relative to the history
+/// clamp (0 for disocclusions) times the stability of its target function (1 = unchanged since the last frame).
+float adaptiveBudgetWeight(uint historyM, float pHatStability)
+{
+	float confidence = clamp(float(historyM) / float(max(RestirConfig.HistoryClamp, 1u)), 0.0, 1.0) * pHatStability;
+	return mix(RestirConfig.AdaptiveBudgetMaxWeight, RestirConfig.AdaptiveBudgetMinWeight, confidence);
+}
+
+/// @brief Scales the weights down to a mean of AdaptiveBudgetCap, judged by the previous frame. Without a previous frame
+/// (first adaptive frame, resize) the weights are used as they are.
+float adaptiveBudgetNormalization()
+{
+	uint prev = (RestirConfig.Frame + 1) & 1u;
+	uint weightSum = adaptiveBudget.weightSum[prev];
+	uint pixelCount = adaptiveBudget.pixelCount[prev];
+	if (weightSum == 0 || pixelCount == 0)
+	{
+		return 1.0;
+	}
+	float meanWeight = float(weightSum) / (float(pixelCount) * float(ADAPTIVE_BUDGET_WEIGHT_SCALE));
+	return min(RestirConfig.AdaptiveBudgetCap / meanWeight, 1.0);
+}
+
+/// @brief Stochastic rounding, the expected budget is exact
+uint adaptiveBudgetRound(float budget, inout uint randomSeed)
+{
+	randomSeed++;
+	return uint(floor(budget + lcgFloat(randomSeed)));
+}
+
+/// @brief Counts the (unnormalized) weight of a fully updated pixel
+void adaptiveBudgetRecord(float weight)
+{
+	gAdaptiveWeight += uint(round(weight * float(ADAPTIVE_BUDGET_WEIGHT_SCALE)));
+	gAdaptivePixels += 1;
+}
+
+void adaptiveBudgetFlush()
+{
+	if (RestirConfig.AdaptiveBudget == 0)
+	{
+		return;
+	}
+#ifdef SUBGROUP_REDUCE
+	uint weight = subgroupAdd(gAdaptiveWeight);
+	uint pixels = subgroupAdd(gAdaptivePixels);
+	if (subgroupElect() && pixels > 0)
+#else
+	uint weight = gAdaptiveWeight;
+	uint pixels = gAdaptivePixels;
+	if (pixels > 0)
+#endif
+	{
+		uint slot = RestirConfig.Frame & 1u;
+		atomicAdd(adaptiveBudget.weightSum[slot], weight);
+		atomicAdd(adaptiveBudget.pixelCount[slot], pixels);
+	}
+}
+
+#endif // ADAPTIVE_BUDGET_GLSL
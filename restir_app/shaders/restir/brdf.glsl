@@ -87,6 +87,33 @@ float disneyBrdfLuminance(float cosIn, float cosOut, float cosHalf, float cosInH
 	return diffuse + specular;
 }
 
+/// @brief GGX alpha of the specular lobe, as in disneyBrdfSpecularFactors
+float ggxAlpha(float roughness) {
+	return max(0.001, pow(roughness, 2.0));
+}
+
+/// @brief Reflects wo about a half vector drawn from D(h) cos(theta_h) of GTR2
+vec3 sampleGGXReflection(vec3 normal, vec3 wo, float alpha, float r1, float r2) {
+	float cosThetaH = sqrt((1.0 - r1) / (1.0 + (alpha * alpha - 1.0) * r1));
+	float sinThetaH = sqrt(max(1.0 - cosThetaH * cosThetaH, 0.0));
+	float phi = 2.0 * M_PI * r2;
+	vec3 tangent = normalize(cross(normal, abs(normal.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0)));
+	vec3 bitangent = cross(normal, tangent);
+	vec3 halfVec = normal * cosThetaH + (tangent * cos(phi) + bitangent * sin(phi)) * sinThetaH;
+	return reflect(-wo, halfVec);
+}
+
+/// @brief Solid angle pdf of sampleGGXReflection for direction wi
+float ggxReflectionPdf(vec3 normal, vec3 wo, vec3 wi, float alpha) {
+	vec3 halfVec = normalize(wo + wi);
+	float cosHalf = dot(normal, halfVec);
+	float cosOutHalf = dot(wo, halfVec);
+	if (cosHalf <= 0.0 || cosOutHalf <= 0.0) {
+		return 0.0;
+	}
+	return GTR2(cosHalf, alpha) * cosHalf / (4.0 * cosOutHalf);
+}
+
 float evaluatePHat(
 	vec3 worldPos, vec3 lightPos, vec3 camPos, vec3 normal, vec3 lightNormal, bool useLightNormal,
 	float albedoLum, float emissionLum, float roughness, float metallic
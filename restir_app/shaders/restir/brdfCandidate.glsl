@@ -0,0 +1,16 @@
+#ifndef BRDF_CANDIDATE_GLSL
+#define BRDF_CANDIDATE_GLSL
+
+// Payload of the BRDF sampled candidate rays (raygen.rgen -> brdfCandidate.rchit / brdfCandidate.rmiss)
+
+#define BRDF_CANDIDATE_NO_LIGHT 0xFFFFFFFFu
+
+struct BrdfCandidateHit
+{
+	/// @brief Ray distance to the hit
+	float distance;
+	/// @brief TriLight of the hit triangle, BRDF_CANDIDATE_NO_LIGHT for misses and surfaces that are no light
+	uint lightIndex;
+};
+
+#endif // BRDF_CANDIDATE_GLSL
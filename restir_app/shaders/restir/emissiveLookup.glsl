@@ -0,0 +1,63 @@
+#ifndef EMISSIVE_LOOKUP_GLSL
+#define EMISSIVE_LOOKUP_GLSL
+
+// Scene triangle -> TriLight index, built by EmissiveTriangleLookup on the host. Open addressing table over the quantized
+// world space centroids of the emissive source triangles (before light LOD).
+
+#define EMISSIVE_LOOKUP_EMPTY 0xFFFFFFFFu
+
+struct EmissiveLookupEntry
+{
+	vec3 centroid;
+	uint light;
+};
+
+layout(std430, set = 0, binding = 27) readonly buffer EmissiveLookup
+{
+	float cellSize;
+	uint mask;
+	uint padding0;
+	uint padding1;
+	EmissiveLookupEntry entries[];
+} emissiveLookup;
+
+/// @brief Same arithmetic as EmissiveTriangleLookup::HashCell
+uint emissiveLookupSlot(ivec3 cell)
+{
+	return ((uint(cell.x) * 73856093u) ^ (uint(cell.y) * 19349663u) ^ (uint(cell.z) * 83492791u)) & emissiveLookup.mask;
+}
+
+/// @brief TriLight of the emissive triangle with this world space centroid, EMISSIVE_LOOKUP_EMPTY if there is none.
+/// The centroid may differ from the host's by rounding, so the 8 cells within half a cell of it are searched.
+uint emissiveLookupLight(vec3 centroid)
+{
+	vec3 scaled = centroid / emissiveLookup.cellSize;
+	ivec3 baseCell = ivec3(floor(scaled - 0.5));
+	float maxDistanceSquared = 0.0625 * emissiveLookup.cellSize * emissiveLookup.cellSize;
+
+	uint light = EMISSIVE_LOOKUP_EMPTY;
+	float bestDistanceSquared = maxDistanceSquared;
+	for (int i = 0; i < 8; i++)
+	{
+		uint slot = emissiveLookupSlot(baseCell + ivec3(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+		for (uint probe = 0; probe <= emissiveLookup.mask; probe++)
+		{
+			EmissiveLookupEntry entry = emissiveLookup.entries[slot];
+			if (entry.light == EMISSIVE_LOOKUP_EMPTY)
+			{
+				break;
+			}
+			vec3 diff = entry.centroid - centroid;
+			float distanceSquared = dot(diff, diff);
+			if (distanceSquared < bestDistanceSquared)
+			{
+				bestDistanceSquared = distanceSquared;
+				light = entry.light;
+			}
+			slot = (slot + 1) & emissiveLookup.mask;
+		}
+	}
+	return light;
+}
+
+#endif // EMISSIVE_LOOKUP_GLSL
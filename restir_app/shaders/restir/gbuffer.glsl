@@ -0,0 +1,107 @@
+#ifndef GBUFFER_GLSL
+#define GBUFFER_GLSL
+
+// GBuffer access for the ReSTIR passes. Requires RestirConfig to be declared.
+// With RestirConfig.PackedGBuffer set, surfaces are read from the packed images (see gbufferPack.comp),
+// which cuts the per neighbor fetch in the reuse loops from two float vectors to a single rg32ui texel.
+// All functions take pixel coordinates in render space (RestirConfig.ScreenSize), the GBuffer has output size.
+
+#include "packing.glsl"
+
+#define GBUFFER_ALBEDO 0
+#define GBUFFER_NORMAL 1
+#define GBUFFER_POS 2
+#define GBUFFER_MOTION 3
+#define GBUFFER_MATERIAL_INDEX 4
+layout(set = 0, binding = 14) uniform sampler2D GBufferTextures[];
+
+#define PREVIOUSFRAME_ALBEDO 0
+#define PREVIOUSFRAME_NORMAL 1
+#define PREVIOUSFRAME_POS 2
+layout(set = 0, binding = 15) uniform sampler2D PreviousFrameImages[];
+
+#define PACKED_GEOMETRY 0
+#define PACKED_MATERIAL 1
+layout(set = 0, binding = 17) uniform usampler2D PackedGBuffer[];
+layout(set = 0, binding = 18) uniform usampler2D PackedGeometryHistory;
+
+/// @brief Maps a render space pixel to the GBuffer pixel covering its center
+ivec2 gbufferPixel(ivec2 renderPixel)
+{
+	if (RestirConfig.UpscaleOutput == 0)
+	{
+		return renderPixel;
+	}
+	vec2 scale = vec2(RestirConfig.OutputSize) / vec2(RestirConfig.ScreenSize);
+	return min(ivec2((vec2(renderPixel) + 0.5) * scale), ivec2(RestirConfig.OutputSize) - 1);
+}
+
+bool packedGeometryValid(uvec2 geometry)
+{
+	// written by gbufferPack.comp from the same position test as the unpacked path
+	return geometry.x != PACKED_GEOMETRY_EMPTY;
+}
+
+/// @brief Loads world position and normal of the current frame. Returns false for pixels without geometry.
+bool LoadSurface(ivec2 renderPixel, out vec3 pos, out vec3 normal)
+{
+	ivec2 pixelCoord = gbufferPixel(renderPixel);
+	if (RestirConfig.PackedGBuffer == 1)
+	{
+		uvec2 geometry = texelFetch(PackedGBuffer[PACKED_GEOMETRY], pixelCoord, 0).xy;
+		float depth = uintBitsToFloat(geometry.x);
+		pos = reconstructWorldPos(vec2(pixelCoord) + 0.5, vec2(RestirConfig.OutputSize), depth, RestirConfig.InverseProjectionViewMatrix);
+		normal = unpackNormalOct(geometry.y);
+		return packedGeometryValid(geometry);
+	}
+
+	pos = texelFetch(GBufferTextures[GBUFFER_POS], pixelCoord, 0).xyz;
+	normal = texelFetch(GBufferTextures[GBUFFER_NORMAL], pixelCoord, 0).xyz;
+	return !(pos.x == 0 && pos.y == 0 && pos.z == 0);
+}
+
+void LoadMaterial(ivec2 renderPixel, out vec3 albedo, out int materialIndex)
+{
+	ivec2 pixelCoord = gbufferPixel(renderPixel);
+	if (RestirConfig.PackedGBuffer == 1)
+	{
+		uvec2 material = texelFetch(PackedGBuffer[PACKED_MATERIAL], pixelCoord, 0).xy;
+		albedo = unpackUnorm4x8(material.x).xyz;
+		materialIndex = int(material.y);
+		return;
+	}
+
+	albedo = texelFetch(GBufferTextures[GBUFFER_ALBEDO], pixelCoord, 0).xyz;
+	materialIndex = floatBitsToInt(texelFetch(GBufferTextures[GBUFFER_MATERIAL_INDEX], pixelCoord, 0).x);
+}
+
+/// @brief Loads world position and normal of the previous frame. Returns false for pixels without geometry, normal is undefined then.
+bool LoadPreviousSurface(ivec2 renderPixel, out vec3 pos, out vec3 normal)
+{
+	ivec2 pixelCoord = gbufferPixel(renderPixel);
+	if (RestirConfig.PackedGBuffer == 1)
+	{
+		uvec2 geometry = texelFetch(PackedGeometryHistory, pixelCoord, 0).xy;
+		float depth = uintBitsToFloat(geometry.x);
+		pos = reconstructWorldPos(vec2(pixelCoord) + 0.5, vec2(RestirConfig.OutputSize), depth, RestirConfig.PrevFrameInverseProjectionViewMatrix);
+		normal = unpackNormalOct(geometry.y);
+		return packedGeometryValid(geometry);
+	}
+
+	pos = texelFetch(PreviousFrameImages[PREVIOUSFRAME_POS], pixelCoord, 0).xyz;
+	normal = vec3(0);
+	if (pos.x == 0 && pos.y == 0 && pos.z == 0)
+	{
+		return false;
+	}
+	normal = texelFetch(PreviousFrameImages[PREVIOUSFRAME_NORMAL], pixelCoord, 0).xyz;
+	return true;
+}
+
+/// @brief Motion vector in uv space
+vec2 LoadMotion(ivec2 renderPixel)
+{
+	return texelFetch(GBufferTextures[GBUFFER_MOTION], gbufferPixel(renderPixel), 0).xy;
+}
+
+#endif // GBUFFER_GLSL
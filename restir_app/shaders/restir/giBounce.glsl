@@ -0,0 +1,19 @@
+#ifndef GI_BOUNCE_GLSL
+#define GI_BOUNCE_GLSL
+
+// Payload of the ReSTIR GI secondary rays (raygen.rgen -> giBounce.rchit / giBounce.rmiss)
+
+struct GiBounceHit
+{
+	/// @brief World space hit point
+	vec3 position;
+	/// @brief Ray distance to the hit, negative for misses
+	float distance;
+	/// @brief Normal mapped shading normal, facing the ray origin
+	vec3 normal;
+	int materialIndex;
+	/// @brief Base color of the material at the hit
+	vec3 albedo;
+};
+
+#endif // GI_BOUNCE_GLSL
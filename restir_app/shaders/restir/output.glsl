@@ -0,0 +1,21 @@
+#ifndef OUTPUT_GLSL
+#define OUTPUT_GLSL
+
+// Final color output of the ReSTIR passes. Requires RestirConfig and an ImageOutput storage image to be declared.
+// At reduced render extent the color goes to LowResOutput, which upsample.comp resolves to ImageOutput.
+
+layout(set = 0, binding = 22) uniform writeonly image2D LowResOutput;
+
+void storeOutput(ivec2 renderPixel, vec4 color)
+{
+	if (RestirConfig.UpscaleOutput == 1)
+	{
+		imageStore(LowResOutput, renderPixel, color);
+	}
+	else
+	{
+		imageStore(ImageOutput, renderPixel, color);
+	}
+}
+
+#endif // OUTPUT_GLSL
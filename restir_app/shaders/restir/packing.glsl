@@ -0,0 +1,40 @@
+#ifndef PACKING_GLSL
+#define PACKING_GLSL
+
+// octahedral normal encoding, see "A Survey of Efficient Representations for Independent Unit Vectors" (Cigolle et al. 2014)
+
+vec2 octWrap(vec2 v)
+{
+	return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+/// @brief Encodes a unit vector into two 16 bit snorm components
+uint packNormalOct(vec3 n)
+{
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 oct = n.z >= 0.0 ? n.xy : octWrap(n.xy);
+	return packSnorm2x16(oct);
+}
+
+vec3 unpackNormalOct(uint packed)
+{
+	vec2 oct = unpackSnorm2x16(packed);
+	vec3 n = vec3(oct, 1.0 - abs(oct.x) - abs(oct.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+/// @brief Packed geometry depth bits of pixels without geometry. NaN bits, never written by a depth buffer.
+#define PACKED_GEOMETRY_EMPTY 0xFFFFFFFFu
+
+/// @brief Reconstructs a world space position from a depth buffer value
+vec3 reconstructWorldPos(vec2 pixelCenter, vec2 screenSize, float depth, mat4 inverseProjectionView)
+{
+	vec2 ndc = pixelCenter / screenSize * 2.0 - 1.0;
+	vec4 worldPos = inverseProjectionView * vec4(ndc, depth, 1.0);
+	return worldPos.xyz / worldPos.w;
+}
+
+#endif // PACKING_GLSL
@@ -0,0 +1,92 @@
+#ifndef RESERVOIR_CACHE_GLSL
+#define RESERVOIR_CACHE_GLSL
+
+// World space reservoir cache (ReservoirCache on the host). Requires RestirConfig, restirUtils.glsl and packing.glsl.
+// Fixed size hash table of RESERVOIR_CACHE_BUCKETS buckets with RESERVOIR_CACHE_WAYS entries each, keyed by the surface position
+// quantized to RestirConfig.ReservoirCacheCellSize and the normal quantized to 16 octahedral bins. reservoirCacheUpdate.comp
+// inserts final reservoirs and evicts the least recently used entry of a full bucket, raygen seeds pixels without a valid
+// temporal history from it. Both run in separate dispatches, so lookups never see partially written entries.
+// RESERVOIR_CACHE_BUCKETS and RESERVOIR_CACHE_WAYS are defined by the application.
+
+#ifndef RESERVOIR_CACHE_BUCKETS
+#define RESERVOIR_CACHE_BUCKETS 16384
+#endif
+#ifndef RESERVOIR_CACHE_WAYS
+#define RESERVOIR_CACHE_WAYS 4
+#endif
+
+struct ReservoirCacheEntry
+{
+	/// @brief Key checksum, 0 for entries never written
+	uint key;
+	/// @brief Stamp of the last insert or hit, for LRU eviction
+	uint lastUsed;
+	/// @brief Stamp of the last insert, one writer claims the entry per frame
+	uint lastWrite;
+	uint padding;
+	Reservoir reservoir;
+};
+
+layout(std430, set = 0, binding = 29) buffer ReservoirCacheBuffer
+{
+	/// @brief Entries taken from the empty state since the last clear
+	uint usedEntries;
+	uint padding0;
+	uint padding1;
+	uint padding2;
+	ReservoirCacheEntry entries[];
+} reservoirCache;
+
+/// @brief Frame stamp of lastUsed / lastWrite, 0 is left for entries never written
+uint reservoirCacheStamp()
+{
+	return RestirConfig.Frame + 1;
+}
+
+uint reservoirCacheHash(uvec4 v)
+{
+	uint h = v.x * 0x8da6b343u ^ v.y * 0xd8163841u ^ v.z * 0xcb1ab31fu ^ v.w * 0x165667b1u;
+	h ^= h >> 16;
+	h *= 0x7feb352du;
+	h ^= h >> 15;
+	h *= 0x846ca68bu;
+	h ^= h >> 16;
+	return h;
+}
+
+/// @brief Bucket of the cell and a nonzero checksum telling cells of the same bucket apart
+void reservoirCacheKey(vec3 pos, vec3 normal, out uint bucket, out uint key)
+{
+	ivec3 cell = ivec3(floor(pos / RestirConfig.ReservoirCacheCellSize));
+	uvec2 normalBin = uvec2(clamp((unpackSnorm2x16(packNormalOct(normal)) * 0.5 + 0.5) * 4.0, vec2(0), vec2(3)));
+	uvec4 cellKey = uvec4(uvec3(cell), normalBin.y * 4 + normalBin.x);
+
+	bucket = reservoirCacheHash(cellKey) % RESERVOIR_CACHE_BUCKETS;
+	key = max(reservoirCacheHash(cellKey.yzwx + 0x9e3779b9u), 1u);
+}
+
+/// @brief Reservoir cached for the cell of the surface, false if there is none or it was written more than
+/// RestirConfig.ReservoirCacheMaxAge frames ago. A hit refreshes the entry for the LRU eviction.
+bool reservoirCacheLookup(vec3 pos, vec3 normal, out Reservoir res)
+{
+	uint bucket, key;
+	reservoirCacheKey(pos, normal, bucket, key);
+	for (uint way = 0; way < RESERVOIR_CACHE_WAYS; way++)
+	{
+		uint index = bucket * RESERVOIR_CACHE_WAYS + way;
+		if (reservoirCache.entries[index].key != key)
+		{
+			continue;
+		}
+		if (reservoirCacheStamp() - reservoirCache.entries[index].lastWrite > RestirConfig.ReservoirCacheMaxAge)
+		{
+			return false;
+		}
+		res = reservoirCache.entries[index].reservoir;
+		reservoirCache.entries[index].lastUsed = reservoirCacheStamp();
+		return true;
+	}
+	return false;
+}
+
+#endif // RESERVOIR_CACHE_GLSL
@@ -0,0 +1,48 @@
+#ifndef RESERVOIR_LAYOUT_GLSL
+#define RESERVOIR_LAYOUT_GLSL
+
+// Addressing of the per pixel reservoir buffers. Requires RestirConfig to be declared.
+// Mirrored on the CPU in reservoir_layout.hpp (buffer sizing), keep both in sync.
+
+#define RESERVOIR_LAYOUT_LINEAR 0
+#define RESERVOIR_LAYOUT_TILED 1
+#define RESERVOIR_TILE_SIZE 8
+
+// interleaves the lower 3 bits of x and y (x in even bits)
+uint mortonEncode3Bit(uvec2 p)
+{
+	uvec2 v = p & 7u;
+	v = (v | (v << 2)) & 0x33u;
+	v = (v | (v << 1)) & 0x55u;
+	return v.x | (v.y << 1);
+}
+
+uint reservoirIndexForWidth(uvec2 pixel, uint width)
+{
+	if (RestirConfig.ReservoirLayout == RESERVOIR_LAYOUT_TILED)
+	{
+		uint tilesPerRow = (width + RESERVOIR_TILE_SIZE - 1) / RESERVOIR_TILE_SIZE;
+		uvec2 tile = pixel / RESERVOIR_TILE_SIZE;
+		return (tile.y * tilesPerRow + tile.x) * (RESERVOIR_TILE_SIZE * RESERVOIR_TILE_SIZE) + mortonEncode3Bit(pixel);
+	}
+	return pixel.y * width + pixel.x;
+}
+
+/// @brief Index of the reservoir of a pixel. In tiled layout, 8x8 pixel blocks are stored contiguously (row major), Morton order inside the block.
+uint reservoirIndex(uvec2 pixel)
+{
+	return reservoirIndexForWidth(pixel, RestirConfig.ScreenSize.x);
+}
+
+/// @brief Index of a previous frame reservoir. pixel is in the current render space and rescaled if the render extent changed.
+uint prevReservoirIndex(uvec2 pixel)
+{
+	if (RestirConfig.PrevScreenSize != RestirConfig.ScreenSize)
+	{
+		vec2 scale = vec2(RestirConfig.PrevScreenSize) / vec2(RestirConfig.ScreenSize);
+		pixel = min(uvec2((vec2(pixel) + 0.5) * scale), RestirConfig.PrevScreenSize - 1);
+	}
+	return reservoirIndexForWidth(pixel, RestirConfig.PrevScreenSize.x);
+}
+
+#endif // RESERVOIR_LAYOUT_GLSL
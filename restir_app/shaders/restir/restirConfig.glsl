@@ -0,0 +1,73 @@
+#ifndef RESTIR_CONFIG_GLSL
+#define RESTIR_CONFIG_GLSL
+
+// Mirrors RestirStage::RestirConfiguration, shared by all ReSTIR passes (same binding in every pass)
+
+layout(binding = 11,  set = 0) readonly uniform RestirConfiguration
+{
+    /// @brief Current frames projection matrix
+    mat4   PrevFrameProjectionViewMatrix;
+    mat4   PrevFrameInverseProjectionViewMatrix;
+    mat4   InverseProjectionViewMatrix;
+    vec4   CameraPos;
+    uvec2  ScreenSize;
+    uint   ReservoirSize;
+    uint   Frame;
+    uint   InitialLightSampleCount;
+    uint   TemporalSampleCountMultiplier;
+    float  SpatialPosThreshold;
+    float  SpatialNormalThreshold;
+    uint   SpatialNeighbors;
+    float  SpatialRadius;
+    uint   Flags;
+	uint   NumTriLights;
+	uint   EnableTemporal;
+	uint   EnableSpatial;
+	uint   PackedGBuffer;
+	uint   SpatialReuseCompute;
+	uint   ReservoirLayout;
+	/// @brief ScreenSize is a reduced render extent, output goes to LowResOutput and is upsampled afterwards
+	uint   UpscaleOutput;
+	/// @brief Render extent of the previous frame (reservoir history)
+	uvec2  PrevScreenSize;
+	/// @brief Extent of the GBuffer and the final output
+	uvec2  OutputSize;
+	/// @brief Full ReSTIR update only for pixels with (x + y + Frame) even, the others re-shade their reprojected reservoir
+	uint   Checkerboard;
+	/// @brief Raygen accumulates a brute force reference instead of running ReSTIR (see raygen accumulateReference)
+	uint   ReferenceMode;
+	uint   ReferenceSamplesPerFrame;
+	/// @brief Frames already accumulated, 0 restarts the accumulation
+	uint   ReferenceFrameCount;
+	/// @brief Upper bound of M for reservoirs taken from the previous frame (temporal and spatial reuse)
+	uint   HistoryClamp;
+	/// @brief Max world space distance between the surface and its reprojection for temporal reuse
+	float  TemporalPosThreshold;
+	/// @brief Max squared length of the difference between the surface normal and its reprojection
+	float  TemporalNormalThreshold;
+	/// @brief Candidates are drawn from the per tile light lists (tileLights.glsl) instead of all lights
+	uint   TileLightCulling;
+	/// @brief Initial candidates traced by GGX sampling of the BRDF (brdfCandidate.rchit) out of InitialLightSampleCount
+	uint   BrdfCandidateCount;
+	/// @brief Per pixel candidate and neighbor budgets from the history confidence (adaptiveBudget.glsl)
+	uint   AdaptiveBudget;
+	/// @brief Upper bound of the mean budget weight, as a fraction of the fixed budget
+	float  AdaptiveBudgetCap;
+	/// @brief Budget weights of fully converged and of disoccluded pixels
+	float  AdaptiveBudgetMinWeight;
+	float  AdaptiveBudgetMaxWeight;
+	/// @brief Pixels without valid temporal history are seeded from the world space reservoir cache (reservoirCache.glsl)
+	uint   ReservoirCache;
+	/// @brief World space edge length of a cache cell
+	float  ReservoirCacheCellSize;
+	/// @brief Entries written longer ago are not used for seeding
+	uint   ReservoirCacheMaxAge;
+	/// @brief One bounce indirect light resampled with ReSTIR GI (restirGi.glsl), added to the direct light
+	uint   EnableGi;
+	/// @brief Previous frame GI reservoirs merged per pixel and their pixel radius
+	uint   GiSpatialNeighbors;
+	float  GiSpatialRadius;
+}
+RestirConfig;
+
+#endif // RESTIR_CONFIG_GLSL
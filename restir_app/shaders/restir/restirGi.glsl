@@ -0,0 +1,165 @@
+#ifndef RESTIR_GI_GLSL
+#define RESTIR_GI_GLSL
+
+// ReSTIR GI reservoirs of one bounce indirect light, see "ReSTIR GI: Path Resampling for Real-Time Path Tracing" (Ouyang et al. 2021).
+// A sample is the hit point of a BRDF sampled secondary ray together with the radiance leaving it towards the visible point.
+// The target function is the luminance of that radiance, it does not depend on the visible point, so neighbors only
+// reweight a reused sample by the Jacobian of the reconnection (giReuseJacobian). Requires brdf.glsl, lcrng.glsl and luminance().
+
+// reused samples with a Jacobian outside [1 / GI_MAX_JACOBIAN, GI_MAX_JACOBIAN] are rejected, they turn into fireflies
+#define GI_MAX_JACOBIAN 10.0
+// probability of sampling the GGX lobe on dielectrics, metals only sample GGX
+#define GI_SPECULAR_PROBABILITY 0.25
+
+struct GiReservoir
+{
+	/// @brief xyz = visible point the sample is relative to, w = unbiased contribution weight W (solid angle measure)
+	vec4 visiblePos_W;
+	/// @brief xyz = sample point (secondary hit), w = M
+	vec4 samplePos_M;
+	/// @brief xyz = sample point normal, w = sum of the resampling weights
+	vec4 sampleNormal_wSum;
+	/// @brief rgb = radiance leaving the sample point towards the visible point, a = target function of the sample
+	vec4 radiance_pHat;
+};
+
+GiReservoir newGiReservoir()
+{
+	GiReservoir res;
+	res.visiblePos_W = vec4(0);
+	res.samplePos_M = vec4(0);
+	res.sampleNormal_wSum = vec4(0);
+	res.radiance_pHat = vec4(0);
+	return res;
+}
+
+float giTargetFunction(vec3 radiance)
+{
+	return luminance(radiance);
+}
+
+/// @brief Probability of drawing the GGX lobe in giSampleDirection, the rest is cosine weighted for the diffuse lobe
+float giSpecularProbability(float metallic)
+{
+	return mix(GI_SPECULAR_PROBABILITY, 1.0, metallic);
+}
+
+vec3 sampleCosineHemisphere(vec3 normal, float r1, float r2)
+{
+	float sinTheta = sqrt(r1);
+	float phi = 2.0 * M_PI * r2;
+	vec3 tangent = normalize(cross(normal, abs(normal.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0)));
+	vec3 bitangent = cross(normal, tangent);
+	return normalize(normal * sqrt(max(1.0 - r1, 0.0)) + (tangent * cos(phi) + bitangent * sin(phi)) * sinTheta);
+}
+
+/// @brief Secondary ray direction from a mixture of the GGX and the cosine lobe, may point below the surface
+vec3 giSampleDirection(vec3 normal, vec3 wo, float alpha, float specularProbability, inout uint randomSeed)
+{
+	randomSeed++;
+	float lobe = lcgFloat(randomSeed);
+	float r1 = lcgFloat(randomSeed);
+	float r2 = lcgFloat(randomSeed);
+	if (lobe < specularProbability)
+	{
+		return sampleGGXReflection(normal, wo, alpha, r1, r2);
+	}
+	return sampleCosineHemisphere(normal, r1, r2);
+}
+
+/// @brief Solid angle pdf of giSampleDirection, 0 below the surface
+float giDirectionPdf(vec3 normal, vec3 wo, vec3 wi, float alpha, float specularProbability)
+{
+	float cosIn = dot(normal, wi);
+	if (cosIn <= 0.0)
+	{
+		return 0.0;
+	}
+	return specularProbability * ggxReflectionPdf(normal, wo, wi, alpha) + (1.0 - specularProbability) * cosIn / M_PI;
+}
+
+/// @brief Streams a sample with resampling weight `weight` standing for `m` candidates into the reservoir. Returns true if it was selected.
+bool giReservoirUpdate(inout GiReservoir res, vec3 samplePos, vec3 sampleNormal, vec3 radiance, float pHat, float weight, float m, inout uint randomSeed)
+{
+	res.sampleNormal_wSum.w += weight;
+	res.samplePos_M.w += m;
+	randomSeed++;
+	if (weight > 0.0 && lcgFloat(randomSeed) * res.sampleNormal_wSum.w < weight)
+	{
+		res.samplePos_M.xyz = samplePos;
+		res.sampleNormal_wSum.xyz = sampleNormal;
+		res.radiance_pHat = vec4(radiance, pHat);
+		return true;
+	}
+	return false;
+}
+
+/// @brief Jacobian of reusing the sample of `other` at the visible point pos: |cos phi_pos| / |cos phi_other| * d_other^2 / d_pos^2,
+/// with phi the angle at the sample point and d the distance to the respective visible point. 0 if the sample lies below
+/// the surface at pos or the Jacobian is out of bounds.
+float giReuseJacobian(GiReservoir other, vec3 pos, vec3 normal)
+{
+	vec3 toPos = pos - other.samplePos_M.xyz;
+	vec3 toOther = other.visiblePos_W.xyz - other.samplePos_M.xyz;
+	if (dot(toPos, normal) >= 0.0)
+	{
+		return 0.0;
+	}
+
+	float posDistSquared = dot(toPos, toPos);
+	float otherDistSquared = dot(toOther, toOther);
+	vec3 sampleNormal = other.sampleNormal_wSum.xyz;
+	float cosOther = abs(dot(sampleNormal, toOther)) * inversesqrt(max(otherDistSquared, 1e-12));
+	if (cosOther <= 0.0 || posDistSquared <= 0.0)
+	{
+		return 0.0;
+	}
+	float cosPos = abs(dot(sampleNormal, toPos)) * inversesqrt(posDistSquared);
+
+	float jacobian = (cosPos / cosOther) * (otherDistSquared / posDistSquared);
+	if (jacobian > GI_MAX_JACOBIAN || jacobian < 1.0 / GI_MAX_JACOBIAN)
+	{
+		return 0.0;
+	}
+	return jacobian;
+}
+
+/// @brief Merges the reservoir of another visible point, jacobian from giReuseJacobian. Returns true if its sample was selected.
+bool giCombineReservoirs(inout GiReservoir res, GiReservoir other, float jacobian, inout uint randomSeed)
+{
+	float pHat = giTargetFunction(other.radiance_pHat.rgb);
+	float weight = pHat * other.visiblePos_W.w * other.samplePos_M.w * jacobian;
+	return giReservoirUpdate(res, other.samplePos_M.xyz, other.sampleNormal_wSum.xyz, other.radiance_pHat.rgb, pHat, weight, other.samplePos_M.w, randomSeed);
+}
+
+/// @brief Computes W for the selected sample, which is now relative to the visible point pos
+void giReservoirFinalize(inout GiReservoir res, vec3 pos)
+{
+	res.visiblePos_W.xyz = pos;
+	float denominator = res.samplePos_M.w * res.radiance_pHat.a;
+	res.visiblePos_W.w = denominator > 0.0 ? res.sampleNormal_wSum.w / denominator : 0.0;
+}
+
+/// @brief Indirect light leaving the visible point towards the camera, BRDF * cos * radiance * W. Emissive surfaces are
+/// shown with their own color (shadeSurface) and get no indirect light either.
+vec3 shadeGiReservoir(GiReservoir res, vec3 pos, vec3 normal, vec3 cameraPos, vec3 albedo, MaterialBufferObject surfaceMaterial)
+{
+	if (dot(surfaceMaterial.EmissiveFactor, surfaceMaterial.EmissiveFactor) > 0 || res.visiblePos_W.w <= 0.0)
+	{
+		return vec3(0);
+	}
+
+	vec3 wi = normalize(res.samplePos_M.xyz - pos);
+	vec3 wo = normalize(cameraPos - pos);
+	float cosIn = dot(normal, wi);
+	if (cosIn <= 0.0)
+	{
+		return vec3(0);
+	}
+	float cosOut = dot(normal, wo);
+	vec3 halfVec = normalize(wi + wo);
+	vec3 brdf = disneyBrdfColor(cosIn, cosOut, dot(normal, halfVec), dot(wi, halfVec), albedo, surfaceMaterial.RoughnessFactor, surfaceMaterial.MetallicFactor);
+	return brdf * cosIn * res.radiance_pHat.rgb * res.visiblePos_W.w;
+}
+
+#endif // RESTIR_GI_GLSL
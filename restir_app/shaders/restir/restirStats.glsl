@@ -0,0 +1,107 @@
+#ifndef RESTIR_STATS_GLSL
+#define RESTIR_STATS_GLSL
+
+// Optional ReSTIR statistics counters (RestirStatistics on the host, counter indices mirror RestirStatistics::ECounter).
+// Compiled in with the RESTIR_STATS definition. Every invocation counts into private registers, main() reduces them
+// per subgroup once at the end and a single lane adds the sums to the global counters. Without SUBGROUP_REDUCE
+// (no subgroup arithmetic in the ray generation stage) every invocation adds its nonzero counters itself.
+
+#define STAT_PIXELS 0
+#define STAT_INVALID_PIXELS 1
+#define STAT_CHECKERBOARD_REUSED 2
+#define STAT_TEMPORAL_CANDIDATES 3
+#define STAT_TEMPORAL_ACCEPTED 4
+#define STAT_TEMPORAL_REJECT_OFFSCREEN 5
+#define STAT_TEMPORAL_REJECT_POSITION 6
+#define STAT_TEMPORAL_REJECT_NORMAL 7
+#define STAT_TEMPORAL_DISCARDED 8
+#define STAT_HISTORY_CLAMPED 9
+#define STAT_SPATIAL_CANDIDATES 10
+#define STAT_SPATIAL_ACCEPTED 11
+#define STAT_SPATIAL_REJECT_INVALID 12
+#define STAT_SPATIAL_REJECT_POSITION 13
+#define STAT_SPATIAL_REJECT_NORMAL 14
+#define STAT_SAMPLES 15
+#define STAT_SAMPLES_INVALID 16
+#define STAT_SHADOW_RAYS 17
+// directly after the shadow rays, so all traced rays are one range of counters
+#define STAT_BRDF_CANDIDATE_RAYS 18
+#define STAT_GI_RAYS 19
+#define STAT_SHADOW_RAYS_OCCLUDED 20
+// tile light culling, counted per tile with surfaces by tileLightCulling.comp
+#define STAT_TILES 21
+#define STAT_TILE_CANDIDATE_LIGHTS 22
+#define STAT_TILE_OVERFLOW 23
+// initial candidates of the fully updated pixels (varies per pixel with the adaptive budget)
+#define STAT_INITIAL_CANDIDATES 24
+// world space reservoir cache: lookups and hits in raygen, inserts and evictions by reservoirCacheUpdate.comp,
+// which also reports the entries in use once per frame
+#define STAT_CACHE_LOOKUPS 25
+#define STAT_CACHE_HITS 26
+#define STAT_CACHE_INSERTS 27
+#define STAT_CACHE_EVICTIONS 28
+#define STAT_CACHE_USED_ENTRIES 29
+// ReSTIR GI: reused reservoirs (temporal and spatial) and those rejected for their Jacobian or a sample below the surface
+#define STAT_GI_REUSED 30
+#define STAT_GI_REJECT_JACOBIAN 31
+// 16 bins over the M (numStreamSamples) of the final reservoir: bin 0 = 0, bin b = [2^(b-1), 2^b), last bin open ended
+#define STAT_M_HISTOGRAM 32
+#define STAT_M_HISTOGRAM_BINS 16
+#define STAT_COUNT (STAT_M_HISTOGRAM + STAT_M_HISTOGRAM_BINS)
+
+#ifdef RESTIR_STATS
+
+#ifdef SUBGROUP_REDUCE
+#extension GL_KHR_shader_subgroup_basic : enable
+#extension GL_KHR_shader_subgroup_arithmetic : enable
+#endif
+
+layout(set = 0, binding = 24) buffer RestirStatsBuffer { uint counters[STAT_COUNT]; } restirStats;
+
+uint gStats[STAT_COUNT];
+
+#define STATS_ADD(counter, value) gStats[counter] += uint(value)
+
+void statsInit()
+{
+	for (int i = 0; i < STAT_COUNT; i++)
+	{
+		gStats[i] = 0;
+	}
+}
+
+void statsRecordM(uint m)
+{
+	gStats[STAT_M_HISTOGRAM + min(findMSB(m) + 1, STAT_M_HISTOGRAM_BINS - 1)]++;
+}
+
+// call from uniform control flow (end of main)
+void statsFlush()
+{
+	for (int i = 0; i < STAT_COUNT; i++)
+	{
+#ifdef SUBGROUP_REDUCE
+		uint total = subgroupAdd(gStats[i]);
+		if (subgroupElect() && total > 0)
+		{
+			atomicAdd(restirStats.counters[i], total);
+		}
+#else
+		if (gStats[i] > 0)
+		{
+			atomicAdd(restirStats.counters[i], gStats[i]);
+		}
+#endif
+	}
+}
+
+#else
+
+#define STATS_ADD(counter, value)
+void statsInit() {}
+void statsRecordM(uint m) {}
+void statsFlush() {}
+
+#endif // RESTIR_STATS
+
+#endif // RESTIR_STATS_GLSL
@@ -0,0 +1,51 @@
+#ifndef SHADING_GLSL
+#define SHADING_GLSL
+
+// Final shading of a pixel from its reservoir. Requires the TriLights buffer to be declared.
+
+/// @brief Shades a surface lit by light samples with average target function pHat and average emission color
+vec4 shadeSurface(vec3 albedo, MaterialBufferObject surfaceMaterial, float pHat, vec3 lightEmissionColor)
+{
+	vec4 finalColor;
+
+	// emissive surfaces have their albedo as color
+	if(dot(surfaceMaterial.EmissiveFactor,surfaceMaterial.EmissiveFactor) > 0)
+	{
+		// for emissive surfaces use surface albedo or material emissive factor
+		finalColor = vec4( albedo, 1.0f);
+		if(dot(albedo,albedo) <= 0)
+			finalColor = vec4( surfaceMaterial.EmissiveFactor, 1.0f);
+	}
+	else // surface is not emissive => shade surface
+	{
+		finalColor = vec4( albedo * vec3(pHat) , 1.0f);
+		finalColor *= 50; // increase lighting power
+	}
+
+	// no additional lighting on surfaces that are emissive -> that looks kinda bad.
+	if(dot(surfaceMaterial.EmissiveFactor, surfaceMaterial.EmissiveFactor) <= 0)
+		finalColor *= vec4(lightEmissionColor, 1);
+
+	return finalColor;
+}
+
+vec4 shadeReservoir(Reservoir res, vec3 albedo, MaterialBufferObject surfaceMaterial)
+{
+	vec3 lightEmissionColor = vec3(0);
+	float totalpHat = 0;
+	for (int i = 0; i < RESERVOIR_SIZE; i++)
+	{
+		// emission color folded into the light record
+		uint lightIndex = res.samples[i].lightIndex;
+		lightEmissionColor += triLightEmission(triLights.triLights[lightIndex]);
+
+		// add sample brightness
+		totalpHat += res.samples[i].pHat;
+	}
+	lightEmissionColor /= RESERVOIR_SIZE;
+	totalpHat /= RESERVOIR_SIZE;
+
+	return shadeSurface(albedo, surfaceMaterial, totalpHat, lightEmissionColor);
+}
+
+#endif // SHADING_GLSL
@@ -0,0 +1,44 @@
+#ifndef TILELIGHTS_GLSL
+#define TILELIGHTS_GLSL
+
+// Per screen tile light lists built by tileLightCulling.comp. Requires RestirConfig to be declared.
+// TILE_LIGHT_SIZE and TILE_LIGHT_CAPACITY are defined by the application (TileLightCulling).
+// A tile stores the number of lights that can contribute to any of its pixels and the first TILE_LIGHT_CAPACITY
+// of their indices, tiles with more lights fall back to the global list.
+
+#ifndef TILE_LIGHT_SIZE
+#define TILE_LIGHT_SIZE 16
+#endif
+#ifndef TILE_LIGHT_CAPACITY
+#define TILE_LIGHT_CAPACITY 512
+#endif
+
+layout(set = 0, binding = 25) buffer TileLightCounts{ uint counts[]; } tileLightCounts;
+layout(set = 0, binding = 26) buffer TileLightIndices{ uint indices[]; } tileLightIndices;
+
+uint tileLightTileCountX()
+{
+	return (RestirConfig.ScreenSize.x + TILE_LIGHT_SIZE - 1) / TILE_LIGHT_SIZE;
+}
+
+/// @brief Tile of a render space pixel
+uint tileLightTile(uvec2 renderPixel)
+{
+	uvec2 tile = renderPixel / TILE_LIGHT_SIZE;
+	return tile.y * tileLightTileCountX() + tile.x;
+}
+
+/// @brief Number of candidate lights of the tile and whether they are read from the tile list (false: global list)
+uint tileLightCandidateCount(uint tile, out bool useTileList)
+{
+	uint count = tileLightCounts.counts[tile];
+	useTileList = count <= TILE_LIGHT_CAPACITY;
+	return useTileList ? count : RestirConfig.NumTriLights;
+}
+
+uint tileLightIndex(uint tile, uint slot)
+{
+	return tileLightIndices.indices[tile * TILE_LIGHT_CAPACITY + slot];
+}
+
+#endif // TILELIGHTS_GLSL
@@ -0,0 +1,47 @@
+#ifndef TRILIGHTS_GLSL
+#define TRILIGHTS_GLSL
+
+#include "packing.glsl"
+
+// 32 byte light record, packed by tri_light::Pack on upload. Emission is folded in, so sampling does not touch the material buffer.
+struct TriLight
+{
+	vec3  p1;
+	uint  normal;   // octahedral, packNormalOct
+	uvec3 edges;    // p2 - p1 and p3 - p1 as six half floats
+	uint  emission; // shared exponent rgb9e5, EmissiveFactor of the material
+};
+
+layout(std140, set = 0, binding = 16) buffer TriLights{ TriLight triLights[]; } triLights;
+
+void triLightVertices(TriLight light, out vec3 p1, out vec3 p2, out vec3 p3)
+{
+	vec2 e0 = unpackHalf2x16(light.edges.x);
+	vec2 e1 = unpackHalf2x16(light.edges.y);
+	vec2 e2 = unpackHalf2x16(light.edges.z);
+	p1 = light.p1;
+	p2 = p1 + vec3(e0.xy, e1.x);
+	p3 = p1 + vec3(e1.y, e2.xy);
+}
+
+vec3 triLightNormal(TriLight light)
+{
+	return unpackNormalOct(light.normal);
+}
+
+float triLightArea(TriLight light)
+{
+	vec3 p1, p2, p3;
+	triLightVertices(light, p1, p2, p3);
+	return 0.5 * length(cross(p2 - p1, p3 - p1));
+}
+
+/// @brief Decodes 9 bit mantissas with a shared 5 bit exponent (bias 15), see tri_light::PackRgb9e5
+vec3 triLightEmission(TriLight light)
+{
+	uint e = light.emission;
+	float scale = exp2(float(int(e >> 27u) - 15 - 9));
+	return vec3(float(e & 0x1FFu), float((e >> 9u) & 0x1FFu), float((e >> 18u) & 0x1FFu)) * scale;
+}
+
+#endif // TRILIGHTS_GLSL
@@ -3,23 +3,22 @@
 #include <glm/glm.hpp>
 
 namespace shader {
-    using vec4 = glm::vec4;
-    using uint = uint32_t;
+    using vec3  = glm::vec3;
+    using uvec3 = glm::uvec3;
+    using uint  = uint32_t;
 
 #endif
 
+    /// @brief Emissive triangle, 32 bytes. Packed and unpacked by tri_light_packing.hpp, mirrors shaders/restir/triLights.glsl.
     struct TriLight
     {
-        vec4  p1;
-        vec4  p2;
-        vec4  p3;
-        vec4  normal;
-        uint  materialIndex;
-        uint  reserved1;
-        uint  reserved2;
-        uint  reserved3;
+        vec3  p1;
+        uint  normal;    // octahedral, two snorm16
+        uvec3 edges;     // p2 - p1 and p3 - p1 as six half floats
+        uint  emission;  // rgb9e5 emissive factor
     };
 
 #ifdef __cplusplus
+    static_assert(sizeof(TriLight) == 32, "TriLight must match the std140 layout in triLights.glsl");
 }
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,65 @@
+#include "tile_light_culling.hpp"
+
+void TileLightCulling::Create(foray::core::Context* context)
+{
+    mContext = context;
+    CreateBuffers();
+}
+
+void TileLightCulling::Resize()
+{
+    DestroyBuffers();
+    CreateBuffers();
+}
+
+void TileLightCulling::CreateBuffers()
+{
+    VkExtent2D   size      = mContext->GetSwapchainSize();
+    VkDeviceSize tileCount = (VkDeviceSize)((size.width + TILE_SIZE - 1) / TILE_SIZE) * ((size.height + TILE_SIZE - 1) / TILE_SIZE);
+    mTileLightCounts.Create(mContext, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, tileCount * sizeof(uint32_t), VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0, "TileLightCounts");
+    mTileLightIndices.Create(mContext, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, tileCount * CAPACITY * sizeof(uint32_t), VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0,
+                             "TileLightIndices");
+}
+
+void TileLightCulling::DestroyBuffers()
+{
+    mTileLightCounts.Destroy();
+    mTileLightIndices.Destroy();
+}
+
+void TileLightCulling::CreatePipeline(const std::vector<VkDescriptorSetLayout>& descriptorSetLayouts, const std::unordered_map<std::string, std::string>& definitions)
+{
+    mCullPass.Create(mContext, CULL_FILE, descriptorSetLayouts, 0, "TileLightCulling", definitions);
+}
+
+void TileLightCulling::DestroyPipeline()
+{
+    mCullPass.Destroy();
+}
+
+void TileLightCulling::AddShaderDefinitions(std::unordered_map<std::string, std::string>& definitions)
+{
+    definitions["TILE_LIGHT_SIZE"]     = std::to_string(TILE_SIZE);
+    definitions["TILE_LIGHT_CAPACITY"] = std::to_string(CAPACITY);
+}
+
+void TileLightCulling::CmdCull(VkCommandBuffer cmdBuffer, const std::vector<VkDescriptorSet>& descriptorSets, VkExtent2D renderExtent)
+{
+    // gbuffer, packed gbuffer and the config ubo are read in compute, last frames raygen may still read the tile lists
+    VkMemoryBarrier readBarrier{.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                .srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT,
+                                .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &readBarrier, 0, nullptr, 0, nullptr);
+
+    mCullPass.CmdBind(cmdBuffer, descriptorSets);
+    mCullPass.CmdDispatch(cmdBuffer, renderExtent, glm::uvec2(TILE_SIZE, TILE_SIZE));
+
+    VkMemoryBarrier writeBarrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER, .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT, .dstAccessMask = VK_ACCESS_SHADER_READ_BIT};
+    vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, 0, 1, &writeBarrier, 0, nullptr, 0, nullptr);
+}
+
+void TileLightCulling::Destroy()
+{
+    DestroyPipeline();
+    DestroyBuffers();
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "compute_pass.hpp"
+#include <foray_api.hpp>
+#include <string>
+#include <unordered_map>
+
+/// @brief Per screen tile light lists for the ReSTIR candidate generation (tileLightCulling.comp, tileLights.glsl).
+/// A tile keeps the lights that can give a nonzero candidate weight to any of its surfaces, judged from the world space bounds
+/// and the normal cone of the tile's GBuffer against each light's bounds and orientation.
+/// The buffers are allocated for the output extent, the pass only fills the tiles of the current render extent.
+class TileLightCulling
+{
+  public:
+    static constexpr uint32_t TILE_SIZE = 16;
+    /// @brief Light indices stored per tile, tiles with more lights fall back to the global list
+    static constexpr uint32_t CAPACITY = 512;
+
+    void Create(foray::core::Context* context);
+    /// @brief Reallocates the tile buffers for the new output extent, the descriptor sets referencing them have to be updated
+    void Resize();
+    void Destroy();
+    inline bool Exists() const { return mTileLightCounts.Exists(); }
+
+    /// @brief Builds the pipeline. Set 0 provides the bindings of tileLightCulling.comp (ReSTIR config, GBuffer, lights, tile buffers).
+    void CreatePipeline(const std::vector<VkDescriptorSetLayout>& descriptorSetLayouts, const std::unordered_map<std::string, std::string>& definitions);
+    void DestroyPipeline();
+    inline uint64_t GetShaderKey() const { return mCullPass.GetShaderKey(); }
+
+    /// @brief TILE_LIGHT_SIZE and TILE_LIGHT_CAPACITY for every shader including tileLights.glsl
+    static void AddShaderDefinitions(std::unordered_map<std::string, std::string>& definitions);
+
+    /// @brief Fills the tile lists of renderExtent and makes them readable for the raygen shader. GBuffer, packed GBuffer and
+    /// ReSTIR config have to be written before.
+    void CmdCull(VkCommandBuffer cmdBuffer, const std::vector<VkDescriptorSet>& descriptorSets, VkExtent2D renderExtent);
+
+    /// @brief Bound at set 0 bindings 25 and 26
+    inline foray::core::ManagedBuffer& GetTileLightCounts() { return mTileLightCounts; }
+    inline foray::core::ManagedBuffer& GetTileLightIndices() { return mTileLightIndices; }
+
+  protected:
+    void CreateBuffers();
+    void DestroyBuffers();
+
+    static inline const std::string CULL_FILE = "shaders/restir/tileLightCulling.comp";
+
+    foray::core::Context*      mContext{};
+    foray::core::ManagedBuffer mTileLightCounts;
+    foray::core::ManagedBuffer mTileLightIndices;
+    ComputePass                mCullPass;
+};
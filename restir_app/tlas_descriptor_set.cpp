@@ -0,0 +1,49 @@
+#include "tlas_descriptor_set.hpp"
+
+void TlasDescriptorSet::Create(foray::core::Context* context, VkAccelerationStructureKHR tlas, VkShaderStageFlags stages)
+{
+    mContext = context;
+
+    VkDescriptorSetLayoutBinding binding{.binding = 0, .descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, .descriptorCount = 1, .stageFlags = stages};
+    VkDescriptorSetLayoutCreateInfo layoutCi{.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO, .bindingCount = 1, .pBindings = &binding};
+    foray::AssertVkResult(vkCreateDescriptorSetLayout(mContext->Device(), &layoutCi, nullptr, &mDescriptorSetLayout));
+
+    VkDescriptorPoolSize       poolSize{.type = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, .descriptorCount = 1};
+    VkDescriptorPoolCreateInfo poolCi{.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO, .maxSets = 1, .poolSizeCount = 1, .pPoolSizes = &poolSize};
+    foray::AssertVkResult(vkCreateDescriptorPool(mContext->Device(), &poolCi, nullptr, &mDescriptorPool));
+
+    VkDescriptorSetAllocateInfo allocInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO, .descriptorPool = mDescriptorPool, .descriptorSetCount = 1, .pSetLayouts = &mDescriptorSetLayout};
+    foray::AssertVkResult(vkAllocateDescriptorSets(mContext->Device(), &allocInfo, &mDescriptorSet));
+
+    Update(tlas);
+}
+
+void TlasDescriptorSet::Update(VkAccelerationStructureKHR tlas)
+{
+    VkWriteDescriptorSetAccelerationStructureKHR asWrite{
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR, .accelerationStructureCount = 1, .pAccelerationStructures = &tlas};
+    VkWriteDescriptorSet write{.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                               .pNext           = &asWrite,
+                               .dstSet          = mDescriptorSet,
+                               .dstBinding      = 0,
+                               .descriptorCount = 1,
+                               .descriptorType  = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR};
+    vkUpdateDescriptorSets(mContext->Device(), 1, &write, 0, nullptr);
+}
+
+void TlasDescriptorSet::Destroy()
+{
+    if(mDescriptorPool != nullptr)
+    {
+        // frees the set as well
+        vkDestroyDescriptorPool(mContext->Device(), mDescriptorPool, nullptr);
+        mDescriptorPool = nullptr;
+        mDescriptorSet  = nullptr;
+    }
+    if(mDescriptorSetLayout != nullptr)
+    {
+        vkDestroyDescriptorSetLayout(mContext->Device(), mDescriptorSetLayout, nullptr);
+        mDescriptorSetLayout = nullptr;
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <foray_api.hpp>
+
+/// @brief Single binding descriptor set holding the scene TLAS, for compute passes tracing inline rays (GL_EXT_ray_query).
+/// Declare in GLSL as layout(set = N, binding = 0) uniform accelerationStructureEXT
+class TlasDescriptorSet
+{
+  public:
+    void Create(foray::core::Context* context, VkAccelerationStructureKHR tlas, VkShaderStageFlags stages = VK_SHADER_STAGE_COMPUTE_BIT);
+    /// @brief Rewrites the binding, only call while no command buffer using the set is pending
+    void Update(VkAccelerationStructureKHR tlas);
+    void Destroy();
+    inline bool Exists() const { return mDescriptorSet != nullptr; }
+
+    inline VkDescriptorSetLayout GetDescriptorSetLayout() const { return mDescriptorSetLayout; }
+    inline VkDescriptorSet       GetDescriptorSet() const { return mDescriptorSet; }
+
+  protected:
+    foray::core::Context* mContext             = nullptr;
+    VkDescriptorSetLayout mDescriptorSetLayout = nullptr;
+    VkDescriptorPool      mDescriptorPool      = nullptr;
+    VkDescriptorSet       mDescriptorSet       = nullptr;
+};
@@ -0,0 +1,67 @@
+#include "tri_light_packing.hpp"
+#include "float_image.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace tri_light {
+    uint32_t lPackSnorm16(float value)
+    {
+        return (uint32_t)(uint16_t)(int16_t)std::round(std::clamp(value, -1.f, 1.f) * 32767.f);
+    }
+
+    uint32_t PackNormalOct(glm::vec3 normal)
+    {
+        normal /= std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+        glm::vec2 oct(normal.x, normal.y);
+        if(normal.z < 0.f)
+        {
+            oct = (1.f - glm::abs(glm::vec2(normal.y, normal.x))) * glm::vec2(normal.x >= 0.f ? 1.f : -1.f, normal.y >= 0.f ? 1.f : -1.f);
+        }
+        return lPackSnorm16(oct.x) | (lPackSnorm16(oct.y) << 16);
+    }
+
+    uint32_t PackRgb9e5(const glm::vec3& color)
+    {
+        constexpr int   MANTISSA_BITS = 9;
+        constexpr int   EXPONENT_BIAS = 15;
+        constexpr float MAX_VALUE     = (511.f / 512.f) * 65536.f;
+
+        glm::vec3 clamped  = glm::clamp(color, glm::vec3(0.f), glm::vec3(MAX_VALUE));
+        float     maxValue = std::max(clamped.x, std::max(clamped.y, clamped.z));
+        int exponent = std::max(-EXPONENT_BIAS - 1, maxValue > 0.f ? (int)std::floor(std::log2(maxValue)) : -EXPONENT_BIAS - 1) + 1 + EXPONENT_BIAS;
+        if(std::floor(maxValue / std::exp2((float)(exponent - EXPONENT_BIAS - MANTISSA_BITS)) + 0.5f) >= (float)(1 << MANTISSA_BITS))
+        {
+            // rounding overflowed the mantissa
+            exponent++;
+        }
+
+        float    scale = std::exp2((float)(exponent - EXPONENT_BIAS - MANTISSA_BITS));
+        uint32_t r     = std::min((uint32_t)std::floor(clamped.x / scale + 0.5f), 511u);
+        uint32_t g     = std::min((uint32_t)std::floor(clamped.y / scale + 0.5f), 511u);
+        uint32_t b     = std::min((uint32_t)std::floor(clamped.z / scale + 0.5f), 511u);
+        return r | (g << 9) | (b << 18) | ((uint32_t)exponent << 27);
+    }
+
+    shader::TriLight Pack(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, const glm::vec3& normal, const glm::vec3& emission)
+    {
+        glm::vec3 e0 = p2 - p1;
+        glm::vec3 e1 = p3 - p1;
+
+        shader::TriLight light;
+        light.p1       = p1;
+        light.normal   = PackNormalOct(normal);
+        light.edges.x  = FloatToHalf(e0.x) | ((uint32_t)FloatToHalf(e0.y) << 16);
+        light.edges.y  = FloatToHalf(e0.z) | ((uint32_t)FloatToHalf(e1.x) << 16);
+        light.edges.z  = FloatToHalf(e1.y) | ((uint32_t)FloatToHalf(e1.z) << 16);
+        light.emission = PackRgb9e5(emission);
+        return light;
+    }
+
+    void UnpackVertices(const shader::TriLight& light, glm::vec3& p1, glm::vec3& p2, glm::vec3& p3)
+    {
+        auto half = [&light](uint32_t index) { return HalfToFloat((uint16_t)(light.edges[index / 2] >> (16 * (index % 2)))); };
+        p1        = light.p1;
+        p2        = p1 + glm::vec3(half(0), half(1), half(2));
+        p3        = p1 + glm::vec3(half(3), half(4), half(5));
+    }
+}  // namespace tri_light
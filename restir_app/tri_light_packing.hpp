@@ -0,0 +1,15 @@
+#pragma once
+#include "structs.hpp"
+
+/// @brief Encoding of the compact shader::TriLight record, the decoding counterparts live in shaders/restir/triLights.glsl
+namespace tri_light {
+    /// @brief p1 is kept at full precision, the edges are stored as half floats relative to it
+    shader::TriLight Pack(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, const glm::vec3& normal, const glm::vec3& emission);
+
+    void UnpackVertices(const shader::TriLight& light, glm::vec3& p1, glm::vec3& p2, glm::vec3& p3);
+
+    /// @brief Octahedral encoding into two snorm16 (packSnorm2x16 layout)
+    uint32_t PackNormalOct(glm::vec3 normal);
+    /// @brief Three 9 bit mantissas with a shared 5 bit exponent, values clamped to [0, 65408] (EXT_texture_shared_exponent)
+    uint32_t PackRgb9e5(const glm::vec3& color);
+}  // namespace tri_light
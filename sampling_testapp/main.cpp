@@ -2,15 +2,112 @@
 #include <foray_basics.hpp>
 #include <foray_logger.hpp>
 #include <osi/foray_env.hpp>
+#include <algorithm>
 #include <vector>
 
 namespace sampling_testapp {
 
+    /// @brief Comma separated list of brdf, light, uniform, cosine
+    uint32_t ParseStrategies(const std::string& value)
+    {
+        uint32_t strategies = 0;
+        size_t   begin      = 0;
+        while(begin <= value.size())
+        {
+            size_t      end  = std::min(value.find(',', begin), value.size());
+            std::string name = value.substr(begin, end - begin);
+            if(name == "brdf")
+            {
+                strategies |= SAMPLE_BRDF;
+            }
+            else if(name == "light")
+            {
+                strategies |= SAMPLE_LIGHT;
+            }
+            else if(name == "uniform")
+            {
+                strategies |= SAMPLE_UNIFORM;
+            }
+            else if(name == "cosine")
+            {
+                strategies |= SAMPLE_COSINE;
+            }
+            else
+            {
+                foray::logger()->warn("Unknown sampling strategy \"{}\"", name);
+            }
+            begin = end + 1;
+        }
+        return strategies;
+    }
+
+    /// @brief --capture exr|png [--capture-frames N | --capture-every N] starts a capture with the first frame,
+    /// --strategies brdf,light,uniform,cosine, --samples N and --mis 0|1 select the sampling compiled into the closest hit shader,
+    /// --benchmark <prefix> [--benchmark-warmup N --benchmark-frames N --benchmark-accumulate 0|1] measures and quits
+    void ParseArgs(std::vector<std::string>& args, SamplingTestApp& app)
+    {
+        std::optional<FrameCapture::Settings> capture;
+        SamplingSettings                      sampling;
+        BenchmarkRun::Settings                benchmark;
+        for(size_t i = 1; i + 1 < args.size(); i += 2)
+        {
+            const std::string& value = args[i + 1];
+            if(args[i].rfind("--capture", 0) == 0 && !capture.has_value())
+            {
+                capture = FrameCapture::Settings{};
+            }
+            try
+            {
+                if(args[i] == "--capture")
+                {
+                    capture->Format = value == "png" ? FrameCapture::EFileFormat::Png : FrameCapture::EFileFormat::Exr;
+                }
+                else if(args[i] == "--capture-frames")
+                {
+                    capture->SequenceLength = (uint32_t)std::stoul(value);
+                    capture->Mode           = FrameCapture::EMode::Sequence;
+                }
+                else if(args[i] == "--capture-every")
+                {
+                    capture->Interval = (uint32_t)std::stoul(value);
+                    capture->Mode     = FrameCapture::EMode::EveryNth;
+                }
+                else if(args[i] == "--strategies")
+                {
+                    sampling.Strategies = ParseStrategies(value);
+                }
+                else if(args[i] == "--samples")
+                {
+                    sampling.SampleCount = (uint32_t)std::stoul(value);
+                }
+                else if(args[i] == "--mis")
+                {
+                    sampling.Mis = value != "0";
+                }
+                else if(!BenchmarkRun::ParseArgument(args[i], value, benchmark))
+                {
+                    foray::logger()->warn("Unknown argument \"{}\"", args[i]);
+                }
+            }
+            catch(const std::exception&)
+            {
+                // the setting is only assigned after its value parsed
+                foray::logger()->warn("{}: \"{}\" is not a number, keeping the default", args[i], value);
+            }
+        }
+        if(capture.has_value())
+        {
+            app.SetStartupCapture(capture.value());
+        }
+        app.SetSamplingSettings(sampling);
+        app.SetBenchmarkRun(benchmark);
+    }
 
     int example(std::vector<std::string>& args)
     {
         foray::osi::OverrideCurrentWorkingDirectory(CWD_OVERRIDE);
         SamplingTestApp app;
+        ParseArgs(args, app);
         return app.Run();
     }
 }  // namespace sampling_testapp
@@ -1,20 +1,33 @@
 #include "sampling_testapp.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <scene/components/foray_node_components.hpp>
+#include <scene/foray_mesh.hpp>
+#include <scene/globalcomponents/foray_materialmanager.hpp>
 
 namespace sampling_testapp {
-    void SamplingTestStage::Init(foray::core::Context* context, foray::scene::Scene* scene)
+    void SamplingTestStage::Init(foray::core::Context* context, foray::scene::Scene* scene, const SamplingSettings& settings)
     {
+        mSettings     = settings;
         mLightManager = scene->GetComponent<foray::scene::gcomp::LightManager>();
+        CollectLights(scene);
         foray::stages::DefaultRaytracingStageBase::Init(context, scene);
     }
 
     void SamplingTestStage::Destroy()
     {
         mLights.Destroy();
+        mRayCounter.Destroy();
     }
 
     void SamplingTestStage::ApiCreateRtPipeline()
     {
-        foray::core::ShaderCompilerConfig options{.IncludeDirs = {FORAY_SHADER_DIR}};
+        // strategies are compile time constants, the shader compiler drops the rays of unselected strategies
+        foray::core::ShaderCompilerConfig options{.IncludeDirs = {FORAY_SHADER_DIR},
+                                                  .Definitions = {{"SAMPLE_STRATEGIES", std::to_string(mSettings.Strategies)},
+                                                                  {"SAMPLE_COUNT", std::to_string(std::max(mSettings.SampleCount, 1U))},
+                                                                  {"SAMPLE_MIS", mSettings.Mis ? "1" : "0"}}};
 
         mShaderKeys.push_back(mRaygen.CompileFromSource(mContext, RAYGEN_FILE, options));
         mShaderKeys.push_back(mClosestHit.CompileFromSource(mContext, CLOSESTHIT_FILE, options));
@@ -44,35 +57,96 @@ namespace sampling_testapp {
 
     void SamplingTestStage::CreateOrUpdateDescriptors()
     {
-        InitLights();
-        const uint32_t bindpoint_lights = 11;
+        if(!mLights.Exists())
+        {
+            UploadLights();
+        }
+        if(!mRayCounter.Exists())
+        {
+            mRayCounter.Create(mContext, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, sizeof(uint32_t),
+                               VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, 0, "RayCounter");
+        }
+        const uint32_t bindpoint_lights      = 11;
+        const uint32_t bindpoint_ray_counter = 12;
 
         mDescriptorSet.SetDescriptorAt(bindpoint_lights, mLights.GetVkDescriptorBufferInfo(), VkDescriptorType::VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, foray::stages::RTSTAGEFLAGS);
+        mDescriptorSet.SetDescriptorAt(bindpoint_ray_counter, mRayCounter.GetVkDescriptorBufferInfo(), VkDescriptorType::VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                       foray::stages::RTSTAGEFLAGS);
 
 
         foray::stages::DefaultRaytracingStageBase::CreateOrUpdateDescriptors();
     }
 
-    void SamplingTestStage::InitLights()
+    void SamplingTestStage::RecordFramePrepare(VkCommandBuffer cmdBuffer, foray::base::FrameRenderInfo& renderInfo)
+    {
+        // last frame's shaders and counter copy are done before the counter is cleared
+        VkMemoryBarrier clearBarrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER, .srcAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+                                     .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT};
+        vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+        vkCmdFillBuffer(cmdBuffer, mRayCounter.GetBuffer(), 0, sizeof(uint32_t), 0);
+
+        VkMemoryBarrier shaderBarrier{.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                      .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                                      .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
+        vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR, 0, 1, &shaderBarrier, 0, nullptr, 0, nullptr);
+
+        foray::stages::DefaultRaytracingStageBase::RecordFramePrepare(cmdBuffer, renderInfo);
+    }
+
+    void SamplingTestStage::CollectLights(foray::scene::Scene* scene)
+    {
+        std::vector<foray::scene::Node*> nodesWithMeshInstances{};
+        scene->FindNodesWithComponent<foray::scene::ncomp::MeshInstance>(nodesWithMeshInstances);
+        std::vector<foray::scene::Material>& materials = scene->GetComponent<foray::scene::gcomp::MaterialManager>()->GetVector();
+
+        mLightData.clear();
+        for(foray::scene::Node* node : nodesWithMeshInstances)
+        {
+            glm::mat4 transformMat = node->GetTransform()->GetGlobalMatrix();
+            for(auto& primitive : node->GetComponent<foray::scene::ncomp::MeshInstance>()->GetMesh()->GetPrimitives())
+            {
+                if(primitive.MaterialIndex < 0 || primitive.Vertices.empty() || glm::all(glm::equal(materials[primitive.MaterialIndex].EmissiveFactor, glm::vec3(0))))
+                {
+                    continue;
+                }
+
+                // bounding sphere around the world space bounding box center
+                glm::vec3 boundsMin(std::numeric_limits<float>::max());
+                glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+                for(const foray::scene::Vertex& vertex : primitive.Vertices)
+                {
+                    glm::vec3 pos = glm::vec3(transformMat * glm::vec4(vertex.Pos, 1.0));
+                    boundsMin     = glm::min(boundsMin, pos);
+                    boundsMax     = glm::max(boundsMax, pos);
+                }
+                glm::vec3 center = 0.5f * (boundsMin + boundsMax);
+                float     radius = 0.f;
+                for(const foray::scene::Vertex& vertex : primitive.Vertices)
+                {
+                    radius = std::max(radius, glm::distance(center, glm::vec3(transformMat * glm::vec4(vertex.Pos, 1.0))));
+                }
+                mLightData.push_back(Light{glm::vec4(center, radius)});
+            }
+        }
+        foray::logger()->info("Sampling test: {} sphere lights from emissive geometry, strategies {:#x}, {} samples, {}", mLightData.size(), mSettings.Strategies,
+                              mSettings.SampleCount, mSettings.Mis ? "mis" : "averaged");
+    }
+
+    void SamplingTestStage::UploadLights()
     {
-        struct Light
+        // header with the light count, the array starts at the 16 byte alignment of Light
+        std::vector<uint8_t> data(sizeof(glm::uvec4) + mLightData.size() * sizeof(Light));
+        glm::uvec4           header((uint32_t)mLightData.size(), 0, 0, 0);
+        memcpy(data.data(), &header, sizeof(header));
+        if(!mLightData.empty())
         {
-            glm::vec4 LightPosAndRadius;
-        };
-
-        // clang-format off
-        Light lights[5] = {
-            glm::vec4(-5.0f, -7.8113f, 6.5781f,  2.0f),
-			glm::vec4(-5.0f, -7.8113f, 2.0045f,  1.55f),
-			glm::vec4(-5.0f, -7.8113f, -1.4012f, 1.2f),
-            glm::vec4(-5.0f, -7.8113f, -4.2897f, 0.9f),
-			glm::vec4(-5.0f, -7.8113f, -6.6926f, 0.6f),
-        };
-        // clang-format on
-
-        mLights.Create(mContext, VkBufferUsageFlagBits::VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VkBufferUsageFlagBits::VK_BUFFER_USAGE_TRANSFER_DST_BIT, sizeof(lights),
+            memcpy(data.data() + sizeof(header), mLightData.data(), mLightData.size() * sizeof(Light));
+        }
+
+        mLights.Create(mContext, VkBufferUsageFlagBits::VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VkBufferUsageFlagBits::VK_BUFFER_USAGE_TRANSFER_DST_BIT, data.size(),
                        VMA_MEMORY_USAGE_AUTO);
-        mLights.WriteDataDeviceLocal(lights, sizeof(lights));
+        mLights.WriteDataDeviceLocal(data.data(), data.size());
     }
 
 
@@ -115,7 +189,7 @@ namespace sampling_testapp {
         mScene->UseDefaultCamera(INVERT_BLIT_INSTEAD);
         mScene->UpdateLightManager();
 
-        mRtStage.Init(&mContext, mScene.get());
+        mRtStage.Init(&mContext, mScene.get(), mSamplingSettings);
         mSwapCopyStage.Init(&mContext, mRtStage.GetRtOutput());
 
         if constexpr(INVERT_BLIT_INSTEAD)
@@ -125,11 +199,32 @@ namespace sampling_testapp {
 
         RegisterRenderStage(&mRtStage);
         RegisterRenderStage(&mSwapCopyStage);
+
+        mFrameCapture.Init(&mContext, std::string(foray::osi::CurrentWorkingDirectory()));
+        mFrameCapture.SetFlipY(INVERT_BLIT_INSTEAD);
+        if(mStartupCapture.has_value())
+        {
+            mFrameCapture.Start(mStartupCapture.value());
+        }
+
+        mPassTimer.Create(&mContext, {"Sampling ray tracing"});
+        mBenchmarkRun.Init(&mContext, &mFrameCapture, mBenchmarkSettings);
+        mBenchmarkRun.SetInfo("app", "sampling");
+        mBenchmarkRun.SetInfo("strategies", std::to_string(mSamplingSettings.Strategies));
+        mBenchmarkRun.SetInfo("samples", std::to_string(mSamplingSettings.SampleCount));
+        mBenchmarkRun.SetInfo("mis", mSamplingSettings.Mis ? "1" : "0");
     }
 
     void SamplingTestApp::ApiOnEvent(const foray::osi::Event* event)
     {
         mScene->InvokeOnEvent(event);
+
+        const SDL_Event& sdlEvent = event->RawSdlEventData;
+        if(sdlEvent.type == SDL_KEYDOWN && sdlEvent.key.repeat == 0 && sdlEvent.key.keysym.sym == SDLK_F12)
+        {
+            FrameCapture::Settings settings{.Format = mStartupCapture.has_value() ? mStartupCapture->Format : FrameCapture::EFileFormat::Exr};
+            mFrameCapture.Start(settings);
+        }
     }
 
     void SamplingTestApp::ApiOnResized(VkExtent2D size)
@@ -139,11 +234,31 @@ namespace sampling_testapp {
 
     void SamplingTestApp::ApiRender(foray::base::FrameRenderInfo& renderInfo)
     {
+        mFrameCapture.Update();
+        if(mBenchmarkRun.IsFinished())
+        {
+            GetRenderLoop().RequestStop();
+        }
+        mBenchmarkRun.BeginFrame();
+
         foray::core::DeviceSyncCommandBuffer& cmdBuffer = renderInfo.GetPrimaryCommandBuffer();
         cmdBuffer.Begin();
         renderInfo.GetInFlightFrame()->ClearSwapchainImage(cmdBuffer, renderInfo.GetImageLayoutCache());
         mScene->Update(renderInfo, cmdBuffer);
+
+        mPassTimer.CmdBeginFrame(cmdBuffer, renderInfo.GetFrameNumber());
+        mPassTimer.CmdBeginPass(cmdBuffer, 0);
         mRtStage.RecordFrame(cmdBuffer, renderInfo);
+        mPassTimer.CmdEndPass(cmdBuffer, 0, VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR);
+
+        // one primary ray per pixel, secondary rays are counted by the closest hit shader
+        VkExtent3D extent = mRtStage.GetRtOutput()->GetExtent3D();
+        mBenchmarkRun.AddGpuMs(mPassTimer.GetLastPassMs(0));
+        mBenchmarkRun.AddRays((uint64_t)extent.width * extent.height);
+        mBenchmarkRun.CmdCopyRayCounter(cmdBuffer, mRtStage.GetRayCounter().GetBuffer(), 0);
+        mBenchmarkRun.CmdCaptureOutput(cmdBuffer, renderInfo, mRtStage.GetRtOutput());
+
+        mFrameCapture.CmdCapture(cmdBuffer, renderInfo, mRtStage.GetRtOutput(), foray::stages::DefaultRaytracingStageBase::OutputName);
         mSwapCopyStage.RecordFrame(cmdBuffer, renderInfo);
         renderInfo.GetInFlightFrame()->PrepareSwapchainImageForPresent(cmdBuffer, renderInfo.GetImageLayoutCache());
         cmdBuffer.Submit();
@@ -151,6 +266,9 @@ namespace sampling_testapp {
 
     void SamplingTestApp::ApiDestroy()
     {
+        mFrameCapture.Destroy();
+        mBenchmarkRun.Destroy();
+        mPassTimer.Destroy();
         mRtStage.Destroy();
         mSwapCopyStage.Destroy();
         mScene = nullptr;
@@ -1,5 +1,10 @@
 #pragma once
+#include "benchmark_run.hpp"
+#include "frame_capture.hpp"
+#include "gpu_pass_timer.hpp"
 #include <foray_api.hpp>
+#include <optional>
+#include <vector>
 #include <scene/globalcomponents/foray_lightmanager.hpp>
 
 namespace sampling_testapp {
@@ -15,20 +20,52 @@ namespace sampling_testapp {
     /// @brief If true, will invert the viewport when blitting. Will invert the scene while loading to -Y up if false
     inline constexpr bool INVERT_BLIT_INSTEAD = true;
 
+    /// @brief Sampling strategies of the closest hit shader, each selected strategy traces one ray per sample
+    enum ESamplingStrategy : uint32_t
+    {
+        SAMPLE_BRDF    = 1,
+        SAMPLE_LIGHT   = 2,
+        SAMPLE_UNIFORM = 4,
+        SAMPLE_COSINE  = 8,
+    };
+
+    struct SamplingSettings
+    {
+        /// @brief ESamplingStrategy bits
+        uint32_t Strategies  = SAMPLE_BRDF | SAMPLE_LIGHT;
+        uint32_t SampleCount = 1;
+        /// @brief Combine the samples of the strategies with the balance heuristic instead of averaging them
+        bool Mis = true;
+    };
+
     class SamplingTestStage : public foray::stages::DefaultRaytracingStageBase
     {
       public:
-        virtual void Init(foray::core::Context* context, foray::scene::Scene* scene);
+        virtual void Init(foray::core::Context* context, foray::scene::Scene* scene, const SamplingSettings& settings);
 		virtual void Destroy();
 
+        /// @brief Rays traced by the closest hit shader in the current frame (32 bit, cleared when the frame is recorded)
+        inline foray::core::ManagedBuffer& GetRayCounter() { return mRayCounter; }
+
       protected:
         virtual void ApiCreateRtPipeline() override;
         virtual void ApiDestroyRtPipeline() override;
 
         virtual void CreateOrUpdateDescriptors() override;
-        void         InitLights();
+        virtual void RecordFramePrepare(VkCommandBuffer cmdBuffer, foray::base::FrameRenderInfo& renderInfo) override;
+        /// @brief Collects a bounding sphere light for every emissive primitive of the scene
+        void         CollectLights(foray::scene::Scene* scene);
+        void         UploadLights();
 
+        /// @brief std430 layout of LightsBuffer in closesthit.rchit
+        struct Light
+        {
+            glm::vec4 PositionAndRadius;
+        };
+        std::vector<Light>         mLightData;
         foray::core::ManagedBuffer mLights;
+        foray::core::ManagedBuffer mRayCounter;
+        SamplingSettings           mSettings;
 
         foray::core::ShaderModule mRaygen;
         foray::core::ShaderModule mClosestHit;
@@ -43,6 +80,14 @@ namespace sampling_testapp {
 
     class SamplingTestApp : public foray::base::DefaultAppBase
     {
+      public:
+        /// @brief Capture started with the first frame (from the command line), F12 captures single frames
+        inline void SetStartupCapture(const FrameCapture::Settings& settings) { mStartupCapture = settings; }
+        /// @brief Strategies and sample count compiled into the closest hit shader
+        inline void SetSamplingSettings(const SamplingSettings& settings) { mSamplingSettings = settings; }
+        /// @brief Measures the configuration for the benchmark suite and quits
+        inline void SetBenchmarkRun(const BenchmarkRun::Settings& settings) { mBenchmarkSettings = settings; }
+
       protected:
         virtual void ApiBeforeInit() override;
         virtual void ApiInit() override;
@@ -56,6 +101,15 @@ namespace sampling_testapp {
 		SamplingTestStage               mRtStage;
         foray::stages::ImageToSwapchainStage mSwapCopyStage;
         std::unique_ptr<foray::scene::Scene> mScene;
+
+        FrameCapture                          mFrameCapture;
+        std::optional<FrameCapture::Settings> mStartupCapture;
+        SamplingSettings                      mSamplingSettings;
+
+        /// @brief GPU time of the ray tracing stage
+        GpuPassTimer           mPassTimer;
+        BenchmarkRun           mBenchmarkRun;
+        BenchmarkRun::Settings mBenchmarkSettings;
     };
 
 }  // namespace sampling_testapp